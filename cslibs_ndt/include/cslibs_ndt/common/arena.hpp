@@ -0,0 +1,255 @@
+#ifndef CSLIBS_NDT_COMMON_ARENA_HPP
+#define CSLIBS_NDT_COMMON_ARENA_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+namespace cslibs_ndt {
+/**
+ * @brief Slab allocator for the small objects maps create per cell. Memory is
+ *        requested in slabs of slab_size slots per object size, freed slots
+ *        are kept in a free list for reuse and all slabs are released at once
+ *        when the arena is destroyed. Objects created with make hold a
+ *        reference to the arena, so it lives as long as any of them.
+ */
+class Arena
+{
+public:
+    using Ptr = std::shared_ptr<Arena>;
+
+    struct Statistics {
+        std::size_t allocations   = 0;  ///< objects allocated over the lifetime
+        std::size_t deallocations = 0;  ///< objects returned over the lifetime
+        std::size_t live          = 0;  ///< objects currently in use
+        std::size_t slabs         = 0;  ///< slabs requested from the heap
+        std::size_t byte_size     = 0;  ///< bytes held by the slabs
+    };
+
+    template <typename T>
+    class Allocator
+    {
+    public:
+        using value_type = T;
+
+        inline explicit Allocator(const Arena::Ptr &arena) :
+            arena_(arena)
+        {
+        }
+
+        template <typename U>
+        inline Allocator(const Allocator<U> &other) :
+            arena_(other.arena_)
+        {
+        }
+
+        inline T* allocate(const std::size_t n)
+        {
+            return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        inline void deallocate(T *p, const std::size_t n)
+        {
+            arena_->deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        template <typename U>
+        inline bool operator == (const Allocator<U> &other) const
+        {
+            return arena_ == other.arena_;
+        }
+
+        template <typename U>
+        inline bool operator != (const Allocator<U> &other) const
+        {
+            return arena_ != other.arena_;
+        }
+
+    private:
+        template <typename U>
+        friend class Allocator;
+
+        Arena::Ptr arena_;
+    };
+
+    inline explicit Arena(const std::size_t slab_size = 256) :
+        slab_size_(slab_size)
+    {
+    }
+
+    Arena(const Arena &other) = delete;
+    Arena& operator = (const Arena &other) = delete;
+
+    /**
+     * @brief Create a shared object in the arena, or on the heap without one.
+     */
+    template <typename T, typename... args_t>
+    inline static std::shared_ptr<T> make(const Ptr &arena,
+                                          args_t &&... args)
+    {
+        return arena ? std::allocate_shared<T>(Allocator<T>(arena), std::forward<args_t>(args)...) :
+                       std::shared_ptr<T>(new T(std::forward<args_t>(args)...));
+    }
+
+    inline void* allocate(const std::size_t bytes,
+                          const std::size_t align)
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        pool_t &p = pool(bytes, align);
+        if (!p.free) {
+            const std::size_t size = slab_size_ * p.slot + p.align;
+            std::unique_ptr<char[]> slab(new char[size]);
+            char *first = slab.get() + (p.align - reinterpret_cast<std::uintptr_t>(slab.get()) % p.align) % p.align;
+            for (std::size_t s = slab_size_ ; s > 0 ; -- s) {
+                node_t *n = reinterpret_cast<node_t*>(first + (s - 1) * p.slot);
+                n->next = p.free;
+                p.free  = n;
+            }
+            slabs_.emplace_back(std::move(slab));
+            statistics_.byte_size += size;
+            ++ statistics_.slabs;
+        }
+
+        node_t *n = p.free;
+        p.free = n->next;
+        ++ statistics_.allocations;
+        ++ statistics_.live;
+        return n;
+    }
+
+    inline void deallocate(void *ptr,
+                           const std::size_t bytes,
+                           const std::size_t align)
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        pool_t &p = pool(bytes, align);
+        node_t *n = static_cast<node_t*>(ptr);
+        n->next = p.free;
+        p.free  = n;
+        ++ statistics_.deallocations;
+        -- statistics_.live;
+    }
+
+    inline Statistics getStatistics() const
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        return statistics_;
+    }
+
+private:
+    struct node_t {
+        node_t *next;
+    };
+
+    /// one free list per object size, maps only use a handful of sizes
+    struct pool_t {
+        std::size_t bytes;
+        std::size_t align;
+        std::size_t slot;
+        node_t     *free;
+    };
+
+    const std::size_t                    slab_size_;
+    mutable std::mutex                   mutex_;
+    std::vector<pool_t>                  pools_;
+    std::vector<std::unique_ptr<char[]>> slabs_;
+    Statistics                           statistics_;
+
+    inline pool_t& pool(const std::size_t bytes,
+                        const std::size_t align)
+    {
+        for (pool_t &p : pools_)
+            if (p.bytes == bytes && p.align == align)
+                return p;
+
+        const std::size_t a = std::max(align, alignof(node_t));
+        const std::size_t s = std::max(bytes, sizeof(node_t));
+        pools_.push_back(pool_t{bytes, a, (s + a - 1) / a * a, nullptr});
+        return pools_.back();
+    }
+};
+
+/**
+ * @brief Append only sequence with stable element addresses, elements are
+ *        stored in chunks of chunk_size, so growing costs one allocation per
+ *        chunk instead of one per element.
+ */
+template <typename T, std::size_t chunk_bits = 8>
+class Slab
+{
+public:
+    static constexpr std::size_t chunk_size = 1ul << chunk_bits;
+
+    inline Slab() :
+        size_(0)
+    {
+    }
+
+    inline Slab(const Slab &other) :
+        size_(0)
+    {
+        for (std::size_t i = 0 ; i < other.size_ ; ++ i)
+            emplace_back(other[i]);
+    }
+
+    template <typename... args_t>
+    inline void emplace_back(args_t &&... args)
+    {
+        if ((size_ & (chunk_size - 1)) == 0) {
+            chunks_.emplace_back();
+            chunks_.back().reserve(chunk_size);
+        }
+        chunks_.back().emplace_back(std::forward<args_t>(args)...);
+        ++ size_;
+    }
+
+    inline T& operator [] (const std::size_t i)
+    {
+        return chunks_[i >> chunk_bits][i & (chunk_size - 1)];
+    }
+
+    inline const T& operator [] (const std::size_t i) const
+    {
+        return chunks_[i >> chunk_bits][i & (chunk_size - 1)];
+    }
+
+    inline T& back()
+    {
+        return chunks_.back().back();
+    }
+
+    inline std::size_t size() const
+    {
+        return size_;
+    }
+
+    inline std::size_t chunks() const
+    {
+        return chunks_.size();
+    }
+
+    inline std::size_t byte_size() const
+    {
+        return chunks_.size() * chunk_size * sizeof(T);
+    }
+
+    inline void clear()
+    {
+        chunks_.clear();
+        size_ = 0;
+    }
+
+private:
+    std::vector<std::vector<T>> chunks_;
+    std::size_t                 size_;
+};
+
+template <typename T, std::size_t chunk_bits>
+constexpr std::size_t Slab<T, chunk_bits>::chunk_size;
+}
+
+#endif // CSLIBS_NDT_COMMON_ARENA_HPP
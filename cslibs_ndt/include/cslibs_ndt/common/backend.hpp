@@ -0,0 +1,24 @@
+#ifndef CSLIBS_NDT_COMMON_BACKEND_HPP
+#define CSLIBS_NDT_COMMON_BACKEND_HPP
+
+#include <cslibs_ndt/common/hash_storage.hpp>
+#include <cslibs_ndt/common/morton_storage.hpp>
+
+#include <cslibs_indexed_storage/storage.hpp>
+#include <cslibs_indexed_storage/backend/kdtree/kdtree.hpp>
+
+namespace cslibs_ndt {
+/// storages selectable for the sparse (dynamic) maps
+namespace backend {
+template <typename data_t, typename index_t>
+using KDTree = cslibs_indexed_storage::Storage<data_t, index_t, cslibs_indexed_storage::backend::kdtree::KDTree>;
+
+template <typename data_t, typename index_t>
+using Hash   = HashStorage<data_t, index_t>;
+
+template <typename data_t, typename index_t>
+using Morton = MortonStorage<data_t, index_t>;
+}
+}
+
+#endif // CSLIBS_NDT_COMMON_BACKEND_HPP
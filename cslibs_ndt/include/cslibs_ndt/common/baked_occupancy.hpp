@@ -0,0 +1,188 @@
+#ifndef CSLIBS_NDT_COMMON_BAKED_OCCUPANCY_HPP
+#define CSLIBS_NDT_COMMON_BAKED_OCCUPANCY_HPP
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cslibs_ndt/common/occupancy_distribution.hpp>
+#include <cslibs_ndt/common/executor.hpp>
+
+namespace cslibs_ndt {
+/**
+ * @brief Occupancy of all cells of a map of fixed size, evaluated once for one
+ *        inverse model and quantised to value_t, e.g. 8 or 16 bit. Each bundle
+ *        stores the occupancy of its cells next to their statistics in a dense
+ *        table, so sampling a baked map reads the table only and takes no
+ *        locks. The table is never modified after baking, switching the
+ *        inverse model means baking a new one.
+ */
+template <std::size_t Dim, typename value_t = std::uint16_t>
+class BakedOccupancy
+{
+public:
+    using Ptr                = std::shared_ptr<const BakedOccupancy>;
+    using index_t            = std::array<int, Dim>;
+    using size_t             = std::array<std::size_t, Dim>;
+    using distribution_t     = typename OccupancyDistribution<Dim>::distribution_t;
+    using distribution_ptr_t = std::shared_ptr<const distribution_t>;
+    using sample_t           = typename distribution_t::sample_t;
+    using inverse_model_t    = cslibs_gridmaps::utility::InverseModel;
+
+    static constexpr std::size_t bundle_size = 1ul << Dim;
+
+    struct bundle_t {
+        std::array<value_t, bundle_size>            occupancy;
+        std::array<distribution_ptr_t, bundle_size> distribution;
+    };
+
+    /**
+     * @brief Bake the bundles of a map whose bundle indices lie in [0, size).
+     * @param bundles bundle storage of the map, it must not be written while
+     *                baking
+     */
+    template <typename bundle_storage_t>
+    inline static Ptr bake(const inverse_model_t::Ptr &ivm,
+                           const size_t               &size,
+                           const bundle_storage_t     &bundles)
+    {
+        if (!ivm)
+            throw std::runtime_error("[BakedOccupancy]: inverse model not set");
+
+        using bundle_ptr_t = const typename bundle_storage_t::data_type*;
+
+        std::shared_ptr<BakedOccupancy> baked(new BakedOccupancy(ivm, size));
+        std::vector<std::pair<std::size_t, bundle_ptr_t>> indices;
+        bundles.traverse([&indices, &baked](const index_t &bi, const typename bundle_storage_t::data_type &b) {
+            const std::size_t i = baked->linear(bi);
+            if (i < baked->bundles_.size())
+                indices.emplace_back(i, &b);
+        });
+
+        /// every thread writes its own range of the table
+        Executor &executor = Executor::instance();
+        Executor::jobs_t jobs;
+        for (const auto &r : executor.split(indices.size(), 1024)) {
+            jobs.emplace_back([&indices, &baked, &ivm, r]() {
+                for (std::size_t j = r.first ; j < r.second ; ++ j) {
+                    bundle_t &b = baked->bundles_[indices[j].first];
+                    for (std::size_t i = 0 ; i < bundle_size ; ++ i) {
+                        const auto handle = indices[j].second->at(i)->getHandle();
+                        if (!handle->getDistribution())
+                            continue;
+                        b.occupancy[i]    = quantise(handle->getOccupancy(ivm));
+                        b.distribution[i] = handle->getDistribution();
+                    }
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+        return baked;
+    }
+
+    inline const inverse_model_t::Ptr& getInverseModel() const
+    {
+        return ivm_;
+    }
+
+    inline const size_t& getSize() const
+    {
+        return size_;
+    }
+
+    inline const bundle_t* getBundle(const index_t &bi) const
+    {
+        const std::size_t i = linear(bi);
+        return i < bundles_.size() ? &bundles_[i] : nullptr;
+    }
+
+    /**
+     * @brief Mean over the cells of the bundle of their density weighted by
+     *        their occupancy, equal to sampling the map up to quantisation.
+     */
+    inline double sample(const sample_t &p,
+                         const index_t  &bi) const
+    {
+        const bundle_t *b = getBundle(bi);
+        if (!b)
+            return 0.0;
+
+        double s = 0.0;
+        for (std::size_t i = 0 ; i < bundle_size ; ++ i)
+            if (b->distribution[i])
+                s += b->distribution[i]->sample(p) * value(b->occupancy[i]);
+        return s / bundle_size;
+    }
+
+    inline double sampleNonNormalized(const sample_t &p,
+                                      const index_t  &bi) const
+    {
+        const bundle_t *b = getBundle(bi);
+        if (!b)
+            return 0.0;
+
+        double s = 0.0;
+        for (std::size_t i = 0 ; i < bundle_size ; ++ i)
+            if (b->distribution[i])
+                s += b->distribution[i]->sampleNonNormalized(p) * value(b->occupancy[i]);
+        return s / bundle_size;
+    }
+
+    inline static value_t quantise(const double occupancy)
+    {
+        const double o = std::min(1.0, std::max(0.0, occupancy));
+        return static_cast<value_t>(std::round(o * std::numeric_limits<value_t>::max()));
+    }
+
+    inline static double value(const value_t q)
+    {
+        return static_cast<double>(q) / std::numeric_limits<value_t>::max();
+    }
+
+    inline std::size_t byte_size() const
+    {
+        return sizeof(*this) + bundles_.size() * sizeof(bundle_t);
+    }
+
+private:
+    const inverse_model_t::Ptr ivm_;
+    const size_t               size_;
+    std::vector<bundle_t>      bundles_;
+
+    inline BakedOccupancy(const inverse_model_t::Ptr &ivm,
+                          const size_t               &size) :
+        ivm_(ivm),
+        size_(size)
+    {
+        std::size_t n = 1;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            n *= size_[i];
+        bundle_t empty;
+        empty.occupancy.fill(0);
+        bundles_.resize(n, empty);
+    }
+
+    /// row-major, indices outside of the map are mapped past the end
+    inline std::size_t linear(const index_t &bi) const
+    {
+        std::size_t l = 0;
+        for (std::size_t i = 0 ; i < Dim ; ++ i) {
+            if (bi[i] < 0 || static_cast<std::size_t>(bi[i]) >= size_[i])
+                return bundles_.size();
+            l = l * size_[i] + static_cast<std::size_t>(bi[i]);
+        }
+        return l;
+    }
+};
+
+template <std::size_t Dim, typename value_t>
+constexpr std::size_t BakedOccupancy<Dim, value_t>::bundle_size;
+}
+
+#endif // CSLIBS_NDT_COMMON_BAKED_OCCUPANCY_HPP
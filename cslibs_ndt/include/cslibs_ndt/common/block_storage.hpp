@@ -0,0 +1,221 @@
+#ifndef CSLIBS_NDT_COMMON_BLOCK_STORAGE_HPP
+#define CSLIBS_NDT_COMMON_BLOCK_STORAGE_HPP
+
+#include <array>
+#include <bitset>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+#include <cslibs_indexed_storage/storage.hpp>
+
+namespace cslibs_ndt {
+/**
+ * @brief Two level storage for bounded grids with the interface of the array
+ *        backend. A dense top level table points to leaf blocks of
+ *        2^leaf_bits cells per axis, which are only allocated once a cell
+ *        inside is inserted. Lookups stay constant time, memory is
+ *        proportional to the occupied volume plus one pointer per block.
+ *        Leaves never move, so pointers to the data stay valid.
+ */
+template <typename data_t, typename index_t>
+class BlockStorage
+{
+public:
+    using data_type  = data_t;
+    using index_type = index_t;
+    using size_t     = std::array<std::size_t, std::tuple_size<index_t>::value>;
+
+    static constexpr std::size_t dim         = std::tuple_size<index_t>::value;
+    static constexpr std::size_t leaf_bits   = dim >= 3 ? 3 : 4;
+    static constexpr std::size_t leaf_edge   = 1ul << leaf_bits;
+    static constexpr std::size_t leaf_volume = 1ul << (leaf_bits * dim);
+
+    inline BlockStorage()
+    {
+        size_.fill(0);
+        blocks_.fill(0);
+    }
+
+    inline BlockStorage(const BlockStorage &other) :
+        size_(other.size_),
+        blocks_(other.blocks_),
+        leaves_(other.leaves_.size())
+    {
+        for (std::size_t l = 0 ; l < leaves_.size() ; ++ l)
+            if (other.leaves_[l])
+                leaves_[l].reset(new leaf_t(*other.leaves_[l]));
+    }
+
+    /**
+     * @brief Set the grid size, only the array_size option is supported.
+     *        Accepts either the size array or one size per axis.
+     */
+    template <typename option_t, typename... args_t>
+    inline void set(const args_t &... args)
+    {
+        static_assert(std::is_same<option_t, cslibs_indexed_storage::option::tags::array_size>::value,
+                      "BlockStorage only supports the array_size option.");
+        resize(args...);
+    }
+
+    inline data_t* get(const index_t &index)
+    {
+        std::size_t l, c;
+        if (!locate(index, l, c) || !leaves_[l] || !leaves_[l]->valid[c])
+            return nullptr;
+        return &leaves_[l]->data[c];
+    }
+
+    inline const data_t* get(const index_t &index) const
+    {
+        std::size_t l, c;
+        if (!locate(index, l, c) || !leaves_[l] || !leaves_[l]->valid[c])
+            return nullptr;
+        return &leaves_[l]->data[c];
+    }
+
+    /**
+     * @brief Insert data at index, data already stored there is replaced.
+     */
+    inline data_t& insert(const index_t &index,
+                          const data_t  &data)
+    {
+        std::size_t l, c;
+        if (!locate(index, l, c))
+            throw std::out_of_range("BlockStorage: index out of range.");
+
+        std::unique_ptr<leaf_t> &leaf = leaves_[l];
+        if (!leaf)
+            leaf.reset(new leaf_t);
+        leaf->valid[c] = true;
+        leaf->data[c]  = data;
+        return leaf->data[c];
+    }
+
+    /**
+     * @brief Visit all entries block by block.
+     */
+    template <typename Fn>
+    inline void traverse(const Fn &fn)
+    {
+        for (std::size_t l = 0 ; l < leaves_.size() ; ++ l) {
+            if (!leaves_[l])
+                continue;
+            leaf_t &leaf = *leaves_[l];
+            for (std::size_t c = 0 ; c < leaf_volume ; ++ c)
+                if (leaf.valid[c])
+                    fn(toIndex(l, c), leaf.data[c]);
+        }
+    }
+
+    template <typename Fn>
+    inline void traverse(const Fn &fn) const
+    {
+        for (std::size_t l = 0 ; l < leaves_.size() ; ++ l) {
+            if (!leaves_[l])
+                continue;
+            const leaf_t &leaf = *leaves_[l];
+            for (std::size_t c = 0 ; c < leaf_volume ; ++ c)
+                if (leaf.valid[c])
+                    fn(toIndex(l, c), leaf.data[c]);
+        }
+    }
+
+    inline std::size_t size() const
+    {
+        std::size_t n = 0;
+        for (const std::unique_ptr<leaf_t> &leaf : leaves_)
+            if (leaf)
+                n += leaf->valid.count();
+        return n;
+    }
+
+    inline std::size_t byte_size() const
+    {
+        std::size_t n = 0;
+        for (const std::unique_ptr<leaf_t> &leaf : leaves_)
+            if (leaf)
+                ++ n;
+        return leaves_.size() * sizeof(std::unique_ptr<leaf_t>) +
+               n * sizeof(leaf_t);
+    }
+
+    inline void clear()
+    {
+        for (std::unique_ptr<leaf_t> &leaf : leaves_)
+            leaf.reset();
+    }
+
+private:
+    struct leaf_t {
+        std::array<data_t, leaf_volume> data;
+        std::bitset<leaf_volume>         valid;
+    };
+
+    size_t                               size_;
+    size_t                               blocks_;
+    std::vector<std::unique_ptr<leaf_t>> leaves_;
+
+    inline void resize(const size_t &size)
+    {
+        size_ = size;
+        std::size_t n = 1;
+        for (std::size_t i = 0 ; i < dim ; ++ i) {
+            blocks_[i] = (size[i] + leaf_edge - 1) >> leaf_bits;
+            n *= blocks_[i];
+        }
+        leaves_.clear();
+        leaves_.resize(n);
+    }
+
+    template <typename... sizes_t>
+    inline void resize(const sizes_t &... sizes)
+    {
+        static_assert(sizeof...(sizes_t) == dim, "BlockStorage needs one size per axis.");
+        resize(size_t{{static_cast<std::size_t>(sizes)...}});
+    }
+
+    /// leaf l in row-major block order, cell c in row-major order inside the leaf
+    inline bool locate(const index_t &index,
+                       std::size_t   &l,
+                       std::size_t   &c) const
+    {
+        l = 0;
+        c = 0;
+        for (std::size_t i = 0 ; i < dim ; ++ i) {
+            if (index[i] < 0 || static_cast<std::size_t>(index[i]) >= size_[i])
+                return false;
+            const std::size_t u = static_cast<std::size_t>(index[i]);
+            l = l * blocks_[i] + (u >> leaf_bits);
+            c = (c << leaf_bits) | (u & (leaf_edge - 1));
+        }
+        return true;
+    }
+
+    inline index_t toIndex(std::size_t l,
+                           std::size_t c) const
+    {
+        index_t index;
+        for (std::size_t i = dim ; i > 0 ; -- i) {
+            const std::size_t b = l % blocks_[i - 1];
+            l /= blocks_[i - 1];
+            index[i - 1] = static_cast<int>((b << leaf_bits) | (c & (leaf_edge - 1)));
+            c >>= leaf_bits;
+        }
+        return index;
+    }
+};
+
+template <typename data_t, typename index_t>
+constexpr std::size_t BlockStorage<data_t, index_t>::dim;
+template <typename data_t, typename index_t>
+constexpr std::size_t BlockStorage<data_t, index_t>::leaf_bits;
+template <typename data_t, typename index_t>
+constexpr std::size_t BlockStorage<data_t, index_t>::leaf_edge;
+template <typename data_t, typename index_t>
+constexpr std::size_t BlockStorage<data_t, index_t>::leaf_volume;
+}
+
+#endif // CSLIBS_NDT_COMMON_BLOCK_STORAGE_HPP
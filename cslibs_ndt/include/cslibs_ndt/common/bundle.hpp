@@ -72,8 +72,18 @@ public:
         return data_;
     }
 
-    inline void merge(const Bundle &)
+    /**
+     * @brief Merge the cells of another bundle of cell pointers into the cells
+     *        of this one. Bundles share cells with their neighbours, so whole
+     *        maps have to be merged cell by cell instead.
+     */
+    inline void merge(const Bundle &other)
     {
+        for (std::size_t i = 0 ; i < Size ; ++ i) {
+            /// copy first, so no two cell locks are held at once
+            const auto cell = *other.data_[i]->getHandle();
+            data_[i]->getHandle()->merge(cell);
+        }
     }
 
     inline std::size_t byte_size() const
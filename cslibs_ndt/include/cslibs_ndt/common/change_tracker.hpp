@@ -0,0 +1,94 @@
+#ifndef CSLIBS_NDT_COMMON_CHANGE_TRACKER_HPP
+#define CSLIBS_NDT_COMMON_CHANGE_TRACKER_HPP
+
+#include <cslibs_ndt/common/hash_storage.hpp>
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <vector>
+
+namespace cslibs_ndt {
+/**
+ * @brief Bundles written since changes were taken last, e.g. to publish map
+ *        updates incrementally. Tracking starts with the first take, before
+ *        that marking is a single atomic load.
+ */
+template <std::size_t Dim>
+class ChangeTracker
+{
+public:
+    using index_t = std::array<int, Dim>;
+    using mutex_t = std::mutex;
+    using lock_t  = std::unique_lock<mutex_t>;
+
+    inline ChangeTracker() :
+        tracking_(false)
+    {
+    }
+
+    inline bool isTracking() const
+    {
+        return tracking_;
+    }
+
+    inline void mark(const index_t &bi)
+    {
+        if (!tracking_)
+            return;
+
+        lock_t l(mutex_);
+        if (!changed_.get(bi))
+            changed_.insert(bi, true);
+    }
+
+    /**
+     * @brief Take the bundles marked since the previous call, including their
+     *        neighbours, as bundles share cells with them. The first call
+     *        starts tracking and takes every bundle, which all appends.
+     */
+    template <typename all_fn_t>
+    inline void take(std::vector<index_t> &indices,
+                     const all_fn_t       &all)
+    {
+        std::vector<index_t> marked;
+        {
+            lock_t l(mutex_);
+            if (!tracking_) {
+                tracking_ = true;
+                l.unlock();
+                all(indices);
+                return;
+            }
+            changed_.traverse([&marked](const index_t &bi, const bool &) {
+                marked.emplace_back(bi);
+            });
+            changed_.clear();
+        }
+
+        std::size_t num_offsets = 1;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            num_offsets *= 3;
+
+        HashStorage<bool, index_t> neighbours;
+        for (const index_t &bi : marked) {
+            for (std::size_t o = 0 ; o < num_offsets ; ++ o) {
+                index_t n = bi;
+                for (std::size_t i = 0, r = o ; i < Dim ; ++ i, r /= 3)
+                    n[i] += static_cast<int>(r % 3) - 1;
+                if (!neighbours.get(n)) {
+                    neighbours.insert(n, true);
+                    indices.emplace_back(n);
+                }
+            }
+        }
+    }
+
+private:
+    std::atomic_bool           tracking_;
+    mutex_t                    mutex_;
+    HashStorage<bool, index_t> changed_;
+};
+}
+
+#endif // CSLIBS_NDT_COMMON_CHANGE_TRACKER_HPP
@@ -0,0 +1,39 @@
+#ifndef CSLIBS_NDT_COMMON_CONTRIBUTION_HPP
+#define CSLIBS_NDT_COMMON_CONTRIBUTION_HPP
+
+#include <array>
+#include <vector>
+#include <utility>
+
+#include <Eigen/StdVector>
+
+#include <cslibs_math/statistics/distribution.hpp>
+
+namespace cslibs_ndt {
+/**
+ * @brief Everything one scan added to an occupancy map, the occupied
+ *        statistics and free counts per bundle. Each of them was applied to
+ *        all cells of the bundle, so it can be taken back the same way.
+ */
+template <std::size_t Dim, typename pose_t>
+struct Contribution
+{
+    using index_t        = std::array<int, Dim>;
+    using distribution_t = cslibs_math::statistics::Distribution<Dim, 3>;
+    using occupied_t     = std::pair<index_t, distribution_t>;
+    using free_t         = std::pair<index_t, std::size_t>;
+
+    pose_t                                                        origin;
+    std::vector<occupied_t, Eigen::aligned_allocator<occupied_t>> occupied;
+    std::vector<free_t>                                           free;
+
+    inline std::size_t byte_size() const
+    {
+        return sizeof(*this) +
+               occupied.size() * sizeof(occupied_t) +
+               free.size() * sizeof(free_t);
+    }
+};
+}
+
+#endif // CSLIBS_NDT_COMMON_CONTRIBUTION_HPP
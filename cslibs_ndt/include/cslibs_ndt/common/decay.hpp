@@ -0,0 +1,76 @@
+#ifndef CSLIBS_NDT_COMMON_DECAY_HPP
+#define CSLIBS_NDT_COMMON_DECAY_HPP
+
+#include <cmath>
+#include <atomic>
+#include <memory>
+
+namespace cslibs_ndt {
+/**
+ * @brief Exponential forgetting of occupancy evidence, shared by all cells of
+ *        a map. The map owner advances the clock, cells remember when they
+ *        were written last and apply the decay lazily whenever they are
+ *        written or read, so forgetting never requires a sweep over the map.
+ */
+class Decay
+{
+public:
+    using Ptr = std::shared_ptr<Decay>;
+
+    inline Decay() :
+        rate_(0.0),
+        time_(0.0)
+    {
+    }
+
+    Decay(const Decay &other) = delete;
+    Decay& operator = (const Decay &other) = delete;
+
+    /**
+     * @brief Evidence loses half its weight after half_life seconds, a non
+     *        positive half life disables forgetting.
+     */
+    inline void setHalfLife(const double half_life)
+    {
+        rate_ = half_life > 0.0 ? std::log(2.0) / half_life : 0.0;
+    }
+
+    inline double getHalfLife() const
+    {
+        const double rate = rate_;
+        return rate > 0.0 ? std::log(2.0) / rate : 0.0;
+    }
+
+    inline bool enabled() const
+    {
+        return rate_ > 0.0;
+    }
+
+    inline void setTime(const double time)
+    {
+        time_ = time;
+    }
+
+    inline double getTime() const
+    {
+        return time_;
+    }
+
+    /**
+     * @brief Weight left at time of evidence added at stamp.
+     */
+    inline double factor(const double stamp,
+                         const double time) const
+    {
+        const double rate = rate_;
+        const double dt   = time - stamp;
+        return rate > 0.0 && dt > 0.0 ? std::exp(-rate * dt) : 1.0;
+    }
+
+private:
+    std::atomic<double> rate_;
+    std::atomic<double> time_;
+};
+}
+
+#endif // CSLIBS_NDT_COMMON_DECAY_HPP
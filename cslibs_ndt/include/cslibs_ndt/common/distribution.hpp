@@ -80,8 +80,12 @@ public:
         return data_;
     }
 
-    inline void merge(const Distribution &)
+    /**
+     * @brief Fuse the statistics of another cell into this one.
+     */
+    inline void merge(const Distribution &other)
     {
+        data_ += other.data_;
     }
 
     inline handle_t getHandle()
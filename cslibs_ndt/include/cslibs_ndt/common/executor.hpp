@@ -0,0 +1,152 @@
+#ifndef CSLIBS_NDT_COMMON_EXECUTOR_HPP
+#define CSLIBS_NDT_COMMON_EXECUTOR_HPP
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+namespace cslibs_ndt {
+/**
+ * @brief Fixed size pool of worker threads shared by the map implementations.
+ *        Jobs must not wait for other jobs of the same executor, submit a flat
+ *        list of jobs instead.
+ */
+class Executor
+{
+public:
+    using job_t  = std::function<bool()>;
+    using jobs_t = std::vector<job_t>;
+
+    inline explicit Executor(const std::size_t num_threads = std::thread::hardware_concurrency()) :
+        stop_(false)
+    {
+        const std::size_t n = std::max<std::size_t>(num_threads, 1ul);
+        for (std::size_t i = 0 ; i < n ; ++ i)
+            workers_.emplace_back([this]() { loop(); });
+    }
+
+    inline virtual ~Executor()
+    {
+        {
+            lock_t l(queue_mutex_);
+            stop_ = true;
+        }
+        queue_condition_.notify_all();
+        for (std::thread &w : workers_)
+            w.join();
+    }
+
+    Executor(const Executor &other) = delete;
+    Executor& operator = (const Executor &other) = delete;
+
+    /**
+     * @brief Process wide executor with one worker per hardware thread.
+     */
+    static inline Executor& instance()
+    {
+        static Executor executor;
+        return executor;
+    }
+
+    inline std::size_t size() const
+    {
+        return workers_.size();
+    }
+
+    /**
+     * @brief Run all jobs and block until they are done.
+     * @return true if every job succeeded
+     */
+    inline bool run(const jobs_t &jobs)
+    {
+        if (jobs.empty())
+            return true;
+
+        std::atomic_bool        success(true);
+        std::size_t             pending = jobs.size();
+        std::mutex              done_mutex;
+        std::condition_variable done_condition;
+        {
+            lock_t l(queue_mutex_);
+            for (const job_t &job : jobs) {
+                queue_.emplace_back([&job, &success, &pending, &done_mutex, &done_condition]() {
+                    bool s = false;
+                    try {
+                        s = job();
+                    } catch (const std::exception &e) {
+                        std::cerr << "[Executor]: " << e.what() << "\n";
+                    }
+                    if (!s)
+                        success = false;
+
+                    lock_t l(done_mutex);
+                    if (-- pending == 0)
+                        done_condition.notify_one();
+                });
+            }
+        }
+        queue_condition_.notify_all();
+
+        lock_t l(done_mutex);
+        done_condition.wait(l, [&pending]() { return pending == 0; });
+        return success;
+    }
+
+    /**
+     * @brief Split [0, n) into ranges of at least min_range elements, at most
+     *        one range per worker.
+     */
+    inline std::vector<std::pair<std::size_t, std::size_t>> split(const std::size_t n,
+                                                                  const std::size_t min_range = 1) const
+    {
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        if (n == 0)
+            return ranges;
+
+        const std::size_t parts = std::max<std::size_t>(1ul, std::min(size(), n / std::max<std::size_t>(min_range, 1ul)));
+        const std::size_t step  = n / parts;
+        const std::size_t rest  = n % parts;
+        std::size_t start = 0;
+        for (std::size_t i = 0 ; i < parts ; ++ i) {
+            const std::size_t end = start + step + (i < rest ? 1 : 0);
+            ranges.emplace_back(start, end);
+            start = end;
+        }
+        return ranges;
+    }
+
+private:
+    using mutex_t = std::mutex;
+    using lock_t  = std::unique_lock<mutex_t>;
+
+    bool                              stop_;
+    std::vector<std::thread>          workers_;
+    std::deque<std::function<void()>> queue_;
+    mutex_t                           queue_mutex_;
+    std::condition_variable           queue_condition_;
+
+    inline void loop()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                lock_t l(queue_mutex_);
+                queue_condition_.wait(l, [this]() { return stop_ || !queue_.empty(); });
+                if (stop_ && queue_.empty())
+                    return;
+                task = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            task();
+        }
+    }
+};
+}
+
+#endif // CSLIBS_NDT_COMMON_EXECUTOR_HPP
@@ -0,0 +1,52 @@
+#ifndef CSLIBS_NDT_COMMON_EXP_TABLE_HPP
+#define CSLIBS_NDT_COMMON_EXP_TABLE_HPP
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace cslibs_ndt {
+/**
+ * @brief Tabulated exp(-x) on [0, maximum], linearly interpolated between the
+ *        samples and constant beyond maximum. Meant for loops evaluating the
+ *        same falloff for millions of cells, e.g. likelihood fields.
+ */
+class ExpTable
+{
+public:
+    inline explicit ExpTable(const double      maximum,
+                             const std::size_t size = 4096) :
+        maximum_(std::max(maximum, 0.0)),
+        scale_(maximum_ > 0.0 ? (std::max<std::size_t>(size, 2ul) - 1) / maximum_ : 0.0),
+        table_(std::max<std::size_t>(size, 2ul))
+    {
+        for (std::size_t i = 0 ; i < table_.size() ; ++ i)
+            table_[i] = std::exp(-(scale_ > 0.0 ? i / scale_ : 0.0));
+    }
+
+    inline double operator () (const double x) const
+    {
+        if (x <= 0.0)
+            return 1.0;
+        if (x >= maximum_)
+            return table_.back();
+
+        const double      s = x * scale_;
+        const std::size_t i = static_cast<std::size_t>(s);
+        const double      t = s - i;
+        return table_[i] + t * (table_[i + 1] - table_[i]);
+    }
+
+    inline double getMaximum() const
+    {
+        return maximum_;
+    }
+
+private:
+    const double        maximum_;
+    const double        scale_;
+    std::vector<double> table_;
+};
+}
+
+#endif // CSLIBS_NDT_COMMON_EXP_TABLE_HPP
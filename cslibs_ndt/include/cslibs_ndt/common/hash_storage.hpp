@@ -0,0 +1,159 @@
+#ifndef CSLIBS_NDT_COMMON_HASH_STORAGE_HPP
+#define CSLIBS_NDT_COMMON_HASH_STORAGE_HPP
+
+#include <cslibs_ndt/common/arena.hpp>
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+namespace cslibs_ndt {
+/**
+ * @brief Open addressing hash table for grid indices with the interface of
+ *        the indexed storages used by the dynamic maps. Keys are probed
+ *        linearly in a flat slot array, the data itself lives in a slab and
+ *        never moves, so pointers handed out by get and insert stay valid
+ *        while the table grows, which the bundle storages rely on.
+ */
+template <typename data_t, typename index_t>
+class HashStorage
+{
+public:
+    using data_type  = data_t;
+    using index_type = index_t;
+
+    inline HashStorage() :
+        slots_(initial_size)
+    {
+    }
+
+    inline data_t* get(const index_t &index)
+    {
+        const std::size_t v = find(index);
+        return v == npos ? nullptr : &values_[v].second;
+    }
+
+    inline const data_t* get(const index_t &index) const
+    {
+        const std::size_t v = find(index);
+        return v == npos ? nullptr : &values_[v].second;
+    }
+
+    /**
+     * @brief Insert data at index, data already stored there is replaced.
+     */
+    inline data_t& insert(const index_t &index,
+                          const data_t  &data)
+    {
+        const std::size_t v = find(index);
+        if (v != npos) {
+            values_[v].second = data;
+            return values_[v].second;
+        }
+
+        if (2 * (values_.size() + 1) > slots_.size())
+            rehash(2 * slots_.size());
+
+        values_.emplace_back(index, data);
+        place(index, values_.size() - 1);
+        return values_.back().second;
+    }
+
+    /**
+     * @brief Visit all entries in insertion order.
+     */
+    template <typename Fn>
+    inline void traverse(const Fn &fn)
+    {
+        for (std::size_t v = 0 ; v < values_.size() ; ++ v)
+            fn(values_[v].first, values_[v].second);
+    }
+
+    template <typename Fn>
+    inline void traverse(const Fn &fn) const
+    {
+        for (std::size_t v = 0 ; v < values_.size() ; ++ v)
+            fn(values_[v].first, values_[v].second);
+    }
+
+    inline std::size_t size() const
+    {
+        return values_.size();
+    }
+
+    inline std::size_t byte_size() const
+    {
+        return values_.byte_size() +
+               slots_.size() * sizeof(slot_t);
+    }
+
+    inline void clear()
+    {
+        values_.clear();
+        slots_.assign(initial_size, slot_t());
+    }
+
+protected:
+    static constexpr std::size_t npos         = std::numeric_limits<std::size_t>::max();
+    static constexpr std::size_t initial_size = 64;
+
+    /// the key is kept next to the value position, so probing does not touch the data
+    struct slot_t {
+        index_t     key;
+        std::size_t value = npos;
+    };
+
+    std::vector<slot_t>                   slots_;
+    Slab<std::pair<index_t, data_t>>      values_;
+
+private:
+    inline static std::size_t hash(const index_t &index)
+    {
+        std::uint64_t h = 0xcbf29ce484222325ull;
+        for (const auto &i : index) {
+            h ^= static_cast<std::uint32_t>(i);
+            h *= 0x9e3779b97f4a7c15ull;
+            h ^= h >> 29;
+        }
+        return static_cast<std::size_t>(h);
+    }
+
+    inline std::size_t find(const index_t &index) const
+    {
+        const std::size_t mask = slots_.size() - 1;
+        for (std::size_t s = hash(index) & mask ; ; s = (s + 1) & mask) {
+            const slot_t &slot = slots_[s];
+            if (slot.value == npos)
+                return npos;
+            if (slot.key == index)
+                return slot.value;
+        }
+    }
+
+    inline void place(const index_t &index,
+                      const std::size_t value)
+    {
+        const std::size_t mask = slots_.size() - 1;
+        std::size_t s = hash(index) & mask;
+        while (slots_[s].value != npos)
+            s = (s + 1) & mask;
+        slots_[s].key   = index;
+        slots_[s].value = value;
+    }
+
+    inline void rehash(const std::size_t size)
+    {
+        slots_.assign(size, slot_t());
+        for (std::size_t v = 0 ; v < values_.size() ; ++ v)
+            place(values_[v].first, v);
+    }
+};
+
+template <typename data_t, typename index_t>
+constexpr std::size_t HashStorage<data_t, index_t>::npos;
+template <typename data_t, typename index_t>
+constexpr std::size_t HashStorage<data_t, index_t>::initial_size;
+}
+
+#endif // CSLIBS_NDT_COMMON_HASH_STORAGE_HPP
@@ -0,0 +1,158 @@
+#ifndef CSLIBS_NDT_COMMON_MERGE_TRANSFORM_HPP
+#define CSLIBS_NDT_COMMON_MERGE_TRANSFORM_HPP
+
+#include <array>
+#include <cmath>
+#include <type_traits>
+
+#include <cslibs_math/statistics/distribution.hpp>
+#include <cslibs_math/common/mod.hpp>
+
+namespace cslibs_ndt {
+/**
+ * @brief Relative transformation used to merge a source map into a target map
+ *        of equal resolution. Cell statistics are moved into the target world
+ *        frame analytically. If the source grid is only shifted by whole
+ *        bundles, every source cell coincides with exactly one target cell and
+ *        the maps can be fused cell by cell, otherwise source cells have to be
+ *        inserted into the target bundles containing their centers.
+ */
+template <std::size_t Dim>
+class MergeTransform
+{
+public:
+    using index_t        = std::array<int, Dim>;
+    using distribution_t = cslibs_math::statistics::Distribution<Dim, 3>;
+    using sample_t       = typename distribution_t::sample_t;
+    using covariance_t   = typename distribution_t::covariance_t;
+    using rotation_t     = Eigen::Matrix<double, Dim, Dim>;
+
+    /**
+     * @param w_T_o                 source world to target world
+     * @param m_T_o                 source map to target map
+     * @param bundle_resolution_inv inverse bundle resolution of both maps
+     */
+    template <typename transform_t>
+    inline MergeTransform(const transform_t &w_T_o,
+                          const transform_t &m_T_o,
+                          const double       bundle_resolution_inv)
+    {
+        decompose(w_T_o, w_R_o_, w_t_o_);
+        decompose(m_T_o, m_R_o_, m_t_o_);
+        m_t_o_ *= bundle_resolution_inv;
+
+        aligned_ = m_R_o_.isIdentity(eps);
+        for (std::size_t i = 0 ; i < Dim ; ++ i) {
+            offset_[i] = static_cast<int>(std::round(m_t_o_(i)));
+            aligned_  &= std::abs(m_t_o_(i) - offset_[i]) < eps;
+        }
+    }
+
+    inline bool isAligned() const
+    {
+        return aligned_;
+    }
+
+    /**
+     * @brief Target bundle of a source bundle, only valid for aligned maps.
+     */
+    inline index_t bundle(const index_t &bi) const
+    {
+        index_t b;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            b[i] = bi[i] + offset_[i];
+        return b;
+    }
+
+    /**
+     * @brief Target storage and cell of a source cell, only valid for aligned
+     *        maps. Cell c of storage s covers the bundles 2 c - s_i and
+     *        2 c - s_i + 1 along axis i, where s_i is bit i of s.
+     */
+    inline void cell(std::size_t &s,
+                     index_t     &c) const
+    {
+        std::size_t t = 0;
+        for (std::size_t i = 0 ; i < Dim ; ++ i) {
+            const int first = 2 * c[i] - static_cast<int>((s >> i) & 1ul) + offset_[i];
+            const int bit   = cslibs_math::common::mod<int>(first, 2);
+            c[i] = (first + bit) / 2;
+            t   |= static_cast<std::size_t>(bit) << i;
+        }
+        s = t;
+    }
+
+    /**
+     * @brief Target bundle containing the center of a source cell.
+     */
+    inline index_t center(const std::size_t  s,
+                          const index_t     &c) const
+    {
+        sample_t u;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            u(i) = 2 * c[i] - static_cast<int>((s >> i) & 1ul) + 1;
+
+        const sample_t v = m_R_o_ * u + m_t_o_;
+        index_t b;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            b[i] = static_cast<int>(std::floor(v(i)));
+        return b;
+    }
+
+    /**
+     * @brief Source statistics expressed in the target world frame.
+     */
+    inline distribution_t apply(const distribution_t &d) const
+    {
+        if (d.getN() == 0)
+            return d;
+
+        const sample_t     mean = w_R_o_ * d.getMean();
+        const sample_t     m    = mean + w_t_o_;
+        const covariance_t corr = w_R_o_ * d.getCorrelated() * w_R_o_.transpose() +
+                                  m * m.transpose() - mean * mean.transpose();
+        return distribution_t(d.getN(), m, corr);
+    }
+
+private:
+    static constexpr double eps = 1e-6;
+
+    rotation_t w_R_o_;
+    sample_t   w_t_o_;
+    rotation_t m_R_o_;
+    sample_t   m_t_o_;      ///< in bundles
+    index_t    offset_;
+    bool       aligned_;
+
+    template <typename transform_t>
+    inline static void decompose(const transform_t &T,
+                                 rotation_t        &R,
+                                 sample_t          &t)
+    {
+        using point_t = typename std::decay<decltype(T.translation())>::type;
+
+        point_t zero;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            zero(i) = 0.0;
+
+        const point_t o = T * zero;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            t(i) = o(i);
+        for (std::size_t j = 0 ; j < Dim ; ++ j) {
+            point_t e = zero;
+            e(j) = 1.0;
+            const point_t r = T * e;
+            for (std::size_t i = 0 ; i < Dim ; ++ i)
+                R(i, j) = r(i) - o(i);
+        }
+    }
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+template <std::size_t Dim>
+constexpr double MergeTransform<Dim>::eps;
+}
+
+#endif // CSLIBS_NDT_COMMON_MERGE_TRANSFORM_HPP
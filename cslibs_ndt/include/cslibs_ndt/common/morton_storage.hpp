@@ -0,0 +1,224 @@
+#ifndef CSLIBS_NDT_COMMON_MORTON_STORAGE_HPP
+#define CSLIBS_NDT_COMMON_MORTON_STORAGE_HPP
+
+#include <cslibs_ndt/common/hash_storage.hpp>
+#include <cslibs_ndt/common/radix_sort.hpp>
+
+#include <array>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <algorithm>
+
+namespace cslibs_ndt {
+/**
+ * @brief Morton (Z-order) codes of signed grid indices. Every coordinate is
+ *        offset to be non-negative and contributes 64 / Dim bits, indices
+ *        outside of that range are wrapped and only lose their ordering.
+ */
+template <std::size_t Dim>
+struct morton {
+    using index_t = std::array<int, Dim>;
+    using code_t  = std::uint64_t;
+
+    static constexpr std::size_t bits = 64 / Dim;
+
+    inline static code_t encode(const index_t &index)
+    {
+        code_t code = 0;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            code |= spread(offset(index[i])) << i;
+        return code;
+    }
+
+    inline static index_t decode(const code_t code)
+    {
+        index_t index;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            index[i] = static_cast<int>(static_cast<std::int64_t>(compact(code >> i)) - bias());
+        return index;
+    }
+
+private:
+    inline static constexpr std::int64_t bias()
+    {
+        return static_cast<std::int64_t>(1) << (bits - 1);
+    }
+
+    inline static constexpr code_t mask()
+    {
+        return bits >= 64 ? ~static_cast<code_t>(0) : (static_cast<code_t>(1) << bits) - 1;
+    }
+
+    inline static code_t offset(const int i)
+    {
+        return static_cast<code_t>(static_cast<std::int64_t>(i) + bias()) & mask();
+    }
+
+    inline static code_t spread(const code_t v)
+    {
+        code_t s = 0;
+        for (std::size_t b = 0 ; b < bits ; ++ b)
+            s |= ((v >> b) & 1ull) << (b * Dim);
+        return s;
+    }
+
+    inline static code_t compact(const code_t s)
+    {
+        code_t v = 0;
+        for (std::size_t b = 0 ; b < bits ; ++ b)
+            v |= ((s >> (b * Dim)) & 1ull) << b;
+        return v;
+    }
+};
+
+template <>
+inline morton<2>::code_t morton<2>::spread(const code_t v)
+{
+    code_t x = v & 0x00000000ffffffffull;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+    x = (x | (x << 8))  & 0x00ff00ff00ff00ffull;
+    x = (x | (x << 4))  & 0x0f0f0f0f0f0f0f0full;
+    x = (x | (x << 2))  & 0x3333333333333333ull;
+    x = (x | (x << 1))  & 0x5555555555555555ull;
+    return x;
+}
+
+template <>
+inline morton<2>::code_t morton<2>::compact(const code_t s)
+{
+    code_t x = s & 0x5555555555555555ull;
+    x = (x | (x >> 1))  & 0x3333333333333333ull;
+    x = (x | (x >> 2))  & 0x0f0f0f0f0f0f0f0full;
+    x = (x | (x >> 4))  & 0x00ff00ff00ff00ffull;
+    x = (x | (x >> 8))  & 0x0000ffff0000ffffull;
+    x = (x | (x >> 16)) & 0x00000000ffffffffull;
+    return x;
+}
+
+template <>
+inline morton<3>::code_t morton<3>::spread(const code_t v)
+{
+    code_t x = v & 0x1fffffull;
+    x = (x | (x << 32)) & 0x001f00000000ffffull;
+    x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+    x = (x | (x << 8))  & 0x100f00f00f00f00full;
+    x = (x | (x << 4))  & 0x10c30c30c30c30c3ull;
+    x = (x | (x << 2))  & 0x1249249249249249ull;
+    return x;
+}
+
+template <>
+inline morton<3>::code_t morton<3>::compact(const code_t s)
+{
+    code_t x = s & 0x1249249249249249ull;
+    x = (x | (x >> 2))  & 0x10c30c30c30c30c3ull;
+    x = (x | (x >> 4))  & 0x100f00f00f00f00full;
+    x = (x | (x >> 8))  & 0x001f0000ff0000ffull;
+    x = (x | (x >> 16)) & 0x001f00000000ffffull;
+    x = (x | (x >> 32)) & 0x1fffffull;
+    return x;
+}
+
+/**
+ * @brief Hash storage which visits its entries in Z-order of their indices.
+ *        Lookups go through the hash table, the Morton ordering is rebuilt
+ *        with a radix sort on the first traversal after new entries were
+ *        inserted, entries are never removed except by clear. Range
+ *        traversals only visit the key interval [code(min), code(max)].
+ */
+template <typename data_t, typename index_t>
+class MortonStorage : public HashStorage<data_t, index_t>
+{
+public:
+    using base_t   = HashStorage<data_t, index_t>;
+    using morton_t = morton<std::tuple_size<index_t>::value>;
+    using code_t   = typename morton_t::code_t;
+
+    inline MortonStorage() = default;
+
+    inline MortonStorage(const MortonStorage &other) :
+        base_t(other)
+    {
+    }
+
+    /**
+     * @brief Visit all entries in Z-order.
+     */
+    template <typename Fn>
+    inline void traverse(const Fn &fn)
+    {
+        const order_ptr_t o = order();
+        for (const order_entry_t &e : *o)
+            fn(base_t::values_[e.second].first, base_t::values_[e.second].second);
+    }
+
+    template <typename Fn>
+    inline void traverse(const Fn &fn) const
+    {
+        const order_ptr_t o = order();
+        for (const order_entry_t &e : *o)
+            fn(base_t::values_[e.second].first, base_t::values_[e.second].second);
+    }
+
+    /**
+     * @brief Visit all entries with indices in the box [min, max] in Z-order.
+     */
+    template <typename Fn>
+    inline void traverse(const index_t &min,
+                         const index_t &max,
+                         const Fn      &fn) const
+    {
+        const order_ptr_t o = order();
+        const code_t code_min = morton_t::encode(min);
+        const code_t code_max = morton_t::encode(max);
+        auto it = std::lower_bound(o->begin(), o->end(), order_entry_t(code_min, 0),
+                                   [](const order_entry_t &a, const order_entry_t &b) { return a.first < b.first; });
+        for (; it != o->end() && it->first <= code_max ; ++ it) {
+            const std::pair<index_t, data_t> &v = base_t::values_[it->second];
+            bool inside = true;
+            for (std::size_t i = 0 ; i < min.size() ; ++ i)
+                inside &= v.first[i] >= min[i] && v.first[i] <= max[i];
+            if (inside)
+                fn(v.first, v.second);
+        }
+    }
+
+    inline void clear()
+    {
+        base_t::clear();
+        std::unique_lock<std::mutex> l(order_mutex_);
+        order_.reset();
+    }
+
+private:
+    using order_entry_t = std::pair<std::size_t, std::size_t>;
+    using order_t       = std::vector<order_entry_t>;
+    using order_ptr_t   = std::shared_ptr<const order_t>;
+
+    mutable std::mutex  order_mutex_;
+    mutable order_ptr_t order_;
+
+    /// entries are only ever appended, so a size mismatch means the order is
+    /// stale, it is then rebuilt into a new vector and traversals already
+    /// running keep the one they started with
+    inline order_ptr_t order() const
+    {
+        std::unique_lock<std::mutex> l(order_mutex_);
+        if (!order_ || order_->size() != base_t::values_.size()) {
+            std::shared_ptr<order_t> o(new order_t);
+            o->reserve(base_t::values_.size());
+            for (std::size_t v = 0 ; v < base_t::values_.size() ; ++ v)
+                o->emplace_back(static_cast<std::size_t>(morton_t::encode(base_t::values_[v].first)), v);
+            radix_sort(*o, std::numeric_limits<std::size_t>::max());
+            order_ = o;
+        }
+        return order_;
+    }
+};
+}
+
+#endif // CSLIBS_NDT_COMMON_MORTON_STORAGE_HPP
@@ -2,6 +2,10 @@
 #define CSLIBS_NDT_COMMON_OCCUPANCY_DISTRIBUTION_HPP
 
 #include <mutex>
+#include <algorithm>
+
+#include <cslibs_ndt/common/arena.hpp>
+#include <cslibs_ndt/common/decay.hpp>
 
 #include <cslibs_math/statistics/distribution.hpp>
 #include <cslibs_gridmaps/utility/inverse_model.hpp>
@@ -27,19 +31,54 @@ public:
     using const_handle_t = cslibs_utility::synchronized::WrapAround<const OccupancyDistribution<Dim>>;
 
     inline OccupancyDistribution() :
-        num_free_(0)
+        num_free_(0),
+        stamp_(0.0),
+        weight_free_(0.0),
+        weight_occupied_(0.0)
     {
     }
 
     inline OccupancyDistribution(const std::size_t num_free) :
-        num_free_(num_free)
+        num_free_(num_free),
+        stamp_(0.0),
+        weight_free_(num_free),
+        weight_occupied_(0.0)
+    {
+    }
+
+    /**
+     * @brief Cell whose occupied statistics are allocated from the given arena.
+     */
+    inline explicit OccupancyDistribution(const Arena::Ptr &arena) :
+        num_free_(0),
+        arena_(arena),
+        stamp_(0.0),
+        weight_free_(0.0),
+        weight_occupied_(0.0)
+    {
+    }
+
+    /**
+     * @brief Cell whose evidence is forgotten as given by the decay of its map.
+     */
+    inline OccupancyDistribution(const Arena::Ptr &arena,
+                                 const Decay::Ptr &decay) :
+        num_free_(0),
+        arena_(arena),
+        decay_(decay),
+        stamp_(decay ? decay->getTime() : 0.0),
+        weight_free_(0.0),
+        weight_occupied_(0.0)
     {
     }
 
     inline OccupancyDistribution(const std::size_t    num_free,
                                  const distribution_t data) :
         num_free_(num_free),
-        distribution_(new distribution_t(data))
+        distribution_(new distribution_t(data)),
+        stamp_(0.0),
+        weight_free_(num_free),
+        weight_occupied_(data.getN())
     {
     }
 
@@ -47,37 +86,50 @@ public:
         num_free_(other.num_free_),
         distribution_(other.distribution_),
         occupancy_(other.occupancy_),
-        inverse_model_(other.inverse_model_)
+        inverse_model_(other.inverse_model_),
+        arena_(other.arena_),
+        decay_(other.decay_),
+        stamp_(other.stamp_),
+        weight_free_(other.weight_free_),
+        weight_occupied_(other.weight_occupied_)
     {
     }
 
     inline OccupancyDistribution& operator = (const OccupancyDistribution &other)
     {
-        num_free_      = other.num_free_;
-        distribution_  = other.distribution_;
-        occupancy_     = other.occupancy_;
-        inverse_model_ = other.inverse_model_;
+        num_free_        = other.num_free_;
+        distribution_    = other.distribution_;
+        occupancy_       = other.occupancy_;
+        inverse_model_   = other.inverse_model_;
+        arena_           = other.arena_;
+        decay_           = other.decay_;
+        stamp_           = other.stamp_;
+        weight_free_     = other.weight_free_;
+        weight_occupied_ = other.weight_occupied_;
         return *this;
     }
 
     inline void updateFree()
     {
+        age();
         ++ num_free_;
+        weight_free_ += 1.0;
         inverse_model_ = nullptr;
     }
 
     inline void updateFree(const std::size_t &num_free)
     {
+        age();
         num_free_ += num_free;
+        weight_free_ += num_free;
         inverse_model_ = nullptr;
     }
 
     inline void updateOccupied(const point_t & p)
     {
-        if (!distribution_)
-            distribution_.reset(new distribution_t());
-
-        distribution_->add(p);
+        age();
+        writable().add(p);
+        weight_occupied_ += 1.0;
         inverse_model_ = nullptr;
     }
 
@@ -86,10 +138,37 @@ public:
         if (!d)
             return;
 
-        if (!distribution_)
-            distribution_.reset(new distribution_t());
+        age();
+        writable() += *d;
+        weight_occupied_ += d->getN();
+        inverse_model_ = nullptr;
+    }
 
-        *distribution_ += *d;
+    /**
+     * @brief Take back free counts and occupied statistics which were added
+     *        to this cell before.
+     */
+    inline void remove(const std::size_t     num_free,
+                       const distribution_t *d)
+    {
+        age();
+        num_free_ -= std::min(num_free_, num_free);
+        weight_free_ = std::max(0.0, weight_free_ - num_free);
+        if (d)
+            weight_occupied_ = std::max(0.0, weight_occupied_ - d->getN());
+        if (d && distribution_) {
+            const std::size_t n = distribution_->getN();
+            if (n <= d->getN()) {
+                distribution_.reset();
+            } else {
+                const double w   = static_cast<double>(n) / static_cast<double>(n - d->getN());
+                const double w_d = w - 1.0;
+                const distribution_t rest(n - d->getN(),
+                                          distribution_->getMean() * w - d->getMean() * w_d,
+                                          distribution_->getCorrelated() * w - d->getCorrelated() * w_d);
+                writable() = rest;
+            }
+        }
         inverse_model_ = nullptr;
     }
 
@@ -108,33 +187,117 @@ public:
         if (!inverse_model)
             throw std::runtime_error("inverse model not set!");
 
+        /// decayed occupancy changes with the clock, so it is not cached
+        if (decay_ && decay_->enabled()) {
+            const double f = decay_->factor(stamp_, decay_->getTime());
+            return occupancy(weight_free_ * f, weight_occupied_ * f, inverse_model);
+        }
+
         if (inverse_model == inverse_model_)
             return occupancy_;
 
         inverse_model_ = inverse_model;
-        occupancy_ = distribution_ ?
-                    cslibs_math::common::LogOdds::from(
-                        num_free_ * inverse_model_->getLogOddsFree() +
-                        distribution_->getN() * inverse_model_->getLogOddsOccupied() -
-                        (num_free_ + distribution_->getN()) * inverse_model_->getLogOddsPrior()) :
-                    cslibs_math::common::LogOdds::from(
-                        num_free_ * inverse_model_->getLogOddsFree() -
-                        num_free_ * inverse_model_->getLogOddsPrior());
+        occupancy_ = occupancy(num_free_, numOccupied(), inverse_model_);
         return occupancy_;
     }
 
+    /**
+     * @brief Occupancy probability of a cell with the given hit and miss counts,
+     *        decayed counts may be fractional.
+     */
+    inline static double occupancy(const double num_free,
+                                   const double num_occupied,
+                                   const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model)
+    {
+        return cslibs_math::common::LogOdds::from(
+                    num_free * inverse_model->getLogOddsFree() +
+                    num_occupied * inverse_model->getLogOddsOccupied() -
+                    (num_free + num_occupied) * inverse_model->getLogOddsPrior());
+    }
+
     inline const distribution_ptr_t &getDistribution() const
     {
         return distribution_;
     }
 
+    /**
+     * @brief Replace the occupied statistics, e.g. when reading a cell, their
+     *        samples count as occupied evidence of the current time.
+     */
+    inline void setDistribution(const distribution_t &d)
+    {
+        age();
+        distribution_ = d.getN() > 0 ? Arena::make<distribution_t>(arena_, d) : distribution_ptr_t();
+        weight_occupied_ = d.getN();
+        inverse_model_ = nullptr;
+    }
+
+    inline const Decay::Ptr &getDecay() const
+    {
+        return decay_;
+    }
+
+    /**
+     * @brief Free and occupied evidence as of getStamp(), equal to the raw
+     *        counts as long as the cell does not decay.
+     */
+    inline double getWeightFree() const
+    {
+        return weight_free_;
+    }
+
+    inline double getWeightOccupied() const
+    {
+        return weight_occupied_;
+    }
+
+    inline double getStamp() const
+    {
+        return stamp_;
+    }
+
+    /**
+     * @brief Forget evidence with the decay of the map which takes over this
+     *        cell, e.g. a cell loaded or copied from another map. Its current
+     *        weights count as evidence of the time of that decay.
+     */
+    inline void setDecay(const Decay::Ptr &decay)
+    {
+        age();
+        decay_ = decay;
+        stamp_ = decay ? decay->getTime() : 0.0;
+    }
+
     inline distribution_ptr_t &getDistribution()
     {
         return distribution_;
     }
 
-    inline void merge(const OccupancyDistribution&)
+    /**
+     * @brief Replace the occupied statistics by fn applied to them, e.g. to
+     *        express them in another frame. Counts and weights are kept.
+     */
+    template <typename fn_t>
+    inline void transform(const fn_t &fn)
+    {
+        if (distribution_)
+            distribution_ = Arena::make<distribution_t>(arena_, fn(*distribution_));
+        inverse_model_ = nullptr;
+    }
+
+    /**
+     * @brief Fuse free counts and occupied statistics of another cell into this one.
+     */
+    inline void merge(const OccupancyDistribution &other)
     {
+        age();
+        const double f = other.decay_ ? other.decay_->factor(other.stamp_, other.decay_->getTime()) : 1.0;
+        num_free_ += other.num_free_;
+        weight_free_ += other.weight_free_ * f;
+        weight_occupied_ += other.weight_occupied_ * f;
+        if (other.distribution_)
+            writable() += *other.distribution_;
+        inverse_model_ = nullptr;
     }
 
     inline handle_t getHandle()
@@ -160,6 +323,36 @@ private:
 
     mutable double                                      occupancy_;
     mutable cslibs_gridmaps::utility::InverseModel::Ptr inverse_model_;
+    Arena::Ptr                                          arena_;
+
+    /// raw counts stay untouched, the decayed weights are valid at stamp_
+    Decay::Ptr                                          decay_;
+    double                                              stamp_;
+    double                                              weight_free_;
+    double                                              weight_occupied_;
+
+    inline void age()
+    {
+        if (!decay_)
+            return;
+
+        const double time = decay_->getTime();
+        const double f    = decay_->factor(stamp_, time);
+        weight_free_     *= f;
+        weight_occupied_ *= f;
+        stamp_            = std::max(stamp_, time);
+    }
+
+    /// copies share their statistics until one of them is written, snapshots
+    /// rely on that to keep the statistics they hold unchanged
+    inline distribution_t& writable()
+    {
+        if (!distribution_)
+            distribution_ = Arena::make<distribution_t>(arena_);
+        else if (distribution_.use_count() > 1)
+            distribution_ = Arena::make<distribution_t>(arena_, *distribution_);
+        return *distribution_;
+    }
 } __attribute__ ((aligned (16)));
 }
 
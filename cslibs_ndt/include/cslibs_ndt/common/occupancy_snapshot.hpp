@@ -0,0 +1,174 @@
+#ifndef CSLIBS_NDT_COMMON_OCCUPANCY_SNAPSHOT_HPP
+#define CSLIBS_NDT_COMMON_OCCUPANCY_SNAPSHOT_HPP
+
+#include <cslibs_ndt/common/occupancy_distribution.hpp>
+#include <cslibs_ndt/common/hash_storage.hpp>
+#include <cslibs_ndt/common/decay.hpp>
+
+#include <cslibs_math/common/div.hpp>
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+namespace cslibs_ndt {
+/**
+ * @brief Immutable view of an occupancy map at one point in time. Bundles are
+ *        grouped in chunks of chunk_size bundles per axis, snapshots taken one
+ *        after another share all chunks which did not change in between, and
+ *        cells share their statistics with the map until the map writes them.
+ *        Cells decay with the half life and time of the map when the
+ *        snapshot was taken.
+ *        Nothing in a snapshot is modified after construction, so it can be
+ *        sampled from any number of threads without locking.
+ */
+template <std::size_t Dim, typename transform_t>
+class OccupancySnapshot
+{
+public:
+    using Ptr                = std::shared_ptr<const OccupancySnapshot>;
+    using index_t            = std::array<int, Dim>;
+    using distribution_t     = typename OccupancyDistribution<Dim>::distribution_t;
+    using distribution_ptr_t = std::shared_ptr<const distribution_t>;
+    using inverse_model_t    = cslibs_gridmaps::utility::InverseModel;
+
+    static constexpr std::size_t bundle_size = 1ul << Dim;
+    static constexpr int         chunk_size  = 8;
+
+    /// the weights are the decayed evidence as of stamp, as in the map
+    struct cell_t {
+        std::size_t        num_free        = 0;
+        distribution_ptr_t distribution;
+        double             weight_free     = 0.0;
+        double             weight_occupied = 0.0;
+        double             stamp           = 0.0;
+
+        inline double getOccupancy(const inverse_model_t::Ptr &ivm,
+                                   const Decay               &decay) const
+        {
+            if (decay.enabled()) {
+                const double f = decay.factor(stamp, decay.getTime());
+                return OccupancyDistribution<Dim>::occupancy(weight_free * f, weight_occupied * f, ivm);
+            }
+            return OccupancyDistribution<Dim>::occupancy(num_free, distribution ? distribution->getN() : 0ul, ivm);
+        }
+    };
+
+    using bundle_t    = std::array<cell_t, bundle_size>;
+    using chunk_t     = HashStorage<bundle_t, index_t>;
+    using chunk_ptr_t = std::shared_ptr<const chunk_t>;
+    using chunks_t    = HashStorage<chunk_ptr_t, index_t>;
+
+    /**
+     * @param decay decay of the map, its half life and time are frozen
+     */
+    inline OccupancySnapshot(const transform_t &m_T_w,
+                             const double       bundle_resolution_inv,
+                             const std::size_t  version,
+                             const chunks_t    &chunks,
+                             const Decay       &decay) :
+        m_T_w_(m_T_w),
+        bundle_resolution_inv_(bundle_resolution_inv),
+        version_(version),
+        chunks_(chunks)
+    {
+        decay_.setHalfLife(decay.getHalfLife());
+        decay_.setTime(decay.getTime());
+    }
+
+    /**
+     * @brief Snapshots of the same map are numbered in the order they were taken.
+     */
+    inline std::size_t getVersion() const
+    {
+        return version_;
+    }
+
+    inline const chunks_t& getChunks() const
+    {
+        return chunks_;
+    }
+
+    /**
+     * @brief Decay as of the time the snapshot was taken.
+     */
+    inline const Decay& getDecay() const
+    {
+        return decay_;
+    }
+
+    inline const bundle_t* getBundle(const index_t &bi) const
+    {
+        const chunk_ptr_t *c = chunks_.get(chunkIndex(bi));
+        return c ? (*c)->get(bi) : nullptr;
+    }
+
+    template <typename point_t>
+    inline double sample(const point_t &p,
+                         const inverse_model_t::Ptr &ivm) const
+    {
+        return evaluate(p, ivm, [&p](const distribution_t &d) { return d.sample(p); });
+    }
+
+    template <typename point_t>
+    inline double sampleNonNormalized(const point_t &p,
+                                      const inverse_model_t::Ptr &ivm) const
+    {
+        return evaluate(p, ivm, [&p](const distribution_t &d) { return d.sampleNonNormalized(p); });
+    }
+
+    template <typename Fn>
+    inline void traverse(const Fn &fn) const
+    {
+        chunks_.traverse([&fn](const index_t &, const chunk_ptr_t &c) {
+            c->traverse(fn);
+        });
+    }
+
+    inline static index_t chunkIndex(const index_t &bi)
+    {
+        index_t ci;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            ci[i] = cslibs_math::common::div<int>(bi[i], chunk_size);
+        return ci;
+    }
+
+private:
+    const transform_t m_T_w_;
+    const double      bundle_resolution_inv_;
+    const std::size_t version_;
+    const chunks_t    chunks_;
+    Decay             decay_;
+
+    template <typename point_t, typename sample_t>
+    inline double evaluate(const point_t &p,
+                           const inverse_model_t::Ptr &ivm,
+                           const sample_t &sample) const
+    {
+        if (!ivm)
+            throw std::runtime_error("[OccupancySnapshot]: inverse model not set");
+
+        const point_t p_m = m_T_w_ * p;
+        index_t bi;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            bi[i] = static_cast<int>(std::floor(p_m(i) * bundle_resolution_inv_));
+
+        const bundle_t *bundle = getBundle(bi);
+        if (!bundle)
+            return 0.0;
+
+        double s = 0.0;
+        for (const cell_t &c : *bundle)
+            s += c.distribution ? sample(*c.distribution) * c.getOccupancy(ivm, decay_) : 0.0;
+        return s / static_cast<double>(bundle_size);
+    }
+};
+
+template <std::size_t Dim, typename transform_t>
+constexpr std::size_t OccupancySnapshot<Dim, transform_t>::bundle_size;
+template <std::size_t Dim, typename transform_t>
+constexpr int OccupancySnapshot<Dim, transform_t>::chunk_size;
+}
+
+#endif // CSLIBS_NDT_COMMON_OCCUPANCY_SNAPSHOT_HPP
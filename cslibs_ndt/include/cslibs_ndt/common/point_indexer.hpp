@@ -0,0 +1,106 @@
+#ifndef CSLIBS_NDT_COMMON_POINT_INDEXER_HPP
+#define CSLIBS_NDT_COMMON_POINT_INDEXER_HPP
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+namespace cslibs_ndt {
+/**
+ * @brief Transforms points into the world frame and computes their bundle
+ *        indices block-wise. Points are transformed one by one with the
+ *        given transformations, so that the world points and bundle indices
+ *        are exactly those of origin * p and toBundleIndex, and are then
+ *        scaled, floored and checked in branch free loops over fixed size
+ *        blocks of separate coordinate arrays, which can be vectorised.
+ */
+template <std::size_t Dim, typename pose_t, typename transform_t>
+class PointIndexer
+{
+public:
+    using index_t = std::array<int, Dim>;
+
+    static constexpr std::size_t block_size = 64;
+
+    /**
+     * @param origin                sensor pose in the world frame
+     * @param m_T_w                 world to map transformation
+     * @param bundle_resolution_inv inverse bundle resolution
+     */
+    inline explicit PointIndexer(const pose_t      &origin,
+                                 const transform_t &m_T_w,
+                                 const double       bundle_resolution_inv) :
+        origin_(origin),
+        m_T_w_(m_T_w),
+        bundle_resolution_inv_(bundle_resolution_inv)
+    {
+    }
+
+    /**
+     * @brief Call fn(p_w, bi) for every normal point of the cloud.
+     */
+    template <typename pointcloud_t, typename Fn>
+    inline void apply(const pointcloud_t &points,
+                      const Fn           &fn) const
+    {
+        using point_t = typename std::decay<decltype(*points.begin())>::type;
+
+        std::array<point_t, block_size>                 p_w;
+        std::array<std::array<double, block_size>, Dim> p_m;
+        std::array<std::array<int,    block_size>, Dim> bi;
+        std::array<bool, block_size>                    valid;
+
+        auto it = points.begin();
+        const auto end = points.end();
+        while (it != end) {
+            /// transform one block of points into world and map coordinates
+            std::size_t n = 0;
+            for (; n < block_size && it != end ; ++ n, ++ it) {
+                p_w[n] = origin_ * (*it);
+                valid[n] = p_w[n].isNormal();
+                const point_t pm = m_T_w_ * p_w[n];
+                for (std::size_t i = 0 ; i < Dim ; ++ i)
+                    p_m[i][n] = pm(i);
+            }
+
+            /// bundle indices
+            for (std::size_t i = 0 ; i < Dim ; ++ i) {
+                const double *pm = p_m[i].data();
+                int          *pb = bi[i].data();
+                for (std::size_t k = 0 ; k < n ; ++ k)
+                    pb[k] = static_cast<int>(std::floor(clamp(pm[k] * bundle_resolution_inv_)));
+            }
+
+            for (std::size_t k = 0 ; k < n ; ++ k) {
+                if (!valid[k])
+                    continue;
+
+                index_t b;
+                for (std::size_t i = 0 ; i < Dim ; ++ i)
+                    b[i] = bi[i][k];
+                fn(p_w[k], b);
+            }
+        }
+    }
+
+private:
+    const pose_t      &origin_;
+    const transform_t &m_T_w_;
+    const double       bundle_resolution_inv_;
+
+    /// keeps the int conversion defined for non-finite points, which are dropped anyway
+    static inline double clamp(const double v)
+    {
+        const double lo = static_cast<double>(std::numeric_limits<int>::lowest());
+        const double hi = static_cast<double>(std::numeric_limits<int>::max());
+        return std::max(lo, std::min(hi, v));
+    }
+};
+
+template <std::size_t Dim, typename pose_t, typename transform_t>
+constexpr std::size_t PointIndexer<Dim, pose_t, transform_t>::block_size;
+}
+
+#endif // CSLIBS_NDT_COMMON_POINT_INDEXER_HPP
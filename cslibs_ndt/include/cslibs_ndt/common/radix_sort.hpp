@@ -0,0 +1,46 @@
+#ifndef CSLIBS_NDT_COMMON_RADIX_SORT_HPP
+#define CSLIBS_NDT_COMMON_RADIX_SORT_HPP
+
+#include <array>
+#include <vector>
+#include <utility>
+
+namespace cslibs_ndt {
+/**
+ * @brief Stable LSD radix sort of (key, value) pairs with 8 bit digits, only
+ *        as many passes are done as there are digits in max_key.
+ * @param data    pairs to sort by their key
+ * @param buffer  scratch space, resized to the size of data
+ * @param max_key upper bound of all keys
+ */
+template <typename T>
+inline void radix_sort(std::vector<std::pair<std::size_t, T>> &data,
+                       std::vector<std::pair<std::size_t, T>> &buffer,
+                       const std::size_t                       max_key)
+{
+    using count_t = std::array<std::size_t, 257>;
+
+    buffer.resize(data.size());
+    for (std::size_t shift = 0 ; shift < 64 && (max_key >> shift) > 0 ; shift += 8) {
+        count_t count;
+        count.fill(0);
+        for (const std::pair<std::size_t, T> &d : data)
+            ++ count[((d.first >> shift) & 0xff) + 1];
+        for (std::size_t i = 1 ; i < count.size() ; ++ i)
+            count[i] += count[i - 1];
+        for (const std::pair<std::size_t, T> &d : data)
+            buffer[count[(d.first >> shift) & 0xff] ++] = d;
+        data.swap(buffer);
+    }
+}
+
+template <typename T>
+inline void radix_sort(std::vector<std::pair<std::size_t, T>> &data,
+                       const std::size_t                       max_key)
+{
+    std::vector<std::pair<std::size_t, T>> buffer;
+    radix_sort(data, buffer, max_key);
+}
+}
+
+#endif // CSLIBS_NDT_COMMON_RADIX_SORT_HPP
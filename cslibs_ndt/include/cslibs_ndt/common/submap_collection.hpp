@@ -0,0 +1,325 @@
+#ifndef CSLIBS_NDT_COMMON_SUBMAP_COLLECTION_HPP
+#define CSLIBS_NDT_COMMON_SUBMAP_COLLECTION_HPP
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cslibs_ndt/common/hash_storage.hpp>
+
+namespace cslibs_ndt {
+/**
+ * @brief Collection of dynamic maps which each keep their own local frame.
+ *        Submaps are anchored in the world frame by a transformation that can
+ *        be replaced at any time, e.g. after a pose graph optimisation, without
+ *        touching the cells of the map. World queries are routed to the
+ *        submaps through a coarse grid over the world bounds of the submaps.
+ */
+template <typename map_t>
+class SubmapCollection
+{
+public:
+    using Ptr         = std::shared_ptr<SubmapCollection<map_t>>;
+    using map_ptr_t   = typename map_t::Ptr;
+    using pose_t      = typename map_t::pose_t;
+    using transform_t = typename map_t::transform_t;
+    using point_t     = typename map_t::point_t;
+    using index_t     = typename map_t::index_t;
+    using mutex_t     = std::mutex;
+    using lock_t      = std::unique_lock<mutex_t>;
+
+    static constexpr std::size_t dim = std::tuple_size<index_t>::value;
+
+    /**
+     * @param resolution       resolution of the submaps
+     * @param index_resolution cell size of the grid routing queries to submaps
+     */
+    inline explicit SubmapCollection(const double resolution,
+                                     const double index_resolution = 10.0) :
+        resolution_(resolution),
+        index_resolution_inv_(1.0 / index_resolution)
+    {
+    }
+
+    /**
+     * @brief Create an empty submap anchored at w_T_s.
+     * @return id of the submap
+     */
+    inline std::size_t addSubmap(const pose_t &w_T_s)
+    {
+        lock_t l(mutex_);
+        submaps_.emplace_back(map_ptr_t(new map_t(pose_t(), resolution_)), w_T_s);
+        return submaps_.size() - 1;
+    }
+
+    inline std::size_t size() const
+    {
+        lock_t l(mutex_);
+        return submaps_.size();
+    }
+
+    inline double getResolution() const
+    {
+        return resolution_;
+    }
+
+    /**
+     * @brief The submap itself, its cells are expressed in the submap frame.
+     */
+    inline map_ptr_t getSubmap(const std::size_t id) const
+    {
+        lock_t l(mutex_);
+        return at(id).map;
+    }
+
+    inline pose_t getAnchor(const std::size_t id) const
+    {
+        lock_t l(mutex_);
+        return at(id).w_T_s;
+    }
+
+    /**
+     * @brief Move a submap to a new anchor, the cells of the map stay as they
+     *        are, only the routing grid is updated.
+     */
+    inline void setAnchor(const std::size_t id,
+                          const pose_t     &w_T_s)
+    {
+        lock_t l(mutex_);
+        submap_t &s = at(id);
+        s.w_T_s = w_T_s;
+        s.s_T_w = s.w_T_s.inverse();
+        updateBounds(id);
+    }
+
+    /**
+     * @brief Add a point given in the world frame to a submap.
+     */
+    inline void add(const std::size_t id,
+                    const point_t    &p_w)
+    {
+        lock_t l(mutex_);
+        submap_t &s = at(id);
+        s.map->add(s.s_T_w * p_w);
+        updateBounds(id);
+    }
+
+    /**
+     * @brief Insert a point cloud into a submap, the sensor origin is given in
+     *        the world frame.
+     */
+    template <typename points_t, typename... args_t>
+    inline void insert(const std::size_t  id,
+                       const pose_t      &origin,
+                       const points_t    &points,
+                       const args_t &...  args)
+    {
+        lock_t l(mutex_);
+        submap_t &s = at(id);
+        s.map->insert(s.s_T_w * origin, points, args...);
+        updateBounds(id);
+    }
+
+    /**
+     * @brief Ids of the submaps whose bounds contain the world point.
+     */
+    inline void getSubmaps(const point_t            &p_w,
+                           std::vector<std::size_t> &ids) const
+    {
+        lock_t l(mutex_);
+        route(p_w, ids);
+    }
+
+    /**
+     * @brief Sample at a world point, overlapping submaps are combined by
+     *        taking the maximum.
+     */
+    template <typename... args_t>
+    inline double sample(const point_t    &p_w,
+                         const args_t &... args) const
+    {
+        lock_t l(mutex_);
+        double s = 0.0;
+        visitSubmaps(p_w, [&s, &args...](const submap_t &submap, const point_t &p_s) {
+            s = std::max(s, submap.map->sample(p_s, args...));
+        });
+        return s;
+    }
+
+    template <typename... args_t>
+    inline double sampleNonNormalized(const point_t    &p_w,
+                                      const args_t &... args) const
+    {
+        lock_t l(mutex_);
+        double s = 0.0;
+        visitSubmaps(p_w, [&s, &args...](const submap_t &submap, const point_t &p_s) {
+            s = std::max(s, submap.map->sampleNonNormalized(p_s, args...));
+        });
+        return s;
+    }
+
+    /**
+     * @brief Fuse all submaps at their current anchors into one map, e.g. to
+     *        run the conversions of the single map types.
+     */
+    inline map_ptr_t toMap(const pose_t &origin = pose_t()) const
+    {
+        lock_t l(mutex_);
+        const map_ptr_t map(new map_t(origin, resolution_));
+        for (const submap_t &s : submaps_)
+            map->merge(*s.map, s.w_T_s);
+        return map;
+    }
+
+private:
+    using cell_t = std::array<int, dim>;
+
+    struct submap_t {
+        inline submap_t(const map_ptr_t &m,
+                        const pose_t    &anchor) :
+            map(m),
+            w_T_s(anchor),
+            s_T_w(w_T_s.inverse()),
+            empty(true)
+        {
+        }
+
+        map_ptr_t   map;
+        transform_t w_T_s;
+        transform_t s_T_w;
+        bool        empty;
+        cell_t      min;    ///< routing cells covered by the world bounds
+        cell_t      max;
+    };
+
+    const double                                  resolution_;
+    const double                                  index_resolution_inv_;
+    mutable mutex_t                               mutex_;
+    std::vector<submap_t>                         submaps_;
+    HashStorage<std::vector<std::size_t>, cell_t> index_;
+
+    inline submap_t& at(const std::size_t id)
+    {
+        if (id >= submaps_.size())
+            throw std::out_of_range("[SubmapCollection]: unknown submap id");
+        return submaps_[id];
+    }
+
+    inline const submap_t& at(const std::size_t id) const
+    {
+        if (id >= submaps_.size())
+            throw std::out_of_range("[SubmapCollection]: unknown submap id");
+        return submaps_[id];
+    }
+
+    inline cell_t toCell(const point_t &p_w) const
+    {
+        cell_t c;
+        for (std::size_t i = 0 ; i < dim ; ++ i)
+            c[i] = static_cast<int>(std::floor(p_w(i) * index_resolution_inv_));
+        return c;
+    }
+
+    /// visits the cells of the box [min, max] in row-major order
+    template <typename Fn>
+    inline static void visit(const cell_t &min,
+                             const cell_t &max,
+                             const Fn     &fn)
+    {
+        cell_t c = min;
+        while (true) {
+            fn(c);
+            std::size_t i = 0;
+            for (; i < dim ; ++ i) {
+                if (++ c[i] <= max[i])
+                    break;
+                c[i] = min[i];
+            }
+            if (i == dim)
+                return;
+        }
+    }
+
+    /// world bounds are the box around the transformed corners of the map bounds
+    inline void updateBounds(const std::size_t id)
+    {
+        submap_t &s = submaps_[id];
+        const index_t min_index = s.map->getMinDistributionIndex();
+        const index_t max_index = s.map->getMaxDistributionIndex();
+        if (min_index[0] > max_index[0])
+            return;
+
+        const point_t lo = s.map->getMin();
+        const point_t hi = s.map->getMax();
+        cell_t min, max;
+        min.fill(std::numeric_limits<int>::max());
+        max.fill(std::numeric_limits<int>::min());
+        for (std::size_t k = 0 ; k < (1ul << dim) ; ++ k) {
+            point_t corner;
+            for (std::size_t i = 0 ; i < dim ; ++ i)
+                corner(i) = ((k >> i) & 1ul) ? hi(i) : lo(i);
+            const cell_t c = toCell(s.w_T_s * corner);
+            for (std::size_t i = 0 ; i < dim ; ++ i) {
+                min[i] = std::min(min[i], c[i]);
+                max[i] = std::max(max[i], c[i]);
+            }
+        }
+        if (!s.empty && min == s.min && max == s.max)
+            return;
+
+        if (!s.empty)
+            visit(s.min, s.max, [this, id](const cell_t &c) {
+                std::vector<std::size_t> *ids = index_.get(c);
+                if (ids)
+                    ids->erase(std::remove(ids->begin(), ids->end(), id), ids->end());
+            });
+        visit(min, max, [this, id](const cell_t &c) {
+            std::vector<std::size_t> *ids = index_.get(c);
+            (ids ? ids : &index_.insert(c, std::vector<std::size_t>()))->emplace_back(id);
+        });
+        s.empty = false;
+        s.min   = min;
+        s.max   = max;
+    }
+
+    inline void route(const point_t            &p_w,
+                      std::vector<std::size_t> &ids) const
+    {
+        const std::vector<std::size_t> *candidates = index_.get(toCell(p_w));
+        if (!candidates)
+            return;
+
+        for (const std::size_t id : *candidates) {
+            const submap_t &s   = submaps_[id];
+            const point_t   p_s = s.s_T_w * p_w;
+            const point_t   lo  = s.map->getMin();
+            const point_t   hi  = s.map->getMax();
+            bool inside = true;
+            for (std::size_t i = 0 ; i < dim ; ++ i)
+                inside &= p_s(i) >= lo(i) && p_s(i) < hi(i);
+            if (inside)
+                ids.emplace_back(id);
+        }
+    }
+
+    template <typename Fn>
+    inline void visitSubmaps(const point_t &p_w,
+                         const Fn      &fn) const
+    {
+        std::vector<std::size_t> ids;
+        route(p_w, ids);
+        for (const std::size_t id : ids)
+            fn(submaps_[id], submaps_[id].s_T_w * p_w);
+    }
+};
+
+template <typename map_t>
+constexpr std::size_t SubmapCollection<map_t>::dim;
+}
+
+#endif // CSLIBS_NDT_COMMON_SUBMAP_COLLECTION_HPP
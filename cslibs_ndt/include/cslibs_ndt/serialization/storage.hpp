@@ -7,12 +7,16 @@
 
 #include <cslibs_ndt/common/distribution.hpp>
 #include <cslibs_ndt/common/occupancy_distribution.hpp>
+#include <cslibs_ndt/common/executor.hpp>
 #include <cslibs_ndt/serialization/filesystem.hpp>
 
 #include <cslibs_math/serialization/array.hpp>
 #include <cslibs_math/serialization/distribution.hpp>
+#include <cslibs_math/common/div.hpp>
 
 #include <fstream>
+#include <limits>
+#include <algorithm>
 #include <yaml-cpp/yaml.h>
 
 namespace cis = cslibs_indexed_storage;
@@ -48,59 +52,626 @@ std::size_t read(std::ifstream &in, OccupancyDistribution<Size> &d)
     typename OccupancyDistribution<Size>::distribution_t tmp;
     std::size_t r = cslibs_math::serialization::distribution::binary<Size, 3>::read(in,tmp);
     if (tmp.getN() != 0)
-        d.getDistribution().reset(new typename OccupancyDistribution<Size>::distribution_t(tmp));
+        d.setDistribution(tmp);
     return sizeof(std::size_t) + r;
 }
 
-template <template <std::size_t> class T, std::size_t Size, std::size_t Dim>
-struct binary {
-    using index_t      = std::array<int, Dim>;
-    using size_t       = std::array<std::size_t, Dim>;
-    using data_t       = T<Size>;
-    template <template <typename, typename, typename...> class be>
-    using storage_t    = cis::Storage<data_t, index_t, be>;
-    using kd_storage_t = storage_t<cis::backend::kdtree::KDTree>;
-    using ar_storage_t = storage_t<cis::backend::array::Array>;
+template <std::size_t Dim>
+struct linear {
+    using index_t = std::array<int, Dim>;
+    using size_t  = std::array<std::size_t, Dim>;
 
-    template <template <typename, typename, typename...> class be>
-    inline static bool save(const std::shared_ptr<storage_t<be>> &storage,
-                            const boost::filesystem::path        &path)
+    /// row-major addressing, the same as used by cis::backend::array::Array
+    inline static std::size_t to(const index_t &index,
+                                 const size_t  &size)
+    {
+        std::size_t l = 0;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            l = l * size[i] + static_cast<std::size_t>(index[i]);
+        return l;
+    }
+
+    inline static index_t from(std::size_t l,
+                               const size_t &size)
+    {
+        index_t index;
+        for (std::size_t i = Dim ; i > 0 ; -- i) {
+            index[i - 1] = static_cast<int>(l % size[i - 1]);
+            l /= size[i - 1];
+        }
+        return index;
+    }
+
+    inline static std::size_t count(const size_t &size)
     {
+        std::size_t c = 1;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            c *= size[i];
+        return c;
+    }
+
+    inline static bool save(const std::vector<index_t>      &indices,
+                            const size_t                    &size,
+                            const boost::filesystem::path   &path)
+    {
+        std::vector<std::size_t> data;
+        data.reserve(indices.size());
+        for (const index_t &index : indices)
+            data.emplace_back(to(index, size));
+        std::sort(data.begin(), data.end());
+
         std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
         if (!out.is_open()) {
             std::cerr << "Could not open '" << path.string() << "'\n";
             return false;
         }
+        writeHeader(size, data.size(), out);
+        out.write(reinterpret_cast<const char*>(data.data()),
+                  static_cast<std::streamsize>(data.size() * sizeof(std::size_t)));
+        out.close();
+        return true;
+    }
+
+    inline static bool load(const boost::filesystem::path &path,
+                            const size_t                  &size,
+                            std::vector<index_t>          &indices)
+    {
+        std::ifstream in(path.string(), std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Could not open '" << path.string() << "'\n";
+            return false;
+        }
 
-        auto write = [&out] (const index_t &index, const data_t &data) {
-            cslibs_math::serialization::array::binary<int, Dim>::write(index, out);
-            cslibs_ndt::write(data, out);
-        };
-        storage->traverse(write);
+        std::size_t n = 0;
+        if (!readHeader(in, size, n)) {
+            std::cerr << "Size mismatch in '" << path.string() << "'\n";
+            return false;
+        }
+
+        /// one bulk read, the indices are reconstructed arithmetically
+        std::vector<std::size_t> data(n);
+        in.read(reinterpret_cast<char*>(data.data()),
+                static_cast<std::streamsize>(n * sizeof(std::size_t)));
+        if (static_cast<std::size_t>(in.gcount()) != n * sizeof(std::size_t)) {
+            std::cerr << "Faild reading file '" << path.string() << "'\n";
+            return false;
+        }
+
+        indices.resize(n);
+        for (std::size_t i = 0 ; i < n ; ++ i)
+            indices[i] = from(data[i], size);
+        return true;
+    }
+
+    inline static void writeHeader(const size_t      &size,
+                                   const std::size_t &n,
+                                   std::ofstream     &out)
+    {
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            cslibs_math::serialization::io<std::size_t>::write(size[i], out);
+        cslibs_math::serialization::io<std::size_t>::write(n, out);
+    }
+
+    inline static bool readHeader(std::ifstream &in,
+                                  const size_t  &size,
+                                  std::size_t   &n)
+    {
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            if (cslibs_math::serialization::io<std::size_t>::read(in) != size[i])
+                return false;
+        n = cslibs_math::serialization::io<std::size_t>::read(in);
+        return static_cast<bool>(in);
+    }
+};
+
+/// Blocked layout for sparse storages: records are grouped by cubic blocks of
+/// block_size cells per dimension and an index file next to the data lists
+/// where the records of every block are, so a region can be read without
+/// touching the rest of the data.
+template <std::size_t Dim>
+struct blocks {
+    using index_t   = std::array<int, Dim>;
+    using range_t   = std::pair<std::size_t, std::size_t>;
+    using ranges_t  = std::vector<range_t>;
+
+    struct entry_t {
+        index_t     block;
+        std::size_t first;
+        std::size_t count;
+    };
+    using entries_t = std::vector<entry_t>;
+
+    static constexpr int default_size = 16;
+
+    inline static index_t of(const index_t &index,
+                             const int      block_size)
+    {
+        index_t block;
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            block[i] = cslibs_math::common::div<int>(index[i], block_size);
+        return block;
+    }
+
+    inline static bool contains(const index_t &index,
+                                const index_t &min,
+                                const index_t &max)
+    {
+        for (std::size_t i = 0 ; i < Dim ; ++ i)
+            if (index[i] < min[i] || index[i] > max[i])
+                return false;
+        return true;
+    }
+
+    inline static bool intersects(const index_t &block,
+                                  const int      block_size,
+                                  const index_t &min,
+                                  const index_t &max)
+    {
+        for (std::size_t i = 0 ; i < Dim ; ++ i) {
+            const long lo = static_cast<long>(block[i]) * block_size;
+            const long hi = lo + block_size - 1;
+            if (hi < min[i] || lo > max[i])
+                return false;
+        }
+        return true;
+    }
+
+    inline static boost::filesystem::path indexPath(const boost::filesystem::path &path)
+    {
+        boost::filesystem::path p(path);
+        return p.replace_extension(".idx");
+    }
+
+    /// sort the records by block and return the position of every block
+    template <typename T>
+    inline static entries_t group(std::vector<std::pair<index_t, T>> &records,
+                                  const int                           block_size)
+    {
+        std::sort(records.begin(), records.end(),
+                  [block_size](const std::pair<index_t, T> &a, const std::pair<index_t, T> &b) {
+            return of(a.first, block_size) < of(b.first, block_size);
+        });
+
+        entries_t entries;
+        for (std::size_t i = 0 ; i < records.size() ; ++ i) {
+            const index_t block = of(records[i].first, block_size);
+            if (entries.empty() || entries.back().block != block)
+                entries.emplace_back(entry_t{block, i, 0});
+            ++ entries.back().count;
+        }
+        return entries;
+    }
+
+    /// record ranges of all blocks intersecting [min, max], adjacent ranges are merged
+    inline static ranges_t select(const entries_t &entries,
+                                  const int        block_size,
+                                  const index_t   &min,
+                                  const index_t   &max)
+    {
+        ranges_t ranges;
+        for (const entry_t &e : entries) {
+            if (!intersects(e.block, block_size, min, max))
+                continue;
+            if (!ranges.empty() && ranges.back().second == e.first)
+                ranges.back().second += e.count;
+            else
+                ranges.emplace_back(e.first, e.first + e.count);
+        }
+        return ranges;
+    }
+
+    inline static bool saveIndex(const entries_t               &entries,
+                                 const int                      block_size,
+                                 const boost::filesystem::path &path)
+    {
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Could not open '" << path.string() << "'\n";
+            return false;
+        }
+        cslibs_math::serialization::io<std::size_t>::write(Dim, out);
+        cslibs_math::serialization::io<int>::write(block_size, out);
+        cslibs_math::serialization::io<std::size_t>::write(entries.size(), out);
+        for (const entry_t &e : entries) {
+            cslibs_math::serialization::array::binary<int, Dim>::write(e.block, out);
+            cslibs_math::serialization::io<std::size_t>::write(e.first, out);
+            cslibs_math::serialization::io<std::size_t>::write(e.count, out);
+        }
         out.close();
         return true;
     }
 
+    inline static bool loadIndex(const boost::filesystem::path &path,
+                                 int                           &block_size,
+                                 entries_t                     &entries)
+    {
+        std::ifstream in(path.string(), std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Could not open '" << path.string() << "'\n";
+            return false;
+        }
+        if (cslibs_math::serialization::io<std::size_t>::read(in) != Dim) {
+            std::cerr << "Dimension mismatch in '" << path.string() << "'\n";
+            return false;
+        }
+        block_size = cslibs_math::serialization::io<int>::read(in);
+        const std::size_t n = cslibs_math::serialization::io<std::size_t>::read(in);
+        if (!in || block_size <= 0) {
+            std::cerr << "Corrupted file '" << path.string() << "'\n";
+            return false;
+        }
+
+        entries.resize(n);
+        for (entry_t &e : entries) {
+            cslibs_math::serialization::array::binary<int, Dim>::read(in, e.block);
+            e.first = cslibs_math::serialization::io<std::size_t>::read(in);
+            e.count = cslibs_math::serialization::io<std::size_t>::read(in);
+        }
+        if (!in) {
+            std::cerr << "Faild reading file '" << path.string() << "'\n";
+            return false;
+        }
+        return true;
+    }
+
+    /// plain index lists, e.g. the bundle indices of a map
+    inline static bool save(const std::vector<index_t>    &indices,
+                            const int                      block_size,
+                            const boost::filesystem::path &path)
+    {
+        std::vector<std::pair<index_t, bool>> records;
+        records.reserve(indices.size());
+        for (const index_t &index : indices)
+            records.emplace_back(index, true);
+        const entries_t entries = group(records, block_size);
+
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Could not open '" << path.string() << "'\n";
+            return false;
+        }
+        for (const auto &r : records)
+            cslibs_math::serialization::array::binary<int, Dim>::write(r.first, out);
+        out.close();
+
+        return saveIndex(entries, block_size, indexPath(path));
+    }
+
     inline static bool load(const boost::filesystem::path &path,
-                            std::shared_ptr<kd_storage_t> &storage)
+                            const index_t                 &min,
+                            const index_t                 &max,
+                            std::vector<index_t>          &indices)
     {
-        storage.reset(new kd_storage_t);
-        return loadStorage(path, storage);
+        int       block_size;
+        entries_t entries;
+        if (!loadIndex(indexPath(path), block_size, entries))
+            return false;
+
+        std::ifstream in(path.string(), std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Could not open '" << path.string() << "'\n";
+            return false;
+        }
+
+        const std::size_t record_size = Dim * sizeof(int);
+        std::vector<int> buffer;
+        for (const range_t &r : select(entries, block_size, min, max)) {
+            buffer.resize((r.second - r.first) * Dim);
+            in.seekg(static_cast<std::streamoff>(r.first * record_size));
+            in.read(reinterpret_cast<char*>(buffer.data()),
+                    static_cast<std::streamsize>(buffer.size() * sizeof(int)));
+            if (!in) {
+                std::cerr << "Faild reading file '" << path.string() << "'\n";
+                return false;
+            }
+
+            index_t index;
+            for (std::size_t i = 0 ; i < buffer.size() ; i += Dim) {
+                std::copy(buffer.begin() + i, buffer.begin() + i + Dim, index.begin());
+                if (contains(index, min, max))
+                    indices.emplace_back(index);
+            }
+        }
+        return true;
+    }
+
+    inline static index_t lowest()
+    {
+        index_t index;
+        index.fill(std::numeric_limits<int>::min());
+        return index;
+    }
+
+    inline static index_t highest()
+    {
+        index_t index;
+        index.fill(std::numeric_limits<int>::max());
+        return index;
+    }
+};
+
+template <template <std::size_t> class T, std::size_t Size, std::size_t Dim>
+struct binary {
+    using index_t      = std::array<int, Dim>;
+    using size_t       = std::array<std::size_t, Dim>;
+    using data_t       = T<Size>;
+    template <template <typename, typename, typename...> class be>
+    using cis_storage_t = cis::Storage<data_t, index_t, be>;
+    using kd_storage_t  = cis_storage_t<cis::backend::kdtree::KDTree>;
+    using ar_storage_t  = cis_storage_t<cis::backend::array::Array>;
+    using linear_t     = linear<Dim>;
+    using blocks_t     = blocks<Dim>;
+    using jobs_t       = Executor::jobs_t;
+
+    /// records per job, smaller stores are handled by a single job
+    static constexpr std::size_t min_records = 4096;
+
+    /// All save and load methods taking a job list only do the serial part of
+    /// the work and append the rest to the list, which is then run on the
+    /// executor. Every record of a store has the same binary size, so each
+    /// job handles a contiguous range of records in the file.
+    template <typename storage_t>
+    inline static bool save(const std::shared_ptr<storage_t>     &storage,
+                            const boost::filesystem::path        &path)
+    {
+        jobs_t jobs;
+        return save(storage, path, jobs) && Executor::instance().run(jobs);
     }
 
+    template <typename storage_t>
+    inline static bool save(const std::shared_ptr<storage_t>     &storage,
+                            const boost::filesystem::path        &path,
+                            jobs_t                               &jobs)
+    {
+        std::shared_ptr<records_t<index_t>> records(new records_t<index_t>);
+        storage->traverse([&records] (const index_t &index, const data_t &data) {
+            records->emplace_back(index, &data);
+        });
+        return saveRecords(records, path, [](std::ofstream &) {}, jobs);
+    }
+
+    template <typename storage_t>
     inline static bool load(const boost::filesystem::path &path,
-                            std::shared_ptr<ar_storage_t> &storage,
+                            std::shared_ptr<storage_t>    &storage)
+    {
+        jobs_t jobs;
+        return load(path, storage, jobs) && Executor::instance().run(jobs);
+    }
+
+    template <typename storage_t>
+    inline static bool load(const boost::filesystem::path &path,
+                            std::shared_ptr<storage_t>    &storage,
+                            jobs_t                        &jobs)
+    {
+        storage.reset(new storage_t);
+        return loadRecords<index_t>(path, storage, 0, npos(), [](const index_t &i) { return i; }, jobs);
+    }
+
+    template <typename storage_t>
+    inline static bool load(const boost::filesystem::path &path,
+                            std::shared_ptr<storage_t>    &storage,
                             const size_t &size)
     {
-        storage.reset(new ar_storage_t);
+        jobs_t jobs;
+        return load(path, storage, size, jobs) && Executor::instance().run(jobs);
+    }
+
+    template <typename storage_t>
+    inline static bool load(const boost::filesystem::path &path,
+                            std::shared_ptr<storage_t>    &storage,
+                            const size_t &size,
+                            jobs_t       &jobs)
+    {
+        storage.reset(new storage_t);
         storage->template set<cis::option::tags::array_size>(size);
-        return loadStorage(path, storage);
+        return loadRecords<index_t>(path, storage, 0, npos(), [](const index_t &i) { return i; }, jobs);
+    }
+
+    /// dense format for array storages: a header with the array size and the
+    /// number of records, followed by the records in row-major order of the
+    /// array, each addressed by its linear index
+    template <typename storage_t>
+    inline static bool saveDense(const std::shared_ptr<storage_t>    &storage,
+                                 const size_t                        &size,
+                                 const boost::filesystem::path       &path)
+    {
+        jobs_t jobs;
+        return saveDense(storage, size, path, jobs) && Executor::instance().run(jobs);
+    }
+
+    template <typename storage_t>
+    inline static bool saveDense(const std::shared_ptr<storage_t>    &storage,
+                                 const size_t                        &size,
+                                 const boost::filesystem::path       &path,
+                                 jobs_t                              &jobs)
+    {
+        std::shared_ptr<records_t<std::size_t>> records(new records_t<std::size_t>);
+        storage->traverse([&records, &size] (const index_t &index, const data_t &data) {
+            records->emplace_back(linear_t::to(index, size), &data);
+        });
+        std::sort(records->begin(), records->end(),
+                  [](const std::pair<std::size_t, const data_t*> &a,
+                     const std::pair<std::size_t, const data_t*> &b) { return a.first < b.first; });
+
+        const std::size_t n = records->size();
+        return saveRecords(records, path, [&size, n](std::ofstream &out) { linear_t::writeHeader(size, n, out); }, jobs);
+    }
+
+    template <typename storage_t>
+    inline static bool loadDense(const boost::filesystem::path &path,
+                                 std::shared_ptr<storage_t>    &storage,
+                                 const size_t                  &size)
+    {
+        jobs_t jobs;
+        return loadDense(path, storage, size, jobs) && Executor::instance().run(jobs);
+    }
+
+    template <typename storage_t>
+    inline static bool loadDense(const boost::filesystem::path &path,
+                                 std::shared_ptr<storage_t>    &storage,
+                                 const size_t                  &size,
+                                 jobs_t                        &jobs)
+    {
+        storage.reset(new storage_t);
+        storage->template set<cis::option::tags::array_size>(size);
+
+        std::ifstream in(path.string(), std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Could not open '" << path.string() << "'\n";
+            return false;
+        }
+        std::size_t n = 0;
+        if (!linear_t::readHeader(in, size, n)) {
+            std::cerr << "Size mismatch in '" << path.string() << "'\n";
+            return false;
+        }
+        const std::size_t offset = static_cast<std::size_t>(in.tellg());
+        in.close();
+
+        return loadRecords<std::size_t>(path, storage, offset, n,
+                                        [size](const std::size_t &l) { return linear_t::from(l, size); }, jobs);
+    }
+
+    /// blocked format for sparse storages, the records are written grouped by
+    /// blocks and the block positions go to an index file next to the data,
+    /// see blocks; the data file itself stays readable by load
+    template <typename storage_t>
+    inline static bool saveBlocked(const std::shared_ptr<storage_t>     &storage,
+                                   const boost::filesystem::path        &path,
+                                   const int                             block_size,
+                                   jobs_t                               &jobs)
+    {
+        std::shared_ptr<records_t<index_t>> records(new records_t<index_t>);
+        storage->traverse([&records] (const index_t &index, const data_t &data) {
+            records->emplace_back(index, &data);
+        });
+        const typename blocks_t::entries_t entries = blocks_t::group(*records, block_size);
+        return blocks_t::saveIndex(entries, block_size, blocks_t::indexPath(path)) &&
+                saveRecords(records, path, [](std::ofstream &) {}, jobs);
+    }
+
+    /// load all records with indices in [min, max], only blocks intersecting
+    /// the region are read if there is a block index, otherwise the whole file
+    /// is scanned
+    template <typename storage_t>
+    inline static bool load(const boost::filesystem::path &path,
+                            std::shared_ptr<storage_t>    &storage,
+                            const index_t                 &min,
+                            const index_t                 &max,
+                            jobs_t                        &jobs)
+    {
+        storage.reset(new storage_t);
+
+        std::size_t n = 0;
+        std::size_t record_size = 0;
+        if (!recordSize<index_t>(path, 0, record_size, n))
+            return false;
+
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        const boost::filesystem::path path_index = blocks_t::indexPath(path);
+        if (boost::filesystem::exists(path_index)) {
+            int block_size;
+            typename blocks_t::entries_t entries;
+            if (!blocks_t::loadIndex(path_index, block_size, entries))
+                return false;
+            for (const auto &r : blocks_t::select(entries, block_size, min, max)) {
+                if (r.second > n) {
+                    std::cerr << "Index out of range in '" << path_index.string() << "'\n";
+                    return false;
+                }
+                for (const auto &s : Executor::instance().split(r.second - r.first, min_records))
+                    ranges.emplace_back(r.first + s.first, r.first + s.second);
+            }
+        } else {
+            ranges = Executor::instance().split(n, min_records);
+        }
+
+        loadRanges<index_t>(path, storage, 0, record_size, ranges,
+                            [](const index_t &i) { return i; },
+                            [min, max](const index_t &i) { return blocks_t::contains(i, min, max); }, jobs);
+        return true;
     }
 
 private:
-    template <template <typename, typename, typename...> class be>
-    inline static bool loadStorage(const boost::filesystem::path  &path,
-                                   std::shared_ptr<storage_t<be>> &storage)
+    template <typename key_t>
+    using records_t = std::vector<std::pair<key_t, const data_t*>>;
+
+    inline static constexpr std::size_t npos()
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    inline static void writeKey(const index_t &key, std::ofstream &out)
+    {
+        cslibs_math::serialization::array::binary<int, Dim>::write(key, out);
+    }
+
+    inline static void writeKey(const std::size_t &key, std::ofstream &out)
+    {
+        cslibs_math::serialization::io<std::size_t>::write(key, out);
+    }
+
+    inline static std::size_t readKey(std::ifstream &in, index_t &key)
+    {
+        return cslibs_math::serialization::array::binary<int, Dim>::read(in, key);
+    }
+
+    inline static std::size_t readKey(std::ifstream &in, std::size_t &key)
+    {
+        key = cslibs_math::serialization::io<std::size_t>::read(in);
+        return sizeof(std::size_t);
+    }
+
+    template <typename key_t, typename header_t>
+    inline static bool saveRecords(const std::shared_ptr<records_t<key_t>> &records,
+                                   const boost::filesystem::path           &path,
+                                   const header_t                          &header,
+                                   jobs_t                                  &jobs)
+    {
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Could not open '" << path.string() << "'\n";
+            return false;
+        }
+
+        /// the first record is written here to determine the record size
+        header(out);
+        const std::streamoff offset = out.tellp();
+        if (records->empty())
+            return true;
+        writeKey(records->front().first, out);
+        cslibs_ndt::write(*(records->front().second), out);
+        const std::streamoff record_size = out.tellp() - offset;
+        out.close();
+
+        for (const auto &range : Executor::instance().split(records->size() - 1, min_records)) {
+            const std::size_t start = range.first  + 1;
+            const std::size_t end   = range.second + 1;
+            jobs.emplace_back([records, path, offset, record_size, start, end]() {
+                /// in | out does not truncate, so every job writes its own section
+                std::ofstream out(path.string(), std::ios::binary | std::ios::in | std::ios::out);
+                if (!out.is_open()) {
+                    std::cerr << "Could not open '" << path.string() << "'\n";
+                    return false;
+                }
+                out.seekp(offset + static_cast<std::streamoff>(start) * record_size);
+                for (std::size_t i = start ; i < end ; ++ i) {
+                    writeKey((*records)[i].first, out);
+                    cslibs_ndt::write(*((*records)[i].second), out);
+                }
+                return static_cast<bool>(out) &&
+                        out.tellp() == offset + static_cast<std::streamoff>(end) * record_size;
+            });
+        }
+        return true;
+    }
+
+    /// read the first record to determine the binary size of all records
+    template <typename key_t>
+    inline static bool recordSize(const boost::filesystem::path &path,
+                                  const std::size_t              offset,
+                                  std::size_t                   &record_size,
+                                  std::size_t                   &n)
     {
         std::ifstream in(path.string(), std::ios::binary);
         if (!in.is_open()) {
@@ -108,24 +679,101 @@ private:
             return false;
         }
 
+        record_size = 0;
+        n = 0;
         try {
-            in.seekg (0, std::ios::end);
-            const std::size_t size = in.tellg();
-            in.seekg (0, std::ios::beg);
-            std::size_t read = 0;
-            while (read < size) {
-                index_t index;
-                data_t  data;
-                read += cslibs_math::serialization::array::binary<int, Dim>::read(in, index);
-                read += cslibs_ndt::read(in, data);
-                storage->insert(index, data);
+            const std::size_t file_size = boost::filesystem::file_size(path);
+            if (file_size <= offset)
+                return true;
+
+            in.seekg(static_cast<std::streamoff>(offset));
+            key_t  key;
+            data_t data;
+            record_size  = readKey(in, key);
+            record_size += cslibs_ndt::read(in, data);
+            if (!in || record_size == 0 || (file_size - offset) % record_size != 0) {
+                std::cerr << "Corrupted file '" << path.string() << "'\n";
+                return false;
             }
+            n = (file_size - offset) / record_size;
         } catch (const std::exception &e) {
             std::cerr << "Faild reading file '" << e.what() << "'\n";
             return false;
         }
         return true;
     }
+
+    template <typename key_t, typename storage_t, typename to_index_t>
+    inline static bool loadRecords(const boost::filesystem::path        &path,
+                                   const std::shared_ptr<storage_t>     &storage,
+                                   const std::size_t                     offset,
+                                   const std::size_t                     expected,
+                                   const to_index_t                     &to_index,
+                                   jobs_t                               &jobs)
+    {
+        std::size_t n = 0;
+        std::size_t record_size = 0;
+        if (!recordSize<key_t>(path, offset, record_size, n))
+            return false;
+        if (expected != npos() && n != expected) {
+            std::cerr << "Record count mismatch in '" << path.string() << "'\n";
+            return false;
+        }
+
+        loadRanges<key_t>(path, storage, offset, record_size, Executor::instance().split(n, min_records),
+                          to_index, [](const index_t &) { return true; }, jobs);
+        return true;
+    }
+
+    /// append one job per range of records, records rejected by the filter are skipped
+    template <typename key_t, typename storage_t, typename to_index_t, typename filter_t>
+    inline static void loadRanges(const boost::filesystem::path                         &path,
+                                  const std::shared_ptr<storage_t>                      &storage,
+                                  const std::size_t                                      offset,
+                                  const std::size_t                                      record_size,
+                                  const std::vector<std::pair<std::size_t, std::size_t>> &ranges,
+                                  const to_index_t                                      &to_index,
+                                  const filter_t                                        &filter,
+                                  jobs_t                                                &jobs)
+    {
+        std::shared_ptr<std::mutex> storage_mutex(new std::mutex);
+        for (const auto &range : ranges) {
+            const std::size_t start = range.first;
+            const std::size_t end   = range.second;
+            jobs.emplace_back([storage, storage_mutex, path, offset, record_size, start, end, to_index, filter]() {
+                /// the stream buffer covers the whole section, so it is fetched with a single read
+                std::vector<char> buffer((end - start) * record_size);
+                std::ifstream in;
+                in.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                in.open(path.string(), std::ios::binary);
+                if (!in.is_open()) {
+                    std::cerr << "Could not open '" << path.string() << "'\n";
+                    return false;
+                }
+                in.seekg(static_cast<std::streamoff>(offset + start * record_size));
+
+                std::vector<std::pair<index_t, data_t>> records;
+                records.reserve(end - start);
+                for (std::size_t i = start ; i < end ; ++ i) {
+                    key_t  key;
+                    data_t data;
+                    const std::size_t read = readKey(in, key) + cslibs_ndt::read(in, data);
+                    if (!in || read != record_size) {
+                        std::cerr << "Faild reading file '" << path.string() << "'\n";
+                        return false;
+                    }
+                    const index_t index = to_index(key);
+                    if (filter(index))
+                        records.emplace_back(index, data);
+                }
+
+                std::unique_lock<std::mutex> l(*storage_mutex);
+                for (const auto &r : records)
+                    storage->insert(r.first, r.second);
+                return true;
+            });
+        }
+    }
 };
 }
 
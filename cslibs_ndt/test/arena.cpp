@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt/common/arena.hpp>
+
+#include <set>
+#include <cstdint>
+
+struct alignas(32) aligned_t {
+    double data[5];
+};
+
+TEST(Test_cslibs_ndt, testArena)
+{
+    const cslibs_ndt::Arena::Ptr arena(new cslibs_ndt::Arena(4));
+
+    // objects are carved from slabs of four slots per object size
+    std::vector<std::shared_ptr<double>> doubles;
+    std::set<const double*> addresses;
+    for (std::size_t i = 0 ; i < 6 ; ++ i) {
+        doubles.emplace_back(cslibs_ndt::Arena::make<double>(arena, static_cast<double>(i)));
+        addresses.insert(doubles.back().get());
+    }
+    EXPECT_EQ(addresses.size(), 6ul);
+    for (std::size_t i = 0 ; i < 6 ; ++ i)
+        EXPECT_EQ(*doubles[i], static_cast<double>(i));
+
+    cslibs_ndt::Arena::Statistics s = arena->getStatistics();
+    EXPECT_EQ(s.allocations, 6ul);
+    EXPECT_EQ(s.live, 6ul);
+    EXPECT_EQ(s.slabs, 2ul);
+
+    // freed slots are reused before new slabs are requested
+    const double *freed = doubles[2].get();
+    doubles[2].reset();
+    s = arena->getStatistics();
+    EXPECT_EQ(s.deallocations, 1ul);
+    EXPECT_EQ(s.live, 5ul);
+    doubles[2] = cslibs_ndt::Arena::make<double>(arena, 2.0);
+    EXPECT_EQ(doubles[2].get(), freed);
+    EXPECT_EQ(arena->getStatistics().slabs, 2ul);
+
+    // other sizes and alignments get pools of their own
+    const std::shared_ptr<aligned_t> a = cslibs_ndt::Arena::make<aligned_t>(arena);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a.get()) % alignof(aligned_t), 0ul);
+    EXPECT_EQ(arena->getStatistics().slabs, 3ul);
+
+    // without an arena objects come from the heap
+    const std::shared_ptr<double> h = cslibs_ndt::Arena::make<double>(cslibs_ndt::Arena::Ptr(), 1.0);
+    EXPECT_EQ(*h, 1.0);
+    EXPECT_EQ(arena->getStatistics().allocations, 8ul);
+}
+
+TEST(Test_cslibs_ndt, testArenaLifetime)
+{
+    // objects keep the arena alive after its owner let go of it
+    std::weak_ptr<cslibs_ndt::Arena> weak;
+    std::shared_ptr<double> d;
+    {
+        const cslibs_ndt::Arena::Ptr arena(new cslibs_ndt::Arena);
+        weak = arena;
+        d = cslibs_ndt::Arena::make<double>(arena, 3.0);
+    }
+    EXPECT_FALSE(weak.expired());
+    EXPECT_EQ(*d, 3.0);
+    d.reset();
+    EXPECT_TRUE(weak.expired());
+}
+
+TEST(Test_cslibs_ndt, testSlab)
+{
+    using slab_t = cslibs_ndt::Slab<int, 2>;
+
+    // elements keep their address while the slab grows chunk by chunk
+    slab_t slab;
+    std::vector<const int*> addresses;
+    for (int i = 0 ; i < 10 ; ++ i) {
+        slab.emplace_back(i);
+        addresses.emplace_back(&slab.back());
+    }
+    EXPECT_EQ(slab.size(), 10ul);
+    EXPECT_EQ(slab.chunks(), 3ul);
+    EXPECT_EQ(slab.byte_size(), 3 * slab_t::chunk_size * sizeof(int));
+    for (int i = 0 ; i < 10 ; ++ i) {
+        EXPECT_EQ(slab[i], i);
+        EXPECT_EQ(&slab[i], addresses[i]);
+    }
+
+    // copies are independent
+    slab_t copy(slab);
+    copy[0] = 42;
+    EXPECT_EQ(slab[0], 0);
+    EXPECT_EQ(copy.size(), slab.size());
+
+    slab.clear();
+    EXPECT_EQ(slab.size(), 0ul);
+    EXPECT_EQ(slab.chunks(), 0ul);
+    EXPECT_EQ(copy[9], 9);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
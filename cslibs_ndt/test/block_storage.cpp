@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt/common/block_storage.hpp>
+
+#include <map>
+#include <random>
+
+const std::size_t MAX_NUM_SAMPLES = 1000;
+
+using index_t   = std::array<int, 3>;
+using storage_t = cslibs_ndt::BlockStorage<int, index_t>;
+using option_t  = cslibs_indexed_storage::option::tags::array_size;
+
+TEST(Test_cslibs_ndt, testBlockStorage)
+{
+    // the size is no multiple of the leaf edge, so the last blocks are partial
+    const storage_t::size_t size = {{19, 9, 17}};
+    storage_t storage;
+    storage.set<option_t>(size);
+    EXPECT_EQ(storage.size(), 0ul);
+    const std::size_t empty_byte_size = storage.byte_size();
+
+    std::mt19937 rng(42);
+    std::map<index_t, int> expected;
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i) {
+        const index_t index = {{static_cast<int>(rng() % size[0]),
+                                static_cast<int>(rng() % size[1]),
+                                static_cast<int>(rng() % size[2])}};
+        storage.insert(index, static_cast<int>(i));
+        expected[index] = static_cast<int>(i);
+    }
+
+    // the corners and both sides of every leaf boundary
+    const int e = static_cast<int>(storage_t::leaf_edge);
+    const std::vector<index_t> edges = {{{0, 0, 0}}, {{18, 8, 16}}, {{e - 1, e - 1, e - 1}},
+                                        {{e, e, e}}, {{2 * e - 1, 0, 2 * e}}, {{2 * e, 0, 2 * e - 1}}};
+    for (std::size_t i = 0 ; i < edges.size() ; ++ i) {
+        storage.insert(edges[i], -static_cast<int>(i));
+        expected[edges[i]] = -static_cast<int>(i);
+    }
+
+    ASSERT_EQ(storage.size(), expected.size());
+    for (const auto &v : expected) {
+        ASSERT_NE(storage.get(v.first), nullptr);
+        EXPECT_EQ(*storage.get(v.first), v.second);
+    }
+    EXPECT_GT(storage.byte_size(), empty_byte_size);
+
+    // negative and out of range indices are not stored
+    const std::vector<index_t> outside = {{{-1, 0, 0}}, {{0, -1, 0}}, {{0, 0, -1}},
+                                          {{19, 0, 0}}, {{0, 9, 0}}, {{0, 0, 17}}};
+    for (const index_t &o : outside) {
+        EXPECT_EQ(storage.get(o), nullptr);
+        EXPECT_THROW(storage.insert(o, 0), std::out_of_range);
+    }
+
+    // traversal maps leaf and cell back to the index
+    std::size_t n = 0;
+    storage.traverse([&n, &expected](const index_t &index, const int &data) {
+        EXPECT_EQ(expected.at(index), data);
+        ++ n;
+    });
+    EXPECT_EQ(n, expected.size());
+
+    // copies are deep, pointers into the original stay valid
+    int *p = storage.get(edges[3]);
+    const storage_t copy(storage);
+    storage.insert(edges[3], 42);
+    EXPECT_EQ(*p, 42);
+    EXPECT_EQ(*copy.get(edges[3]), expected[edges[3]]);
+    EXPECT_EQ(copy.size(), expected.size());
+
+    storage.clear();
+    EXPECT_EQ(storage.size(), 0ul);
+    EXPECT_EQ(storage.get(edges[0]), nullptr);
+    EXPECT_EQ(storage.byte_size(), empty_byte_size);
+}
+
+TEST(Test_cslibs_ndt, testBlockStorageSparse)
+{
+    // a single cell only allocates its own leaf
+    storage_t storage;
+    storage.set<option_t>(256ul, 256ul, 256ul);
+    const std::size_t empty_byte_size = storage.byte_size();
+    storage.insert({{255, 255, 255}}, 1);
+    EXPECT_EQ(storage.size(), 1ul);
+    EXPECT_LT(storage.byte_size() - empty_byte_size, 2 * storage_t::leaf_volume * sizeof(int));
+    EXPECT_LT(storage.byte_size(), 256ul * 256ul * 256ul * sizeof(int) / 100);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt/common/morton_storage.hpp>
+
+#include <map>
+#include <random>
+
+const std::size_t MAX_NUM_SAMPLES = 1000;
+
+using index_t   = std::array<int, 3>;
+using storage_t = cslibs_ndt::MortonStorage<int, index_t>;
+using morton_t  = cslibs_ndt::morton<3>;
+
+TEST(Test_cslibs_ndt, testMortonCode)
+{
+    // codes are invertible for negative and extreme indices within 21 bits
+    const int lo = -(1 << 20);
+    const int hi =  (1 << 20) - 1;
+    const std::vector<index_t> indices = {{{0, 0, 0}}, {{-1, -1, -1}}, {{lo, hi, 0}},
+                                          {{hi, lo, -1}}, {{lo, lo, lo}}, {{hi, hi, hi}}};
+    for (const index_t &i : indices)
+        EXPECT_EQ(morton_t::decode(morton_t::encode(i)), i);
+
+    const std::array<int, 2> j = {{std::numeric_limits<int>::min(), std::numeric_limits<int>::max()}};
+    EXPECT_EQ(cslibs_ndt::morton<2>::decode(cslibs_ndt::morton<2>::encode(j)), j);
+
+    // the code orders the children of every octant before the next octant
+    EXPECT_LT(morton_t::encode({{-1, -1, -1}}), morton_t::encode({{0, 0, 0}}));
+    EXPECT_LT(morton_t::encode({{1, 1, 1}}), morton_t::encode({{2, 0, 0}}));
+}
+
+TEST(Test_cslibs_ndt, testMortonStorage)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> coord(-20, 20);
+
+    storage_t storage;
+    std::map<index_t, int> expected;
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i) {
+        const index_t index = {{coord(rng), coord(rng), coord(rng)}};
+        storage.insert(index, static_cast<int>(i));
+        expected[index] = static_cast<int>(i);
+    }
+    ASSERT_EQ(storage.size(), expected.size());
+    for (const auto &e : expected) {
+        ASSERT_NE(storage.get(e.first), nullptr);
+        EXPECT_EQ(*storage.get(e.first), e.second);
+    }
+    EXPECT_EQ(storage.get({{100, 0, 0}}), nullptr);
+
+    // all entries are visited once in z-order
+    std::size_t n = 0;
+    morton_t::code_t last = 0;
+    storage.traverse([&n, &last, &expected](const index_t &index, const int &data) {
+        const morton_t::code_t code = morton_t::encode(index);
+        EXPECT_TRUE(n == 0 || code > last);
+        EXPECT_EQ(expected.at(index), data);
+        last = code;
+        ++ n;
+    });
+    EXPECT_EQ(n, expected.size());
+
+    // range traversals visit exactly the entries in the box
+    const index_t min = {{-5, -3, 0}};
+    const index_t max = {{4, 7, 9}};
+    std::size_t n_box = 0;
+    storage.traverse(min, max, [&n_box, &min, &max](const index_t &index, const int &) {
+        for (std::size_t i = 0 ; i < 3 ; ++ i)
+            EXPECT_TRUE(index[i] >= min[i] && index[i] <= max[i]);
+        ++ n_box;
+    });
+    std::size_t n_expected = 0;
+    for (const auto &e : expected) {
+        bool inside = true;
+        for (std::size_t i = 0 ; i < 3 ; ++ i)
+            inside &= e.first[i] >= min[i] && e.first[i] <= max[i];
+        n_expected += inside ? 1 : 0;
+    }
+    EXPECT_EQ(n_box, n_expected);
+}
+
+TEST(Test_cslibs_ndt, testMortonStorageInsertWhileTraversing)
+{
+    storage_t storage;
+    for (int i = 0 ; i < 100 ; ++ i)
+        storage.insert({{i, -i, 0}}, i);
+
+    // a traversal keeps the order it started with, entries inserted meanwhile
+    // show up in the next one
+    std::size_t n = 0;
+    storage.traverse([&storage, &n](const index_t &index, const int &data) {
+        storage.insert({{index[0], index[1], 1}}, data);
+        ++ n;
+    });
+    EXPECT_EQ(n, 100ul);
+
+    n = 0;
+    storage.traverse([&n](const index_t &, const int &) {
+        ++ n;
+    });
+    EXPECT_EQ(n, 200ul);
+
+    storage.clear();
+    n = 0;
+    storage.traverse([&n](const index_t &, const int &) {
+        ++ n;
+    });
+    EXPECT_EQ(n, 0ul);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
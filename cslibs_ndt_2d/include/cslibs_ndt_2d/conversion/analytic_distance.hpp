@@ -0,0 +1,156 @@
+#ifndef CSLIBS_NDT_2D_CONVERSION_ANALYTIC_DISTANCE_HPP
+#define CSLIBS_NDT_2D_CONVERSION_ANALYTIC_DISTANCE_HPP
+
+#include <array>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <cslibs_ndt/common/executor.hpp>
+
+namespace cslibs_ndt_2d {
+namespace conversion {
+/**
+ * @brief Distance field computed from the cell distributions instead of a
+ *        thresholded raster. A distribution is an obstacle where its weighted
+ *        density exceeds the threshold, which is an ellipse around its mean.
+ *        The distance of a point to that ellipse is measured along the ray
+ *        from the mean, an upper bound of the Euclidean distance which is
+ *        exact for round distributions. Only points within the maximum
+ *        distance of an ellipse are visited, tiles of the grid are processed
+ *        in parallel.
+ */
+class AnalyticDistance
+{
+public:
+    using point_t      = Eigen::Vector2d;
+    using covariance_t = Eigen::Matrix2d;
+
+    inline AnalyticDistance(const double threshold,
+                            const double maximum_distance) :
+        threshold_(threshold),
+        maximum_distance_(maximum_distance)
+    {
+    }
+
+    /**
+     * @brief Add a distribution in grid coordinates, its weight scales the
+     *        density, e.g. by the occupancy of the cell.
+     */
+    inline void add(const point_t      &mean,
+                    const covariance_t &covariance,
+                    const double        weight = 1.0)
+    {
+        if (weight <= threshold_ || !(covariance.determinant() > 1e-12))
+            return;
+
+        obstacle_t o;
+        o.mean        = mean;
+        o.information = covariance.inverse();
+        o.radius      = std::sqrt(2.0 * std::log(weight / threshold_));
+        for (std::size_t i = 0 ; i < 2 ; ++ i)
+            o.extent[i] = o.radius * std::sqrt(covariance(i, i)) + maximum_distance_;
+        obstacles_.emplace_back(o);
+    }
+
+    inline std::size_t size() const
+    {
+        return obstacles_.size();
+    }
+
+    /**
+     * @brief Distances of the points origin + (x, y) * resolution, stored row
+     *        by row and capped at the maximum distance.
+     */
+    template <typename T>
+    inline void apply(const point_t     &origin,
+                      const double       resolution,
+                      const std::size_t  width,
+                      const std::size_t  height,
+                      std::vector<T>    &distances) const
+    {
+        distances.assign(width * height, static_cast<T>(maximum_distance_));
+        if (obstacles_.empty() || width == 0 || height == 0)
+            return;
+
+        /// cell ranges of the obstacles, binned into the tiles they touch
+        const std::size_t tiles_x = (width  + tile_size - 1) / tile_size;
+        const std::size_t tiles_y = (height + tile_size - 1) / tile_size;
+        std::vector<std::vector<std::size_t>> tiles(tiles_x * tiles_y);
+        std::vector<std::array<int, 4>>       ranges(obstacles_.size());
+        const double resolution_inv = 1.0 / resolution;
+        for (std::size_t i = 0 ; i < obstacles_.size() ; ++ i) {
+            const obstacle_t &o = obstacles_[i];
+            std::array<int, 4> &r = ranges[i];
+            r[0] = std::max(0, static_cast<int>(std::ceil((o.mean(0) - o.extent[0] - origin(0)) * resolution_inv)));
+            r[1] = std::min(static_cast<int>(width)  - 1, static_cast<int>(std::floor((o.mean(0) + o.extent[0] - origin(0)) * resolution_inv)));
+            r[2] = std::max(0, static_cast<int>(std::ceil((o.mean(1) - o.extent[1] - origin(1)) * resolution_inv)));
+            r[3] = std::min(static_cast<int>(height) - 1, static_cast<int>(std::floor((o.mean(1) + o.extent[1] - origin(1)) * resolution_inv)));
+            if (r[0] > r[1] || r[2] > r[3])
+                continue;
+
+            for (int ty = r[2] / tile_size ; ty <= r[3] / tile_size ; ++ ty)
+                for (int tx = r[0] / tile_size ; tx <= r[1] / tile_size ; ++ tx)
+                    tiles[ty * tiles_x + tx].emplace_back(i);
+        }
+
+        cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+        cslibs_ndt::Executor::jobs_t jobs;
+        for (const auto &range : executor.split(tiles.size())) {
+            jobs.emplace_back([this, &tiles, &ranges, &distances, &origin, resolution, width, height, tiles_x, range]() {
+                for (std::size_t t = range.first ; t < range.second ; ++ t) {
+                    const int x0 = static_cast<int>((t % tiles_x) * tile_size);
+                    const int y0 = static_cast<int>((t / tiles_x) * tile_size);
+                    const int x1 = std::min(x0 + tile_size, static_cast<int>(width))  - 1;
+                    const int y1 = std::min(y0 + tile_size, static_cast<int>(height)) - 1;
+                    for (const std::size_t i : tiles[t]) {
+                        const obstacle_t &o = obstacles_[i];
+                        const std::array<int, 4> &r = ranges[i];
+                        for (int y = std::max(y0, r[2]) ; y <= std::min(y1, r[3]) ; ++ y) {
+                            T *row = distances.data() + y * width;
+                            for (int x = std::max(x0, r[0]) ; x <= std::min(x1, r[1]) ; ++ x) {
+                                const point_t v(origin(0) + x * resolution - o.mean(0),
+                                                origin(1) + y * resolution - o.mean(1));
+                                const double  d = distance(o, v);
+                                if (d < row[x])
+                                    row[x] = static_cast<T>(d);
+                            }
+                        }
+                    }
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+    }
+
+private:
+    static constexpr int tile_size = 64;
+
+    struct obstacle_t {
+        point_t               mean;
+        covariance_t          information;
+        double                radius;       ///< Mahalanobis radius of the ellipse
+        std::array<double, 2> extent;       ///< half size of the visited box
+    public:
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    const double                                                  threshold_;
+    const double                                                  maximum_distance_;
+    std::vector<obstacle_t, Eigen::aligned_allocator<obstacle_t>> obstacles_;
+
+    inline static double distance(const obstacle_t &o,
+                                  const point_t    &v)
+    {
+        const double m = std::sqrt(v.dot(o.information * v));
+        return m <= o.radius ? 0.0 : v.norm() * (1.0 - o.radius / m);
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_2D_CONVERSION_ANALYTIC_DISTANCE_HPP
@@ -6,14 +6,15 @@
 
 #include <cslibs_ndt_2d/conversion/gridmap.hpp>
 #include <cslibs_ndt_2d/conversion/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/distance_transform.hpp>
 
 #include <cslibs_gridmaps/static_maps/distance_gridmap.h>
-#include <cslibs_gridmaps/static_maps/algorithms/distance_transform.hpp>
 
 namespace cslibs_ndt_2d {
 namespace conversion {
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>> &src,
         cslibs_gridmaps::static_maps::DistanceGridmap::Ptr &dst,
         const double &sampling_resolution,
         const double &maximum_distance = 2.0,
@@ -31,7 +32,7 @@ inline void from(
             max_bi[1] == std::numeric_limits<int>::min())
         return;
 
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::Gridmap;
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>;
     using dst_map_t = cslibs_gridmaps::static_maps::DistanceGridmap;
     dst.reset(new dst_map_t(src->getOrigin(),
                             sampling_resolution,
@@ -44,7 +45,7 @@ inline void from(
     const double bundle_resolution = src->getBundleResolution();
     const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
 
-    auto sample = [](const cslibs_math_2d::Point2d &p, const src_map_t::distribution_bundle_t &bundle) {
+    auto sample = [](const cslibs_math_2d::Point2d &p, const typename src_map_t::distribution_bundle_t &bundle) {
         return 0.25 * (bundle.at(0)->getHandle()->data().sampleNonNormalized(p) +
                        bundle.at(1)->getHandle()->data().sampleNonNormalized(p) +
                        bundle.at(2)->getHandle()->data().sampleNonNormalized(p) +
@@ -52,7 +53,7 @@ inline void from(
     };
 
     auto process_bundle = [&dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &sample]
-                  (const index_t &bi, const src_map_t::distribution_bundle_t &b){
+                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
         for (int k = 0 ; k < chunk_step ; ++ k) {
             for (int l = 0 ; l < chunk_step ; ++ l) {
                 const int dst_x = (bi[0] - min_bi[0]) * chunk_step + k;
@@ -69,14 +70,13 @@ inline void from(
     };
     src->traverse(process_bundle);
 
-    std::vector<double> occ = dst->getData();
-    cslibs_gridmaps::static_maps::algorithms::DistanceTransform<double> distance_transform(
-                sampling_resolution, maximum_distance, threshold);
-    distance_transform.apply(occ, dst->getWidth(), dst->getData());
+    DistanceTransform(sampling_resolution, maximum_distance, threshold).apply(
+                dst->getWidth(), dst->getHeight(), dst->getData());
 }
 
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
         cslibs_gridmaps::static_maps::DistanceGridmap::Ptr &dst,
         const double &sampling_resolution,
         const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
@@ -95,7 +95,7 @@ inline void from(
             max_bi[1] == std::numeric_limits<int>::min())
         return;
 
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap;
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>;
     using dst_map_t = cslibs_gridmaps::static_maps::DistanceGridmap;
     dst.reset(new dst_map_t(src->getOrigin(),
                             sampling_resolution,
@@ -108,8 +108,8 @@ inline void from(
     const double bundle_resolution = src->getBundleResolution();
     const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
 
-    auto sample = [&inverse_model](const cslibs_math_2d::Point2d &p, const src_map_t::distribution_bundle_t &bundle) {
-        auto sample = [&p, &inverse_model](const src_map_t::distribution_t *d) {
+    auto sample = [&inverse_model](const cslibs_math_2d::Point2d &p, const typename src_map_t::distribution_bundle_t &bundle) {
+        auto sample = [&p, &inverse_model](const typename src_map_t::distribution_t *d) {
             auto do_sample = [&p, &inverse_model, &d]() {
                 const auto &handle = d->getHandle();
                 return handle->getDistribution() ?
@@ -124,7 +124,7 @@ inline void from(
     };
 
     auto process_bundle = [&dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &sample]
-                  (const index_t &bi, const src_map_t::distribution_bundle_t &b){
+                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
         for (int k = 0 ; k < chunk_step ; ++ k) {
             for (int l = 0 ; l < chunk_step ; ++ l) {
                 const int dst_x = (bi[0] - min_bi[0]) * chunk_step + k;
@@ -141,10 +141,8 @@ inline void from(
     };
     src->traverse(process_bundle);
 
-    std::vector<double> occ = dst->getData();
-    cslibs_gridmaps::static_maps::algorithms::DistanceTransform<double> distance_transform(
-                sampling_resolution, maximum_distance, threshold);
-    distance_transform.apply(occ, dst->getWidth(), dst->getData());
+    DistanceTransform(sampling_resolution, maximum_distance, threshold).apply(
+                dst->getWidth(), dst->getHeight(), dst->getData());
 }
 }
 }
@@ -0,0 +1,141 @@
+#ifndef CSLIBS_NDT_2D_CONVERSION_DISTANCE_TRANSFORM_HPP
+#define CSLIBS_NDT_2D_CONVERSION_DISTANCE_TRANSFORM_HPP
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include <cslibs_ndt/common/executor.hpp>
+
+namespace cslibs_ndt_2d {
+namespace conversion {
+/**
+ * @brief Exact Euclidean distance transform of a raster, computed in place.
+ *        The column pass sweeps whole rows at once, so its inner loop runs
+ *        over contiguous memory and vectorises, and stripes of columns are
+ *        processed in parallel. The row pass computes the lower envelope of
+ *        parabolas (Felzenszwalb and Huttenlocher) for every row in
+ *        parallel. Intermediate values are kept in float, only one row of
+ *        scratch space per job is allocated.
+ */
+class DistanceTransform
+{
+public:
+    /**
+     * @param resolution       cell size of the raster
+     * @param maximum_distance distances are capped at this value
+     * @param threshold        cells with values of at least threshold are
+     *                         obstacles
+     */
+    inline DistanceTransform(const double resolution,
+                             const double maximum_distance,
+                             const double threshold) :
+        resolution_(resolution),
+        maximum_distance_(maximum_distance),
+        threshold_(threshold)
+    {
+    }
+
+    /**
+     * @brief Replace the raster values, stored row by row, by the distance to
+     *        the closest obstacle.
+     */
+    template <typename T>
+    inline void apply(const std::size_t  width,
+                      const std::size_t  height,
+                      std::vector<T>    &data) const
+    {
+        if (width == 0 || height == 0 || data.size() < width * height)
+            return;
+
+        /// distances beyond the cap are never needed, which keeps the squares small
+        const float cap = static_cast<float>(std::ceil(maximum_distance_ / resolution_) + 1.0);
+        const float thr = static_cast<float>(threshold_);
+
+        cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+        cslibs_ndt::Executor::jobs_t jobs;
+
+        /// vertical distance in cells to the closest obstacle of the column
+        for (const auto &r : executor.split(width, 64)) {
+            jobs.emplace_back([&data, width, height, cap, thr, r]() {
+                T *row = data.data();
+                for (std::size_t x = r.first ; x < r.second ; ++ x)
+                    row[x] = static_cast<float>(row[x]) >= thr ? T(0) : static_cast<T>(cap);
+                for (std::size_t y = 1 ; y < height ; ++ y) {
+                    const T *prev = data.data() + (y - 1) * width;
+                    T       *curr = data.data() + y * width;
+                    for (std::size_t x = r.first ; x < r.second ; ++ x)
+                        curr[x] = static_cast<float>(curr[x]) >= thr ? T(0) : std::min(static_cast<T>(cap), prev[x] + T(1));
+                }
+                for (std::size_t y = height - 1 ; y > 0 ; -- y) {
+                    const T *next = data.data() + y * width;
+                    T       *curr = data.data() + (y - 1) * width;
+                    for (std::size_t x = r.first ; x < r.second ; ++ x)
+                        curr[x] = std::min(curr[x], next[x] + T(1));
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+        jobs.clear();
+
+        /// lower envelope of the parabolas of every row
+        const float resolution       = static_cast<float>(resolution_);
+        const float maximum_distance = static_cast<float>(maximum_distance_);
+        for (const auto &r : executor.split(height, 16)) {
+            jobs.emplace_back([&data, width, resolution, maximum_distance, r]() {
+                std::vector<float> f(width);
+                std::vector<float> z(width + 1);
+                std::vector<int>   v(width);
+                for (std::size_t y = r.first ; y < r.second ; ++ y) {
+                    T *row = data.data() + y * width;
+                    for (std::size_t x = 0 ; x < width ; ++ x)
+                        f[x] = static_cast<float>(row[x]) * static_cast<float>(row[x]);
+
+                    int k = 0;
+                    v[0] = 0;
+                    z[0] = -std::numeric_limits<float>::infinity();
+                    z[1] =  std::numeric_limits<float>::infinity();
+                    for (int q = 1 ; q < static_cast<int>(width) ; ++ q) {
+                        float s;
+                        while ((s = intersection(f, q, v[k])) <= z[k])
+                            -- k;
+                        ++ k;
+                        v[k]     = q;
+                        z[k]     = s;
+                        z[k + 1] = std::numeric_limits<float>::infinity();
+                    }
+
+                    k = 0;
+                    for (int q = 0 ; q < static_cast<int>(width) ; ++ q) {
+                        while (z[k + 1] < q)
+                            ++ k;
+                        const float dq = static_cast<float>(q - v[k]);
+                        row[q] = static_cast<T>(std::min(maximum_distance, std::sqrt(dq * dq + f[v[k]]) * resolution));
+                    }
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+    }
+
+private:
+    const double resolution_;
+    const double maximum_distance_;
+    const double threshold_;
+
+    /// position where the parabolas rooted at q and p intersect, arranged to
+    /// avoid the squares of large positions in float
+    inline static float intersection(const std::vector<float> &f,
+                                     const int                 q,
+                                     const int                 p)
+    {
+        return 0.5f * ((f[q] - f[p]) / static_cast<float>(q - p) + static_cast<float>(q + p));
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_2D_CONVERSION_DISTANCE_TRANSFORM_HPP
@@ -32,8 +32,9 @@ inline cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr from(
     return dst;
 }
 
+template <template <typename, typename> class backend_t>
 inline cslibs_ndt_2d::static_maps::Gridmap::Ptr from(
-        const cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr& src)
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>> &src)
 {
     if (!src)
         return nullptr;    
@@ -56,13 +57,13 @@ inline cslibs_ndt_2d::static_maps::Gridmap::Ptr from(
                         bi[1] - min_bi[1]}};
     };
 
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::Gridmap;
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>;
     using dst_map_t = cslibs_ndt_2d::static_maps::Gridmap;
     typename dst_map_t::Ptr dst(new dst_map_t(src->getOrigin(),
                                               src->getResolution(),
                                               size));
 
-    auto process_bundle = [&dst, &get_bundle_index](const index_t &bi, const src_map_t::distribution_bundle_t &b){
+    auto process_bundle = [&dst, &get_bundle_index](const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
         const index_t bi_dst = get_bundle_index(bi);
         if (const typename dst_map_t::distribution_bundle_t* b_dst = dst->getDistributionBundle(bi_dst)) {
             for (std::size_t i = 0 ; i < 4 ; ++ i) {
@@ -6,14 +6,43 @@
 
 #include <cslibs_ndt_2d/conversion/gridmap.hpp>
 #include <cslibs_ndt_2d/conversion/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/distance_transform.hpp>
+#include <cslibs_ndt_2d/conversion/analytic_distance.hpp>
+
+#include <cslibs_ndt/common/exp_table.hpp>
+#include <cslibs_ndt/common/executor.hpp>
 
 #include <cslibs_gridmaps/static_maps/likelihood_field_gridmap.h>
-#include <cslibs_gridmaps/static_maps/algorithms/distance_transform.hpp>
 
 namespace cslibs_ndt_2d {
 namespace conversion {
+/**
+ * @brief Turn the distances of the likelihood field into likelihoods in
+ *        parallel, using a lookup table for the exponential.
+ */
+inline void toLikelihood(cslibs_gridmaps::static_maps::LikelihoodFieldGridmap::Ptr &dst,
+                         const double &maximum_distance,
+                         const double &sigma_hit)
+{
+    const double exp_factor_hit = (0.5 * 1.0 / (sigma_hit * sigma_hit));
+    const cslibs_ndt::ExpTable exp_table(maximum_distance * maximum_distance * exp_factor_hit);
+
+    std::vector<double> &data = dst->getData();
+    cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (const auto &r : executor.split(data.size(), 4096)) {
+        jobs.emplace_back([&data, &exp_table, &exp_factor_hit, r]() {
+            for (std::size_t i = r.first ; i < r.second ; ++ i)
+                data[i] = exp_table(data[i] * data[i] * exp_factor_hit);
+            return true;
+        });
+    }
+    executor.run(jobs);
+}
+
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>> &src,
         cslibs_gridmaps::static_maps::LikelihoodFieldGridmap::Ptr &dst,
         const double &sampling_resolution,
         const double &maximum_distance = 2.0,
@@ -34,9 +63,7 @@ inline void from(
 
     assert(threshold <= 1.0);
     assert(threshold >= 0.0);
-    const double exp_factor_hit = (0.5 * 1.0 / (sigma_hit * sigma_hit));
-
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::Gridmap;
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>;
     using dst_map_t = cslibs_gridmaps::static_maps::LikelihoodFieldGridmap;
     dst.reset(new dst_map_t(src->getOrigin(),
                             sampling_resolution,
@@ -49,7 +76,7 @@ inline void from(
     const double bundle_resolution = src->getBundleResolution();
     const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
 
-    auto sample = [](const cslibs_math_2d::Point2d &p, const src_map_t::distribution_bundle_t &bundle) {
+    auto sample = [](const cslibs_math_2d::Point2d &p, const typename src_map_t::distribution_bundle_t &bundle) {
         return 0.25 * (bundle.at(0)->getHandle()->data().sampleNonNormalized(p) +
                        bundle.at(1)->getHandle()->data().sampleNonNormalized(p) +
                        bundle.at(2)->getHandle()->data().sampleNonNormalized(p) +
@@ -57,7 +84,7 @@ inline void from(
     };
 
     auto process_bundle = [&dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &sample]
-                  (const index_t &bi, const src_map_t::distribution_bundle_t &b){
+                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
         for (int k = 0 ; k < chunk_step ; ++ k) {
             for (int l = 0 ; l < chunk_step ; ++ l) {
                 const int dst_x = (bi[0] - min_bi[0]) * chunk_step + k;
@@ -74,18 +101,14 @@ inline void from(
     };
     src->traverse(process_bundle);
 
-    std::vector<double> occ = dst->getData();
-    cslibs_gridmaps::static_maps::algorithms::DistanceTransform<double> distance_transform(
-                sampling_resolution, maximum_distance, threshold);
-    distance_transform.apply(occ, dst->getWidth(), dst->getData());
-
-    std::for_each(dst->getData().begin(),
-                  dst->getData().end(),
-                  [&exp_factor_hit] (double &z) {z = std::exp(-z * z * exp_factor_hit);});
+    DistanceTransform(sampling_resolution, maximum_distance, threshold).apply(
+                dst->getWidth(), dst->getHeight(), dst->getData());
+    toLikelihood(dst, maximum_distance, sigma_hit);
 }
 
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
         cslibs_gridmaps::static_maps::LikelihoodFieldGridmap::Ptr &dst,
         const double &sampling_resolution,
         const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
@@ -107,9 +130,7 @@ inline void from(
 
     assert(threshold <= 1.0);
     assert(threshold >= 0.0);
-    const double exp_factor_hit = (0.5 * 1.0 / (sigma_hit * sigma_hit));
-
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap;
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>;
     using dst_map_t = cslibs_gridmaps::static_maps::LikelihoodFieldGridmap;
     dst.reset(new dst_map_t(src->getOrigin(),
                             sampling_resolution,
@@ -122,8 +143,8 @@ inline void from(
     const double bundle_resolution = src->getBundleResolution();
     const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
 
-    auto sample = [&inverse_model](const cslibs_math_2d::Point2d &p, const src_map_t::distribution_bundle_t &bundle) {
-        auto sample = [&p, &inverse_model](const src_map_t::distribution_t *d) {
+    auto sample = [&inverse_model](const cslibs_math_2d::Point2d &p, const typename src_map_t::distribution_bundle_t &bundle) {
+        auto sample = [&p, &inverse_model](const typename src_map_t::distribution_t *d) {
             auto do_sample = [&p, &inverse_model, &d]() {
                 const auto &handle = d->getHandle();
                 return handle->getDistribution() ?
@@ -138,7 +159,7 @@ inline void from(
     };
 
     auto process_bundle = [&dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &sample]
-                  (const index_t &bi, const src_map_t::distribution_bundle_t &b){
+                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
         for (int k = 0 ; k < chunk_step ; ++ k) {
             for (int l = 0 ; l < chunk_step ; ++ l) {
                 const int dst_x = (bi[0] - min_bi[0]) * chunk_step + k;
@@ -155,14 +176,113 @@ inline void from(
     };
     src->traverse(process_bundle);
 
-    std::vector<double> occ = dst->getData();
-    cslibs_gridmaps::static_maps::algorithms::DistanceTransform<double> distance_transform(
-                sampling_resolution, maximum_distance, threshold);
-    distance_transform.apply(occ, dst->getWidth(), dst->getData());
+    DistanceTransform(sampling_resolution, maximum_distance, threshold).apply(
+                dst->getWidth(), dst->getHeight(), dst->getData());
+    toLikelihood(dst, maximum_distance, sigma_hit);
+}
 
-    std::for_each(dst->getData().begin(),
-                  dst->getData().end(),
-                  [&exp_factor_hit] (double &z) {z = std::exp(-z * z * exp_factor_hit);});
+/**
+ * @brief Likelihood field computed from the cell distributions directly,
+ *        without rasterising the map and running a distance transform over
+ *        the whole raster, see AnalyticDistance.
+ */
+template <template <typename, typename> class backend_t>
+inline void fromDistributions(
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>> &src,
+        cslibs_gridmaps::static_maps::LikelihoodFieldGridmap::Ptr &dst,
+        const double &sampling_resolution,
+        const double &maximum_distance = 2.0,
+        const double &sigma_hit        = 0.5,
+        const double &threshold        = 0.169)
+{
+    if (!src)
+        return;
+
+    using index_t = std::array<int, 2>;
+    const index_t min_bi = src->getMinDistributionIndex();
+    const index_t max_bi = src->getMaxDistributionIndex();
+    if (min_bi[0] == std::numeric_limits<int>::max() ||
+            min_bi[1] == std::numeric_limits<int>::max() ||
+            max_bi[0] == std::numeric_limits<int>::min() ||
+            max_bi[1] == std::numeric_limits<int>::min())
+        return;
+
+    assert(threshold <= 1.0);
+    assert(threshold >= 0.0);
+
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>;
+    using dst_map_t = cslibs_gridmaps::static_maps::LikelihoodFieldGridmap;
+    dst.reset(new dst_map_t(src->getOrigin(),
+                            sampling_resolution,
+                            src->getHeight() / sampling_resolution,
+                            src->getWidth()  / sampling_resolution,
+                            maximum_distance,
+                            sigma_hit));
+
+    AnalyticDistance distance(threshold, maximum_distance);
+    for (const auto &storage : src->getStorages()) {
+        storage->traverse([&distance](const index_t &, const typename src_map_t::distribution_t &d) {
+            const auto &data = d.getHandle()->data();
+            if (data.getN() >= 3)
+                distance.add(data.getMean(), data.getCovariance());
+        });
+    }
+
+    const double bundle_resolution = src->getBundleResolution();
+    distance.apply(AnalyticDistance::point_t(min_bi[0] * bundle_resolution, min_bi[1] * bundle_resolution),
+                   sampling_resolution, dst->getWidth(), dst->getHeight(), dst->getData());
+    toLikelihood(dst, maximum_distance, sigma_hit);
+}
+
+template <template <typename, typename> class backend_t>
+inline void fromDistributions(
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
+        cslibs_gridmaps::static_maps::LikelihoodFieldGridmap::Ptr &dst,
+        const double &sampling_resolution,
+        const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
+        const double &maximum_distance = 2.0,
+        const double &sigma_hit        = 0.5,
+        const double &threshold        = 0.169)
+{
+    if (!src || !inverse_model)
+        return;
+
+    using index_t = std::array<int, 2>;
+    const index_t min_bi = src->getMinDistributionIndex();
+    const index_t max_bi = src->getMaxDistributionIndex();
+    if (min_bi[0] == std::numeric_limits<int>::max() ||
+            min_bi[1] == std::numeric_limits<int>::max() ||
+            max_bi[0] == std::numeric_limits<int>::min() ||
+            max_bi[1] == std::numeric_limits<int>::min())
+        return;
+
+    assert(threshold <= 1.0);
+    assert(threshold >= 0.0);
+
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>;
+    using dst_map_t = cslibs_gridmaps::static_maps::LikelihoodFieldGridmap;
+    dst.reset(new dst_map_t(src->getOrigin(),
+                            sampling_resolution,
+                            src->getHeight() / sampling_resolution,
+                            src->getWidth()  / sampling_resolution,
+                            maximum_distance,
+                            sigma_hit));
+
+    AnalyticDistance distance(threshold, maximum_distance);
+    for (const auto &storage : src->getStorages()) {
+        storage->traverse([&distance, &inverse_model](const index_t &, const typename src_map_t::distribution_t &d) {
+            const auto &handle = d.getHandle();
+            if (handle->getDistribution() && handle->getDistribution()->getN() >= 3)
+                distance.add(handle->getDistribution()->getMean(),
+                             handle->getDistribution()->getCovariance(),
+                             handle->getOccupancy(inverse_model));
+        });
+    }
+
+    const double bundle_resolution = src->getBundleResolution();
+    distance.apply(AnalyticDistance::point_t(min_bi[0] * bundle_resolution, min_bi[1] * bundle_resolution),
+                   sampling_resolution, dst->getWidth(), dst->getHeight(), dst->getData());
+    toLikelihood(dst, maximum_distance, sigma_hit);
 }
 }
 }
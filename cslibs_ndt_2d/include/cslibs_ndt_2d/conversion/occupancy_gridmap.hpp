@@ -23,8 +23,12 @@ inline cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr from(
             for (std::size_t i = 0 ; i < 4 ; ++ i)
                 if (b.at(i)) {
                     const auto &handle = b.at(i)->getHandle();
-                    if (handle->numFree() > 0 || handle->numOccupied() > 0)
+                    if (handle->numFree() > 0 || handle->numOccupied() > 0) {
+                        /// the copied cell forgets its evidence with the destination map
+                        const cslibs_ndt::Decay::Ptr decay = b_dst->at(i)->getDecay();
                         *(b_dst->at(i)) = *handle;
+                        b_dst->at(i)->setDecay(decay);
+                    }
                 }
         }
     };
@@ -33,8 +37,9 @@ inline cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr from(
     return dst;
 }
 
+template <template <typename, typename> class backend_t>
 inline cslibs_ndt_2d::static_maps::OccupancyGridmap::Ptr from(
-        const cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr& src)
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src)
 {
     if (!src)
         return nullptr;    
@@ -57,20 +62,24 @@ inline cslibs_ndt_2d::static_maps::OccupancyGridmap::Ptr from(
                         bi[1] - min_bi[1]}};
     };
 
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap;
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>;
     using dst_map_t = cslibs_ndt_2d::static_maps::OccupancyGridmap;
     typename dst_map_t::Ptr dst(new dst_map_t(src->getOrigin(),
                                               src->getResolution(),
                                               size));
 
-    auto process_bundle = [&dst, &get_bundle_index](const index_t &bi, const src_map_t::distribution_bundle_t &b){
+    auto process_bundle = [&dst, &get_bundle_index](const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
         const index_t bi_dst = get_bundle_index(bi);
         if (const typename dst_map_t::distribution_bundle_t* b_dst = dst->getDistributionBundle(bi_dst)) {
             for (std::size_t i = 0 ; i < 4 ; ++ i)
                 if (b.at(i)) {
                     const auto &handle = b.at(i)->getHandle();
-                    if (handle->numFree() > 0 || handle->numOccupied() > 0)
+                    if (handle->numFree() > 0 || handle->numOccupied() > 0) {
+                        /// the copied cell forgets its evidence with the destination map
+                        const cslibs_ndt::Decay::Ptr decay = b_dst->at(i)->getDecay();
                         *(b_dst->at(i)) = *handle;
+                        b_dst->at(i)->setDecay(decay);
+                    }
                 }
         }
     };
@@ -11,8 +11,9 @@
 
 namespace cslibs_ndt_2d {
 namespace conversion {
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>> &src,
         cslibs_gridmaps::static_maps::ProbabilityGridmap::Ptr &dst,
         const double &sampling_resolution)
 {
@@ -28,7 +29,7 @@ inline void from(
             max_bi[1] == std::numeric_limits<int>::min())
         return;
 
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::Gridmap;
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>;
     using dst_map_t = cslibs_gridmaps::static_maps::ProbabilityGridmap;
     dst.reset(new dst_map_t(src->getOrigin(),
                             sampling_resolution,
@@ -39,7 +40,7 @@ inline void from(
     const double bundle_resolution = src->getBundleResolution();
     const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
 
-    auto sample = [](const cslibs_math_2d::Point2d &p, const src_map_t::distribution_bundle_t &bundle) {
+    auto sample = [](const cslibs_math_2d::Point2d &p, const typename src_map_t::distribution_bundle_t &bundle) {
         return 0.25 * (bundle.at(0)->getHandle()->data().sampleNonNormalized(p) +
                        bundle.at(1)->getHandle()->data().sampleNonNormalized(p) +
                        bundle.at(2)->getHandle()->data().sampleNonNormalized(p) +
@@ -47,7 +48,7 @@ inline void from(
     };
 
     auto process_bundle = [&dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &sample]
-                  (const index_t &bi, const src_map_t::distribution_bundle_t &b){
+                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
         for (int k = 0 ; k < chunk_step ; ++ k) {
             for (int l = 0 ; l < chunk_step ; ++ l) {
                 const int dst_x = (bi[0] - min_bi[0]) * chunk_step + k;
@@ -65,8 +66,9 @@ inline void from(
     src->traverse(process_bundle);
 }
 
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
         cslibs_gridmaps::static_maps::ProbabilityGridmap::Ptr &dst,
         const double &sampling_resolution,
         const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model)
@@ -83,7 +85,7 @@ inline void from(
             max_bi[1] == std::numeric_limits<int>::min())
         return;
 
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap;
+    using src_map_t = cslibs_ndt_2d::dynamic_maps::BasicOccupancyGridmap<backend_t>;
     using dst_map_t = cslibs_gridmaps::static_maps::ProbabilityGridmap;
     dst.reset(new dst_map_t(src->getOrigin(),
                             sampling_resolution,
@@ -94,8 +96,8 @@ inline void from(
     const double bundle_resolution = src->getBundleResolution();
     const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
 
-    auto sample = [&inverse_model](const cslibs_math_2d::Point2d &p, const src_map_t::distribution_bundle_t &bundle) {
-        auto sample = [&p, &inverse_model](const src_map_t::distribution_t *d) {
+    auto sample = [&inverse_model](const cslibs_math_2d::Point2d &p, const typename src_map_t::distribution_bundle_t &bundle) {
+        auto sample = [&p, &inverse_model](const typename src_map_t::distribution_t *d) {
             auto do_sample = [&p, &inverse_model, &d]() {
                 const auto &handle = d->getHandle();
                 return handle->getDistribution() ?
@@ -110,7 +112,7 @@ inline void from(
     };
 
     auto process_bundle = [&dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &sample]
-                  (const index_t &bi, const src_map_t::distribution_bundle_t &b){
+                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
         for (int k = 0 ; k < chunk_step ; ++ k) {
             for (int l = 0 ; l < chunk_step ; ++ l) {
                 const int dst_x = (bi[0] - min_bi[0]) * chunk_step + k;
@@ -5,12 +5,17 @@
 #include <vector>
 #include <cmath>
 #include <memory>
+#include <tuple>
 
 #include <cslibs_math_2d/linear/pose.hpp>
 #include <cslibs_math_2d/linear/point.hpp>
 
 #include <cslibs_ndt/common/distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/point_indexer.hpp>
+#include <cslibs_ndt/common/backend.hpp>
+#include <cslibs_ndt/common/merge_transform.hpp>
+#include <cslibs_ndt/common/executor.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -25,10 +30,11 @@ namespace cis = cslibs_indexed_storage;
 
 namespace cslibs_ndt_2d {
 namespace dynamic_maps {
-class Gridmap
+template <template <typename, typename> class backend_t = cslibs_ndt::backend::KDTree>
+class BasicGridmap
 {
 public:
-    using Ptr                               = std::shared_ptr<Gridmap>;
+    using Ptr                               = std::shared_ptr<BasicGridmap>;
     using pose_t                            = cslibs_math_2d::Pose2d;
     using transform_t                       = cslibs_math_2d::Transform2d;
     using point_t                           = cslibs_math_2d::Point2d;
@@ -36,16 +42,17 @@ public:
     using mutex_t                           = std::mutex;
     using lock_t                            = std::unique_lock<mutex_t>;
     using distribution_t                    = cslibs_ndt::Distribution<2>;
-    using distribution_storage_t            = cis::Storage<distribution_t, index_t, cis::backend::kdtree::KDTree>;
+    using distribution_storage_t            = backend_t<distribution_t, index_t>;
     using distribution_storage_ptr_t        = std::shared_ptr<distribution_storage_t>;
     using distribution_storage_array_t      = std::array<distribution_storage_ptr_t, 4>;
     using distribution_bundle_t             = cslibs_ndt::Bundle<distribution_t*, 4>;
     using distribution_const_bundle_t       = cslibs_ndt::Bundle<const distribution_t*, 4>;
-    using distribution_bundle_storage_t     = cis::Storage<distribution_bundle_t, index_t, cis::backend::kdtree::KDTree>;
+    using distribution_bundle_storage_t     = backend_t<distribution_bundle_t, index_t>;
     using distribution_bundle_storage_ptr_t = std::shared_ptr<distribution_bundle_storage_t>;
+    using merge_transform_t                 = cslibs_ndt::MergeTransform<2>;
 
-    Gridmap(const pose_t &origin,
-            const double &resolution) :
+    BasicGridmap(const pose_t &origin,
+                 const double &resolution) :
         resolution_(resolution),
         resolution_inv_(1.0 / resolution_),
         bundle_resolution_(0.5 * resolution_),
@@ -62,12 +69,12 @@ public:
     {
     }
 
-    Gridmap(const pose_t &origin,
-            const double &resolution,
-            const index_t &min_index,
-            const index_t &max_index,
-            const std::shared_ptr<distribution_bundle_storage_t> &bundles,
-            const distribution_storage_array_t                   &storage) :
+    BasicGridmap(const pose_t &origin,
+                 const double &resolution,
+                 const index_t &min_index,
+                 const index_t &max_index,
+                 const std::shared_ptr<distribution_bundle_storage_t> &bundles,
+                 const distribution_storage_array_t                   &storage) :
         resolution_(resolution),
         resolution_inv_(1.0 / resolution_),
         bundle_resolution_(0.5 * resolution_),
@@ -81,10 +88,10 @@ public:
     {
     }
 
-    Gridmap(const double &origin_x,
-            const double &origin_y,
-            const double &origin_phi,
-            const double &resolution) :
+    BasicGridmap(const double &origin_x,
+                 const double &origin_y,
+                 const double &origin_phi,
+                 const double &resolution) :
         resolution_(resolution),
         resolution_inv_(1.0 / resolution_),
         bundle_resolution_(0.5 * resolution_),
@@ -145,14 +152,11 @@ public:
                        const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points)
     {
         distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = origin * p;
-            if (pm.isNormal()) {
-                const index_t &bi = toBundleIndex(pm);
-                distribution_t *d = storage.get(bi);
-                (d ? d : &storage.insert(bi, distribution_t()))->data().add(pm);
-            }
-        }
+        const cslibs_ndt::PointIndexer<2, pose_t, transform_t> indexer(origin, m_T_w_, bundle_resolution_inv_);
+        indexer.apply(*points, [&storage](const point_t &pm, const index_t &bi) {
+            distribution_t *d = storage.get(bi);
+            (d ? d : &storage.insert(bi, distribution_t()))->data().add(pm);
+        });
 
         storage.traverse([this](const index_t& bi, const distribution_t &d) {
             distribution_bundle_t *bundle;
@@ -167,6 +171,71 @@ public:
         });
     }
 
+    /**
+     * @brief Fuse the cells of another map of equal resolution into this one,
+     *        e.g. to combine maps of several robots or mapping sessions.
+     *        Maps whose grids are shifted against each other by whole bundles
+     *        are fused exactly, otherwise cells are inserted at their centers.
+     * @param other map to merge, must not be written while merging
+     * @param w_T_o transformation from the world frame of other into the
+     *              world frame of this map
+     */
+    inline void merge(const BasicGridmap &other,
+                      const transform_t &w_T_o = transform_t())
+    {
+        if (&other == this)
+            throw std::runtime_error("[Gridmap]: cannot merge a map into itself");
+        if (std::abs(other.resolution_ - resolution_) > 1e-9)
+            throw std::runtime_error("[Gridmap]: cannot merge maps of different resolution");
+
+        const merge_transform_t merge(w_T_o, m_T_w_ * w_T_o * other.w_T_m_, bundle_resolution_inv_);
+
+        /// every storage covers all points once, unaligned maps only use the first
+        std::vector<std::tuple<std::size_t, index_t, const distribution_t*>> cells;
+        const std::size_t num_storages = merge.isAligned() ? 4 : 1;
+        for (std::size_t s = 0 ; s < num_storages ; ++ s)
+            other.storage_[s]->traverse([&cells, s](const index_t &c, const distribution_t &d) {
+                cells.emplace_back(s, c, &d);
+            });
+
+        /// bundles are allocated sequentially, cells are fused in parallel
+        std::vector<index_t> targets;
+        if (merge.isAligned())
+            other.bundle_storage_->traverse([&targets, &merge](const index_t &bi, const distribution_bundle_t &) {
+                targets.emplace_back(merge.bundle(bi));
+            });
+        else
+            for (const auto &c : cells)
+                targets.emplace_back(merge.center(std::get<0>(c), std::get<1>(c)));
+
+        std::vector<distribution_bundle_t*> bundles;
+        for (const index_t &bi : targets)
+            bundles.emplace_back(getAllocate(bi));
+
+        cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+        cslibs_ndt::Executor::jobs_t jobs;
+        for (const auto &r : executor.split(cells.size(), 1024)) {
+            jobs.emplace_back([this, r, &cells, &bundles, &merge]() {
+                for (std::size_t i = r.first ; i < r.second ; ++ i) {
+                    distribution_t cell;
+                    cell.data() = merge.apply(std::get<2>(cells[i])->getHandle()->data());
+                    if (merge.isAligned()) {
+                        std::size_t s = std::get<0>(cells[i]);
+                        index_t     c = std::get<1>(cells[i]);
+                        merge.cell(s, c);
+                        if (distribution_t *d = storage_[s]->get(c))
+                            d->getHandle()->merge(cell);
+                    } else {
+                        for (std::size_t j = 0 ; j < 4 ; ++ j)
+                            bundles[i]->at(j)->getHandle()->merge(cell);
+                    }
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+    }
+
     inline double sample(const point_t &p) const
     {
         const index_t bi = toBundleIndex(p);
@@ -368,6 +437,10 @@ protected:
                  static_cast<int>(std::floor(p_m(1) * bundle_resolution_inv_))}};
     }
 };
+
+using Gridmap       = BasicGridmap<>;
+using HashGridmap   = BasicGridmap<cslibs_ndt::backend::Hash>;
+using MortonGridmap = BasicGridmap<cslibs_ndt::backend::Morton>;
 }
 }
 
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
 
+#include <cslibs_ndt/common/executor.hpp>
 #include <cslibs_ndt/serialization/filesystem.hpp>
 #include <cslibs_ndt/serialization/storage.hpp>
 
@@ -12,18 +13,18 @@
 #include <yaml-cpp/yaml.h>
 
 #include <fstream>
-#include <thread>
-#include <atomic>
 
 namespace cslibs_ndt_2d {
 namespace dynamic_maps {
-inline bool saveBinary(const cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr &map,
+template <template <typename, typename> class backend_t>
+inline bool saveBinary(const std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>> &map,
                        const std::string &path)
 {
+    using map_t      = cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>;
     using path_t     = boost::filesystem::path;
     using paths_t    = std::array<path_t, 4>;
-    using index_t    = cslibs_ndt_2d::dynamic_maps::Gridmap::index_t;
-    using storages_t = cslibs_ndt_2d::dynamic_maps::Gridmap::distribution_storage_array_t;
+    using index_t    = typename map_t::index_t;
+    using storages_t = typename map_t::distribution_storage_array_t;
     using binary_t   = cslibs_ndt::binary<cslibs_ndt::Distribution, 2, 2>;
 
     /// step one: check if the root diretory exists
@@ -60,27 +61,25 @@ inline bool saveBinary(const cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr &map,
                                   map->getStorages()[2],
                                   map->getStorages()[3]}};
 
-    std::array<std::thread, 4> threads;
-    std::atomic_bool success(true);
+    cslibs_ndt::Executor::jobs_t jobs;
     for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::save(storages[i], paths[i]);
-        });
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i].join();
+        if (!binary_t::save(storages[i], paths[i], jobs))
+            return false;
 
-    return success;
+    return cslibs_ndt::Executor::instance().run(jobs);
 }
 
+template <template <typename, typename> class backend_t>
 inline bool loadBinary(const std::string &path,
-                       cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr &map)
+                       std::shared_ptr<cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>> &map)
 {
+    using map_t            = cslibs_ndt_2d::dynamic_maps::BasicGridmap<backend_t>;
     using path_t           = boost::filesystem::path;
     using paths_t          = std::array<path_t, 4>;
-    using index_t          = cslibs_ndt_2d::dynamic_maps::Gridmap::index_t;
+    using index_t          = typename map_t::index_t;
     using binary_t         = cslibs_ndt::binary<cslibs_ndt::Distribution, 2, 2>;
-    using bundle_storage_t = cslibs_ndt_2d::dynamic_maps::Gridmap::distribution_bundle_storage_t;
-    using storages_t       = cslibs_ndt_2d::dynamic_maps::Gridmap::distribution_storage_array_t;
+    using bundle_storage_t = typename map_t::distribution_bundle_storage_t;
+    using storages_t       = typename map_t::distribution_storage_array_t;
 
     /// step one: check if the root diretory exists
     path_t path_root(path);
@@ -111,20 +110,15 @@ inline bool loadBinary(const std::string &path,
     const index_t                     max_index  = n["max_index"].as<index_t>();
     const std::vector<index_t>        indices    = n["bundles"].as<std::vector<index_t>>();
 
-    std::array<std::thread, 4> threads;
-    std::atomic_bool success(true);
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::load(paths[i], storages[i]);
-        });
+    cslibs_ndt::Executor::jobs_t jobs;
     for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i].join();
-
-    if (!success)
+        if (!binary_t::load(paths[i], storages[i], jobs))
+            return false;
+    if (!cslibs_ndt::Executor::instance().run(jobs))
         return false;
 
     auto allocate_bundle = [&storages, &bundles](const index_t &bi) {
-        cslibs_ndt_2d::dynamic_maps::Gridmap::distribution_bundle_t b;
+        typename map_t::distribution_bundle_t b;
         const int divx = cslibs_math::common::div<int>(bi[0], 2);
         const int divy = cslibs_math::common::div<int>(bi[1], 2);
         const int modx = cslibs_math::common::mod<int>(bi[0], 2);
@@ -144,12 +138,12 @@ inline bool loadBinary(const std::string &path,
     for(const index_t &index : indices)
         allocate_bundle(index);
 
-    map.reset(new cslibs_ndt_2d::dynamic_maps::Gridmap(origin,
-                                                       resolution,
-                                                       min_index,
-                                                       max_index,
-                                                       bundles,
-                                                       storages));
+    map.reset(new map_t(origin,
+                        resolution,
+                        min_index,
+                        max_index,
+                        bundles,
+                        storages));
 
     return true;
 }
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt_2d/static_maps/gridmap.hpp>
 
+#include <cslibs_ndt/common/executor.hpp>
 #include <cslibs_ndt/serialization/filesystem.hpp>
 #include <cslibs_ndt/serialization/storage.hpp>
 
@@ -12,8 +13,6 @@
 #include <yaml-cpp/yaml.h>
 
 #include <fstream>
-#include <thread>
-#include <atomic>
 
 namespace cslibs_ndt_2d {
 namespace static_maps {
@@ -23,52 +22,61 @@ inline bool saveBinary(const cslibs_ndt_2d::static_maps::Gridmap::Ptr &map,
     using path_t     = boost::filesystem::path;
     using paths_t    = std::array<path_t, 4>;
     using index_t    = cslibs_ndt_2d::static_maps::Gridmap::index_t;
+    using size_t     = cslibs_ndt_2d::static_maps::Gridmap::size_t;
     using storages_t = cslibs_ndt_2d::static_maps::Gridmap::distribution_storage_array_t;
     using binary_t   = cslibs_ndt::binary<cslibs_ndt::Distribution, 2, 2>;
+    using linear_t   = cslibs_ndt::linear<2>;
 
     /// step one: check if the root diretory exists
     path_t path_root(path);
     if (!cslibs_ndt::common::serialization::create_directory(path_root))
         return false;
 
-    /// step two: check if the sub folders can be created
+    /// step two: identity subfolders
     const paths_t paths = {{path_root / path_t("store_0.bin"),
                             path_root / path_t("store_1.bin"),
                             path_root / path_t("store_2.bin"),
                             path_root / path_t("store_3.bin")}};
+    const path_t path_bundles = path_root / path_t("bundles.bin");
 
     /// step three: we have our filesystem, now we write out the distributions file by file
     /// meta file
+    const size_t size = map->getSize();
     const path_t path_file = path_t("map.yaml");
     {
         std::ofstream out((path_root / path_file).string(), std::fstream::trunc);
         YAML::Emitter yaml(out);
         YAML::Node n;
-        std::vector<index_t> indices;
-        map->getBundleIndices(indices);
         n["origin"]     = map->getOrigin();
         n["resolution"] = map->getResolution();
-        n["size"]       = map->getSize();
-        n["bundles"]    = indices;
+        n["size"]       = size;
+        n["format"]     = std::string("dense");
         yaml << n;
     }
 
+    /// bundle indices, linearized in the layout of the bundle array
+    {
+        std::vector<index_t> indices;
+        map->getBundleIndices(indices);
+        if (!linear_t::save(indices, {{size[0] * 2, size[1] * 2}}, path_bundles))
+            return false;
+    }
+
     /// step four: write out the storages
     const storages_t storages = {{map->getStorages()[0],
                                   map->getStorages()[1],
                                   map->getStorages()[2],
                                   map->getStorages()[3]}};
 
-    std::array<std::thread, 4> threads;
-    std::atomic_bool success(true);
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::save(storages[i], paths[i]);
-        });
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i].join();
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (std::size_t i = 0 ; i < 4 ; ++i) {
+        const std::size_t off = (i > 0) ? 1 : 0;
+        const size_t      sz  = {{size[0] + off, size[1] + off}};
+        if (!binary_t::saveDense(storages[i], sz, paths[i], jobs))
+            return false;
+    }
 
-    return success;
+    return cslibs_ndt::Executor::instance().run(jobs);
 }
 
 inline bool loadBinary(const std::string &path,
@@ -79,6 +87,7 @@ inline bool loadBinary(const std::string &path,
     using index_t          = cslibs_ndt_2d::static_maps::Gridmap::index_t;
     using size_t           = cslibs_ndt_2d::static_maps::Gridmap::size_t;
     using binary_t         = cslibs_ndt::binary<cslibs_ndt::Distribution, 2, 2>;
+    using linear_t         = cslibs_ndt::linear<2>;
     using bundle_storage_t = cslibs_ndt_2d::static_maps::Gridmap::distribution_bundle_storage_t;
     using storages_t       = cslibs_ndt_2d::static_maps::Gridmap::distribution_storage_array_t;
 
@@ -108,22 +117,29 @@ inline bool loadBinary(const std::string &path,
     const cslibs_math_2d::Transform2d origin     = n["origin"].as<cslibs_math_2d::Transform2d>();
     const double                      resolution = n["resolution"].as<double>();
     const size_t                      size       = n["size"].as<size_t>();
-    const std::vector<index_t>        indices    = n["bundles"].as<std::vector<index_t>>();
     bundles->template set<cslibs_indexed_storage::option::tags::array_size>(size[0] * 2, size[1] * 2);
 
-    std::array<std::thread, 4> threads;
-    std::atomic_bool success(true);
-    for (std::size_t i = 0 ; i < 4 ; ++ i) {
-        const int off   = (i > 1) ? 1 : 0;
-        const size_t sz = {{size[0] + off, size[1] + off}};
-        threads[i] = std::thread([&storages, &paths, i, &sz, &success](){
-            success = success && binary_t::load(paths[i], storages[i], sz);
-        });
+    /// maps written before the dense format list their bundles in the meta file
+    const bool dense = n["format"].IsDefined() && n["format"].as<std::string>() == "dense";
+    std::vector<index_t> indices;
+    if (dense) {
+        const path_t path_bundles = path_root / path_t("bundles.bin");
+        if (!cslibs_ndt::common::serialization::check_file(path_bundles) ||
+                !linear_t::load(path_bundles, {{size[0] * 2, size[1] * 2}}, indices))
+            return false;
+    } else
+        indices = n["bundles"].as<std::vector<index_t>>();
+
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (std::size_t i = 0 ; i < 4 ; ++i) {
+        const std::size_t off = (i > 0) ? 1 : 0;
+        const size_t      sz  = {{size[0] + off, size[1] + off}};
+        const bool success = dense ? binary_t::loadDense(paths[i], storages[i], sz, jobs) :
+                                     binary_t::load(paths[i], storages[i], sz, jobs);
+        if (!success)
+            return false;
     }
-    for (std::size_t i = 0 ; i < 4 ; ++ i)
-        threads[i].join();
-
-    if (!success)
+    if (!cslibs_ndt::Executor::instance().run(jobs))
         return false;
 
     auto allocate_bundle = [&storages, &bundles](const index_t &bi) {
@@ -144,7 +160,7 @@ inline bool loadBinary(const std::string &path,
         b[3] = storages[3]->get(storage_3_index);
         bundles->insert(bi, b);
     };
-    for(const index_t &index : indices)
+    for (const index_t &index : indices)
         allocate_bundle(index);
 
     map.reset(new cslibs_ndt_2d::static_maps::Gridmap(origin,
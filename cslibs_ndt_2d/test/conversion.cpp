@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_2d/conversion/likelihood_field_gridmap.hpp>
+
+#include <cslibs_gridmaps/static_maps/algorithms/distance_transform.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t MAX_NUM_SAMPLES = 100;
+
+template <std::size_t Dim>
+using rng_t = typename cslibs_math::random::Uniform<Dim>;
+
+TEST(Test_cslibs_ndt_2d, testDistanceTransform)
+{
+    const std::size_t width      = 157;
+    const std::size_t height     = 93;
+    const double      resolution = 0.05;
+    const double      threshold  = 0.169;
+    rng_t<1> rng_value(0.0, 1.0);
+
+    std::vector<double> raster(width * height);
+    for (double &v : raster)
+        v = rng_value.get() < 0.01 ? 1.0 : 0.0;
+
+    for (const double maximum_distance : {0.3, 2.0, 100.0}) {
+        std::vector<double> expected;
+        cslibs_gridmaps::static_maps::algorithms::DistanceTransform<double>(resolution, maximum_distance, threshold).apply(
+                    raster, width, expected);
+
+        std::vector<double> distances = raster;
+        cslibs_ndt_2d::conversion::DistanceTransform(resolution, maximum_distance, threshold).apply(
+                    width, height, distances);
+        for (std::size_t i = 0 ; i < raster.size() ; ++ i)
+            EXPECT_NEAR(expected[i], distances[i], 1e-4);
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapLikelihoodField)
+{
+    using map_t   = cslibs_ndt_2d::dynamic_maps::Gridmap;
+    using field_t = cslibs_gridmaps::static_maps::LikelihoodFieldGridmap;
+    rng_t<1> rng_offset(-0.2, 0.2);
+
+    // two compact clusters, each inside a single bundle
+    typename map_t::Ptr map(new map_t(cslibs_math_2d::Transform2d(), 1.0));
+    for (std::size_t i = 0 ; i < 10 * MAX_NUM_SAMPLES ; ++ i) {
+        map->add(cslibs_math_2d::Point2d(1.25 + rng_offset.get(), 1.25 + rng_offset.get()));
+        map->add(cslibs_math_2d::Point2d(4.25 + rng_offset.get(), 4.25 + rng_offset.get()));
+    }
+
+    const double resolution = 0.05;
+    field_t::Ptr raster, analytic;
+    cslibs_ndt_2d::conversion::from(map, raster, resolution);
+    cslibs_ndt_2d::conversion::fromDistributions(map, analytic, resolution);
+    EXPECT_NE(analytic, nullptr);
+    EXPECT_EQ(raster->getWidth(),  analytic->getWidth());
+    EXPECT_EQ(raster->getHeight(), analytic->getHeight());
+    EXPECT_GT(*std::max_element(analytic->getData().begin(), analytic->getData().end()), 0.99);
+
+    // both see the same obstacles, up to the raster resolution
+    const double minimum = std::exp(-2.0 * 2.0 * 2.0);
+    for (std::size_t i = 0 ; i < analytic->getData().size() ; ++ i) {
+        EXPECT_GE(analytic->getData()[i], minimum - 1e-6);
+        EXPECT_LE(analytic->getData()[i], 1.0);
+        EXPECT_NEAR(raster->getData()[i], analytic->getData()[i], 0.1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,104 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_BINARY_GRIDMAP_HPP
+#define CSLIBS_NDT_3D_CONVERSION_BINARY_GRIDMAP_HPP
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt_3d/conversion/projection.hpp>
+
+#include <cslibs_gridmaps/static_maps/binary_gridmap.h>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+namespace impl {
+/**
+ * @brief Project src into dst and threshold. If columns are given and dst
+ *        still matches the extent of src, only these bundle columns are
+ *        projected again, otherwise dst is rebuilt.
+ */
+template <typename src_map_t, typename weight_fn_t>
+inline void from(const src_map_t                                  &src,
+                 cslibs_gridmaps::static_maps::BinaryGridmap::Ptr &dst,
+                 const Projection                                 &projection,
+                 const double                                      sampling_resolution,
+                 const double                                      threshold,
+                 const Projection::columns_t                      &columns,
+                 const weight_fn_t                                &weight)
+{
+    cslibs_math_2d::Pose2d origin;
+    std::size_t width, height;
+    if (!projection.extent(src, origin, width, height))
+        return;
+
+    using dst_map_t = cslibs_gridmaps::static_maps::BinaryGridmap;
+    const bool incremental = !columns.empty() && dst &&
+            dst->getWidth() == width && dst->getHeight() == height &&
+            std::fabs(dst->getResolution() - sampling_resolution) < 1e-9;
+    if (!incremental) {
+        dst.reset(new dst_map_t(origin, sampling_resolution, height, width));
+        std::fill(dst->getData().begin(), dst->getData().end(), dst_map_t::FREE);
+    }
+
+    dst_map_t &map = *dst;
+    projection.apply(src, weight, incremental ? columns : Projection::columns_t(),
+                     [&map, threshold](const std::size_t x, const std::size_t y, const double v) {
+        map.at(x, y) = v >= threshold ? dst_map_t::OCCUPIED : dst_map_t::FREE;
+    });
+}
+}
+
+/**
+ * @brief Project the distributions within [z_min, z_max] onto a 2D grid and
+ *        mark pixels of at least threshold as occupied.
+ * @param columns bundle columns changed since dst was produced, they are
+ *                updated in place if the map did not grow
+ */
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
+        cslibs_gridmaps::static_maps::BinaryGridmap::Ptr &dst,
+        const double &sampling_resolution,
+        const double &z_min,
+        const double &z_max,
+        const double &threshold = 0.169,
+        const Projection::columns_t &columns = Projection::columns_t())
+{
+    if (!src)
+        return;
+
+    using src_map_t = cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>;
+    auto weight = [](const typename src_map_t::distribution_t *d) {
+        return std::make_pair(d ? &d->getHandle()->data() : nullptr, 1.0);
+    };
+    impl::from(*src, dst, Projection(sampling_resolution, z_min, z_max), sampling_resolution, threshold, columns, weight);
+}
+
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
+        cslibs_gridmaps::static_maps::BinaryGridmap::Ptr &dst,
+        const double &sampling_resolution,
+        const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
+        const double &z_min,
+        const double &z_max,
+        const double &threshold = 0.169,
+        const Projection::columns_t &columns = Projection::columns_t())
+{
+    if (!src || !inverse_model)
+        return;
+
+    using src_map_t = cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>;
+    using stat_t    = cslibs_math::statistics::Distribution<3, 3>;
+    auto weight = [&inverse_model](const typename src_map_t::distribution_t *d) {
+        if (!d)
+            return std::make_pair(static_cast<const stat_t*>(nullptr), 0.0);
+        const auto &handle = d->getHandle();
+        return std::make_pair(static_cast<const stat_t*>(handle->getDistribution().get()),
+                              handle->getOccupancy(inverse_model));
+    };
+    impl::from(*src, dst, Projection(sampling_resolution, z_min, z_max), sampling_resolution, threshold, columns, weight);
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_BINARY_GRIDMAP_HPP
@@ -0,0 +1,285 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_DISTANCE_FIELD_HPP
+#define CSLIBS_NDT_3D_CONVERSION_DISTANCE_FIELD_HPP
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt_3d/conversion/distance_transform.hpp>
+
+#include <cslibs_ndt/common/executor.hpp>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Dense 3D (signed) distance field, voxel (x, y, z) holds the distance
+ *        at origin * ((x, y, z) * resolution). Queries interpolate trilinearly,
+ *        points outside of the grid are at the maximum distance.
+ */
+class DistanceField
+{
+public:
+    using Ptr     = std::shared_ptr<DistanceField>;
+    using pose_t  = cslibs_math_3d::Transform3d;
+    using point_t = cslibs_math_3d::Point3d;
+    using size_t  = std::array<std::size_t, 3>;
+
+    inline DistanceField(const pose_t &origin,
+                         const double  resolution,
+                         const double  maximum_distance,
+                         const size_t &size) :
+        origin_(origin),
+        w_T_m_(origin.inverse()),
+        resolution_(resolution),
+        resolution_inv_(1.0 / resolution),
+        maximum_distance_(maximum_distance),
+        size_(size),
+        data_(size[0] * size[1] * size[2], static_cast<float>(maximum_distance))
+    {
+    }
+
+    inline const pose_t& getOrigin() const
+    {
+        return origin_;
+    }
+
+    inline double getResolution() const
+    {
+        return resolution_;
+    }
+
+    inline double getMaximumDistance() const
+    {
+        return maximum_distance_;
+    }
+
+    inline const size_t& getSize() const
+    {
+        return size_;
+    }
+
+    inline std::vector<float>& getData()
+    {
+        return data_;
+    }
+
+    inline const std::vector<float>& getData() const
+    {
+        return data_;
+    }
+
+    inline float& at(const std::size_t x, const std::size_t y, const std::size_t z)
+    {
+        return data_[(z * size_[1] + y) * size_[0] + x];
+    }
+
+    inline float at(const std::size_t x, const std::size_t y, const std::size_t z) const
+    {
+        return data_[(z * size_[1] + y) * size_[0] + x];
+    }
+
+    inline double distance(const point_t &p_w) const
+    {
+        std::array<std::size_t, 3> i;
+        std::array<double, 3>      t;
+        if (!locate(p_w, i, t))
+            return maximum_distance_;
+
+        const std::array<double, 8> c = corners(i);
+        const double c00 = c[0] + t[0] * (c[1] - c[0]);
+        const double c10 = c[2] + t[0] * (c[3] - c[2]);
+        const double c01 = c[4] + t[0] * (c[5] - c[4]);
+        const double c11 = c[6] + t[0] * (c[7] - c[6]);
+        const double c0  = c00 + t[1] * (c10 - c00);
+        const double c1  = c01 + t[1] * (c11 - c01);
+        return c0 + t[2] * (c1 - c0);
+    }
+
+    /**
+     * @brief Gradient of the interpolated distance in world coordinates, zero
+     *        outside of the grid.
+     */
+    inline point_t gradient(const point_t &p_w) const
+    {
+        std::array<std::size_t, 3> i;
+        std::array<double, 3>      t;
+        if (!locate(p_w, i, t))
+            return point_t(0.0, 0.0, 0.0);
+
+        const std::array<double, 8> c = corners(i);
+        const double s[3] = {1.0 - t[0], 1.0 - t[1], 1.0 - t[2]};
+        const double gx = ((c[1] - c[0]) * s[1] * s[2] + (c[3] - c[2]) * t[1] * s[2] +
+                           (c[5] - c[4]) * s[1] * t[2] + (c[7] - c[6]) * t[1] * t[2]) * resolution_inv_;
+        const double gy = ((c[2] - c[0]) * s[0] * s[2] + (c[3] - c[1]) * t[0] * s[2] +
+                           (c[6] - c[4]) * s[0] * t[2] + (c[7] - c[5]) * t[0] * t[2]) * resolution_inv_;
+        const double gz = ((c[4] - c[0]) * s[0] * s[1] + (c[5] - c[1]) * t[0] * s[1] +
+                           (c[6] - c[2]) * s[0] * t[1] + (c[7] - c[3]) * t[0] * t[1]) * resolution_inv_;
+
+        /// rotate only, the translation cancels out
+        return origin_ * point_t(gx, gy, gz) - origin_ * point_t(0.0, 0.0, 0.0);
+    }
+
+private:
+    const pose_t       origin_;
+    const pose_t       w_T_m_;
+    const double       resolution_;
+    const double       resolution_inv_;
+    const double       maximum_distance_;
+    const size_t       size_;
+    std::vector<float> data_;
+
+    inline bool locate(const point_t              &p_w,
+                       std::array<std::size_t, 3> &i,
+                       std::array<double, 3>      &t) const
+    {
+        const point_t p_m = w_T_m_ * p_w;
+        for (std::size_t d = 0 ; d < 3 ; ++ d) {
+            if (size_[d] < 2)
+                return false;
+            const double c = p_m(d) * resolution_inv_;
+            if (!(c >= 0.0) || c > static_cast<double>(size_[d] - 1))
+                return false;
+            i[d] = std::min(static_cast<std::size_t>(c), size_[d] - 2);
+            t[d] = c - static_cast<double>(i[d]);
+        }
+        return true;
+    }
+
+    /// corner values ordered with x fastest and z slowest
+    inline std::array<double, 8> corners(const std::array<std::size_t, 3> &i) const
+    {
+        std::array<double, 8> c;
+        for (std::size_t j = 0 ; j < 8 ; ++ j)
+            c[j] = at(i[0] + (j & 1ul), i[1] + ((j >> 1) & 1ul), i[2] + ((j >> 2) & 1ul));
+        return c;
+    }
+};
+
+namespace impl {
+/**
+ * @brief Sample every bundle of the map at sampling resolution into a dense
+ *        grid covering all bundles and run the distance transform on it.
+ *        Bundles write disjoint voxels, so they are sampled in parallel.
+ */
+template <typename src_map_t, typename sample_fn_t>
+inline void from(const src_map_t          &src,
+                 DistanceField::Ptr       &dst,
+                 const double              sampling_resolution,
+                 const double              maximum_distance,
+                 const double              threshold,
+                 const bool                signed_distance,
+                 const sample_fn_t        &sample)
+{
+    using index_t               = std::array<int, 3>;
+    using distribution_bundle_t = typename src_map_t::distribution_bundle_t;
+
+    const index_t min_bi = src.getMinDistributionIndex();
+    const index_t max_bi = src.getMaxDistributionIndex();
+    for (std::size_t i = 0 ; i < 3 ; ++ i)
+        if (min_bi[i] == std::numeric_limits<int>::max() ||
+                max_bi[i] == std::numeric_limits<int>::min())
+            return;
+
+    const double bundle_resolution = src.getBundleResolution();
+    const int    chunk_step        = static_cast<int>(bundle_resolution / sampling_resolution);
+    if (chunk_step < 1)
+        return;
+
+    DistanceField::size_t size;
+    for (std::size_t i = 0 ; i < 3 ; ++ i)
+        size[i] = static_cast<std::size_t>(max_bi[i] - min_bi[i] + 1) * chunk_step;
+
+    dst.reset(new DistanceField(src.getOrigin(), sampling_resolution, maximum_distance, size));
+    std::vector<float> &data = dst->getData();
+    std::fill(data.begin(), data.end(), 0.0f);
+
+    std::vector<std::pair<index_t, const distribution_bundle_t*>> bundles;
+    src.traverse([&bundles](const index_t &bi, const distribution_bundle_t &b) {
+        bundles.emplace_back(bi, &b);
+    });
+
+    cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (const auto &r : executor.split(bundles.size(), 16)) {
+        jobs.emplace_back([&bundles, &data, &size, &min_bi, &sample, bundle_resolution, sampling_resolution, chunk_step, r]() {
+            for (std::size_t j = r.first ; j < r.second ; ++ j) {
+                const index_t               &bi = bundles[j].first;
+                const distribution_bundle_t &b  = *bundles[j].second;
+                for (int m = 0 ; m < chunk_step ; ++ m) {
+                    const std::size_t z = static_cast<std::size_t>((bi[2] - min_bi[2]) * chunk_step + m);
+                    for (int l = 0 ; l < chunk_step ; ++ l) {
+                        const std::size_t y = static_cast<std::size_t>((bi[1] - min_bi[1]) * chunk_step + l);
+                        float *row = data.data() + (z * size[1] + y) * size[0];
+                        for (int k = 0 ; k < chunk_step ; ++ k) {
+                            const std::size_t x = static_cast<std::size_t>((bi[0] - min_bi[0]) * chunk_step + k);
+                            const cslibs_math_3d::Point3d p(bi[0] * bundle_resolution + k * sampling_resolution,
+                                                            bi[1] * bundle_resolution + l * sampling_resolution,
+                                                            bi[2] * bundle_resolution + m * sampling_resolution);
+                            row[x] = static_cast<float>(sample(p, b));
+                        }
+                    }
+                }
+            }
+            return true;
+        });
+    }
+    executor.run(jobs);
+
+    const DistanceTransform transform(sampling_resolution, maximum_distance, threshold);
+    if (signed_distance)
+        transform.applySigned(size, data);
+    else
+        transform.apply(size, data);
+}
+}
+
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
+        DistanceField::Ptr &dst,
+        const double &sampling_resolution,
+        const double &maximum_distance = 2.0,
+        const double &threshold        = 0.169,
+        const bool   &signed_distance  = false)
+{
+    if (!src)
+        return;
+
+    using src_map_t = cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>;
+    auto sample = [](const cslibs_math_3d::Point3d &p, const typename src_map_t::distribution_bundle_t &bundle) {
+        double s = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            s += bundle.at(i)->getHandle()->data().sampleNonNormalized(p);
+        return 0.125 * s;
+    };
+    impl::from(*src, dst, sampling_resolution, maximum_distance, threshold, signed_distance, sample);
+}
+
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
+        DistanceField::Ptr &dst,
+        const double &sampling_resolution,
+        const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
+        const double &maximum_distance = 2.0,
+        const double &threshold        = 0.169,
+        const bool   &signed_distance  = false)
+{
+    if (!src || !inverse_model)
+        return;
+
+    using src_map_t = cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>;
+    auto sample = [&inverse_model](const cslibs_math_3d::Point3d &p, const typename src_map_t::distribution_bundle_t &bundle) {
+        double s = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++ i) {
+            const auto &handle = bundle.at(i)->getHandle();
+            if (const auto &d = handle->getDistribution())
+                s += d->sampleNonNormalized(p) * handle->getOccupancy(inverse_model);
+        }
+        return 0.125 * s;
+    };
+    impl::from(*src, dst, sampling_resolution, maximum_distance, threshold, signed_distance, sample);
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_DISTANCE_FIELD_HPP
@@ -0,0 +1,217 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_DISTANCE_TRANSFORM_HPP
+#define CSLIBS_NDT_3D_CONVERSION_DISTANCE_TRANSFORM_HPP
+
+#include <array>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include <cslibs_ndt/common/executor.hpp>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Exact Euclidean distance transform of a voxel grid, computed in place
+ *        by one pass per axis. The first pass sweeps whole slices along z, its
+ *        inner loop runs over contiguous memory, the other two compute the
+ *        lower envelope of parabolas (Felzenszwalb and Huttenlocher) along y
+ *        and x. Every pass is split over the executor.
+ */
+class DistanceTransform
+{
+public:
+    using size_t = std::array<std::size_t, 3>;
+
+    /**
+     * @param resolution       edge length of the voxels
+     * @param maximum_distance distances are capped at this value
+     * @param threshold        voxels with values of at least threshold are
+     *                         obstacles
+     */
+    inline DistanceTransform(const double resolution,
+                             const double maximum_distance,
+                             const double threshold) :
+        resolution_(resolution),
+        maximum_distance_(maximum_distance),
+        threshold_(threshold)
+    {
+    }
+
+    /**
+     * @brief Replace the voxel values, stored x fastest and z slowest, by the
+     *        distance to the closest obstacle.
+     */
+    template <typename T>
+    inline void apply(const size_t   &size,
+                      std::vector<T> &data) const
+    {
+        const float thr = static_cast<float>(threshold_);
+        transform(size, data, [thr](const T v) { return static_cast<float>(v) >= thr; });
+    }
+
+    /**
+     * @brief Signed variant, voxels inside obstacles get the negative distance
+     *        to the closest free voxel.
+     */
+    template <typename T>
+    inline void applySigned(const size_t   &size,
+                            std::vector<T> &data) const
+    {
+        const float thr = static_cast<float>(threshold_);
+        std::vector<T> inside(data);
+        transform(size, data,   [thr](const T v) { return static_cast<float>(v) >= thr; });
+        transform(size, inside, [thr](const T v) { return static_cast<float>(v) <  thr; });
+
+        T       *d = data.data();
+        const T *i = inside.data();
+        const std::size_t n = std::min(data.size(), inside.size());
+        for (std::size_t j = 0 ; j < n ; ++ j)
+            d[j] = d[j] > T(0) ? d[j] : -i[j];
+    }
+
+private:
+    const double resolution_;
+    const double maximum_distance_;
+    const double threshold_;
+
+    template <typename T, typename Fn>
+    inline void transform(const size_t   &size,
+                          std::vector<T> &data,
+                          const Fn       &obstacle) const
+    {
+        const std::size_t w = size[0];
+        const std::size_t h = size[1];
+        const std::size_t d = size[2];
+        if (w == 0 || h == 0 || d == 0 || data.size() < w * h * d)
+            return;
+
+        const std::size_t slice = w * h;
+        const float cap = static_cast<float>(std::ceil(maximum_distance_ / resolution_) + 1.0);
+
+        cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+        cslibs_ndt::Executor::jobs_t jobs;
+
+        /// distance in voxels to the closest obstacle along z, squared at the end
+        for (const auto &r : executor.split(slice, 256)) {
+            jobs.emplace_back([&data, &obstacle, slice, d, cap, r]() {
+                T *first = data.data();
+                for (std::size_t i = r.first ; i < r.second ; ++ i)
+                    first[i] = obstacle(first[i]) ? T(0) : static_cast<T>(cap);
+                for (std::size_t z = 1 ; z < d ; ++ z) {
+                    const T *prev = data.data() + (z - 1) * slice;
+                    T       *curr = data.data() + z * slice;
+                    for (std::size_t i = r.first ; i < r.second ; ++ i)
+                        curr[i] = obstacle(curr[i]) ? T(0) : std::min(static_cast<T>(cap), prev[i] + T(1));
+                }
+                for (std::size_t z = d - 1 ; z > 0 ; -- z) {
+                    const T *next = data.data() + z * slice;
+                    T       *curr = data.data() + (z - 1) * slice;
+                    for (std::size_t i = r.first ; i < r.second ; ++ i)
+                        curr[i] = std::min(curr[i], next[i] + T(1));
+                }
+                for (std::size_t z = 0 ; z < d ; ++ z) {
+                    T *curr = data.data() + z * slice;
+                    for (std::size_t i = r.first ; i < r.second ; ++ i)
+                        curr[i] *= curr[i];
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+        jobs.clear();
+
+        /// squared distances within the xz planes, lines along y are strided
+        for (const auto &r : executor.split(d, 1)) {
+            jobs.emplace_back([&data, w, h, slice, r]() {
+                envelope_t e(h);
+                for (std::size_t z = r.first ; z < r.second ; ++ z) {
+                    for (std::size_t x = 0 ; x < w ; ++ x) {
+                        T *line = data.data() + z * slice + x;
+                        for (std::size_t y = 0 ; y < h ; ++ y)
+                            e.f[y] = static_cast<float>(line[y * w]);
+                        e.apply();
+                        for (std::size_t y = 0 ; y < h ; ++ y)
+                            line[y * w] = static_cast<T>(e.g[y]);
+                    }
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+        jobs.clear();
+
+        /// rows along x are contiguous, the square root is taken here
+        const float resolution       = static_cast<float>(resolution_);
+        const float maximum_distance = static_cast<float>(maximum_distance_);
+        for (const auto &r : executor.split(h * d, 16)) {
+            jobs.emplace_back([&data, w, resolution, maximum_distance, r]() {
+                envelope_t e(w);
+                for (std::size_t l = r.first ; l < r.second ; ++ l) {
+                    T *row = data.data() + l * w;
+                    for (std::size_t x = 0 ; x < w ; ++ x)
+                        e.f[x] = static_cast<float>(row[x]);
+                    e.apply();
+                    for (std::size_t x = 0 ; x < w ; ++ x)
+                        row[x] = static_cast<T>(std::min(maximum_distance, std::sqrt(e.g[x]) * resolution));
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+    }
+
+    /// lower envelope of the parabolas rooted at f, scratch space reused per line
+    struct envelope_t {
+        std::vector<float> f;
+        std::vector<float> g;
+        std::vector<float> z;
+        std::vector<int>   v;
+
+        inline explicit envelope_t(const std::size_t n) :
+            f(n),
+            g(n),
+            z(n + 1),
+            v(n)
+        {
+        }
+
+        inline void apply()
+        {
+            const int n = static_cast<int>(f.size());
+            int k = 0;
+            v[0] = 0;
+            z[0] = -std::numeric_limits<float>::infinity();
+            z[1] =  std::numeric_limits<float>::infinity();
+            for (int q = 1 ; q < n ; ++ q) {
+                float s;
+                while ((s = intersection(q, v[k])) <= z[k])
+                    -- k;
+                ++ k;
+                v[k]     = q;
+                z[k]     = s;
+                z[k + 1] = std::numeric_limits<float>::infinity();
+            }
+
+            k = 0;
+            for (int q = 0 ; q < n ; ++ q) {
+                while (z[k + 1] < q)
+                    ++ k;
+                const float dq = static_cast<float>(q - v[k]);
+                g[q] = dq * dq + f[v[k]];
+            }
+        }
+
+        /// position where the parabolas rooted at q and p intersect, arranged
+        /// to avoid the squares of large positions in float
+        inline float intersection(const int q,
+                                  const int p) const
+        {
+            return 0.5f * ((f[q] - f[p]) / static_cast<float>(q - p) + static_cast<float>(q + p));
+        }
+    };
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_DISTANCE_TRANSFORM_HPP
@@ -4,118 +4,312 @@
 #include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
 
+#include <cslibs_ndt_3d/conversion/eigen_decomposition.hpp>
+
+#include <cslibs_ndt/common/executor.hpp>
+
 #include <cslibs_ndt_3d/DistributionArray.h>
 
 namespace cslibs_ndt_3d {
 namespace conversion {
+/**
+ * @brief Id of the bundle at bi, 21 bits per axis. Unlike the ids of the
+ *        bundles themselves it does not change when a bundle is copied, e.g.
+ *        by conversions or when loading a map, so updates refer to the same
+ *        distributions as the full map.
+ */
+inline std::uint64_t bundleId(const std::array<int, 3> &bi)
+{
+    const std::uint64_t mask   = (1ull << 21) - 1ull;
+    const std::int64_t  offset = 1ll << 20;
+    return ((static_cast<std::uint64_t>(bi[0] + offset) & mask) << 42) |
+           ((static_cast<std::uint64_t>(bi[1] + offset) & mask) << 21) |
+            (static_cast<std::uint64_t>(bi[2] + offset) & mask);
+}
+
 inline Distribution from(const cslibs_math::statistics::Distribution<3, 3> &d,
-                         const int &id,
-                         const double &prob)
+                         const std::uint64_t &id,
+                         const double &prob,
+                         const EigenDecomposition::values_t  &eigen_values,
+                         const EigenDecomposition::vectors_t &eigen_vectors)
 {
+    const auto &mean       = d.getMean();
+    const auto  covariance = d.getCovariance();
+
     Distribution distr;
     distr.id.data = id;
     for (int i = 0; i < 3; ++ i) {
-        distr.mean[i].data          = d.getMean()(i);
-        distr.eigen_values[i].data  = d.getEigenValues()(i);
+        distr.mean[i].data          = mean(i);
+        distr.eigen_values[i].data  = eigen_values(i);
     }
     for (int i = 0; i < 9; ++ i) {
-        distr.eigen_vectors[i].data = d.getEigenVectors()(i);
-        distr.covariance[i].data    = d.getCovariance()(i);
+        distr.eigen_vectors[i].data = eigen_vectors(i);
+        distr.covariance[i].data    = covariance(i);
     }
     distr.prob.data = prob;
     return distr;
 }
 
+inline Distribution from(const cslibs_math::statistics::Distribution<3, 3> &d,
+                         const std::uint64_t &id,
+                         const double &prob)
+{
+    EigenDecomposition::values_t  eigen_values;
+    EigenDecomposition::vectors_t eigen_vectors;
+    EigenDecomposition::apply(d.getCovariance(), eigen_values, eigen_vectors);
+    return from(d, id, prob, eigen_values, eigen_vectors);
+}
+
+namespace impl {
+/**
+ * @brief Merge the cells of a bundle into d, prob is the mean density of the
+ *        cells at the merged mean. False if the bundle holds no samples.
+ */
+inline bool merge(const cslibs_ndt::Bundle<cslibs_ndt::Distribution<3>*, 8> &b,
+                  cslibs_math::statistics::Distribution<3, 3>               &d,
+                  double                                                    &prob)
+{
+    using distribution_t = cslibs_math::statistics::Distribution<3, 3>;
+
+    /// cells are copied while their handle holds the lock, the map may be written concurrently
+    std::array<distribution_t, 8> cells;
+    d = distribution_t();
+    for (std::size_t i = 0; i < 8; ++ i) {
+        cells[i] = b.at(i)->getHandle()->data();
+        d += cells[i];
+    }
+    if (d.getN() == 0)
+        return false;
+
+    const cslibs_math_3d::Point3d mean(d.getMean());
+    prob = 0.0;
+    for (std::size_t i = 0; i < 8; ++ i)
+        prob += cells[i].sampleNonNormalized(mean);
+    prob *= 0.125;
+    return true;
+}
+
+/**
+ * @brief Merge the cells of a bundle into d, prob is the mean density of the
+ *        cells at the merged mean weighted by their occupancy.
+ */
+inline bool merge(const cslibs_ndt::Bundle<cslibs_ndt::OccupancyDistribution<3>*, 8> &b,
+                  const cslibs_gridmaps::utility::InverseModel::Ptr                  &ivm,
+                  cslibs_math::statistics::Distribution<3, 3>                        &d,
+                  double                                                             &prob)
+{
+    using distribution_t = cslibs_math::statistics::Distribution<3, 3>;
+
+    /// statistics and occupancy of a cell are copied under one lock, the map may be written concurrently
+    std::array<distribution_t, 8> cells;
+    std::array<double, 8>         occupancies;
+    d = distribution_t();
+    for (std::size_t i = 0; i < 8; ++ i) {
+        const auto &handle = b.at(i)->getHandle();
+        occupancies[i] = handle->getOccupancy(ivm);
+        if (const auto &cell = handle->getDistribution()) {
+            cells[i] = *cell;
+            d += cells[i];
+        }
+    }
+    if (d.getN() == 0)
+        return false;
+
+    const cslibs_math_3d::Point3d mean(d.getMean());
+    prob = 0.0;
+    for (std::size_t i = 0; i < 8; ++ i)
+        prob += cells[i].sampleNonNormalized(mean) * occupancies[i];
+    prob *= 0.125;
+    return true;
+}
+
+/**
+ * @brief One distribution per bundle for which merge returns true, the ids of
+ *        the others, and of missing bundles, are appended to removed if given.
+ *        Ranges of bundles are merged in parallel, each range decomposes the
+ *        covariances of its distributions in batches and fills a block of its
+ *        own, which is copied to its offset once the exact size is known.
+ */
+template <typename distribution_bundle_t, typename merge_fn_t>
+inline void from(const std::vector<std::pair<std::array<int, 3>, const distribution_bundle_t*>> &bundles,
+                 const merge_fn_t                                                            &merge,
+                 cslibs_ndt_3d::DistributionArray                                            &dst,
+                 std::vector<std::uint64_t>                                                  *removed)
+{
+    using distribution_t = cslibs_math::statistics::Distribution<3, 3>;
+    struct block_t {
+        std::vector<Distribution>  data;
+        std::vector<std::uint64_t> removed;
+    };
+
+    cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+    cslibs_ndt::Executor::jobs_t jobs;
+    const auto ranges = executor.split(bundles.size(), 1024);
+    std::vector<block_t> blocks(ranges.size());
+    for (std::size_t k = 0 ; k < ranges.size() ; ++ k) {
+        jobs.emplace_back([&bundles, &blocks, &ranges, &merge, removed, k]() {
+            const std::size_t size = ranges[k].second - ranges[k].first;
+            std::vector<std::uint64_t>                 ids;
+            std::vector<distribution_t, Eigen::aligned_allocator<distribution_t>> merged;
+            std::vector<double>                        probs;
+            ids.reserve(size);
+            merged.reserve(size);
+            probs.reserve(size);
+
+            distribution_t d;
+            double         prob;
+            for (std::size_t j = ranges[k].first ; j < ranges[k].second ; ++ j) {
+                const std::uint64_t id = bundleId(bundles[j].first);
+                if (bundles[j].second && merge(*bundles[j].second, d, prob)) {
+                    ids.emplace_back(id);
+                    merged.emplace_back(d);
+                    probs.emplace_back(prob);
+                } else if (removed) {
+                    blocks[k].removed.emplace_back(id);
+                }
+            }
+
+            std::vector<EigenDecomposition::matrix_t>  covariances(merged.size());
+            std::vector<EigenDecomposition::values_t>  eigen_values(merged.size());
+            std::vector<EigenDecomposition::vectors_t> eigen_vectors(merged.size());
+            for (std::size_t i = 0 ; i < merged.size() ; ++ i)
+                covariances[i] = merged[i].getCovariance();
+            EigenDecomposition::apply(merged.size(), covariances.data(), eigen_values.data(), eigen_vectors.data());
+
+            std::vector<Distribution> &data = blocks[k].data;
+            data.reserve(merged.size());
+            for (std::size_t i = 0 ; i < merged.size() ; ++ i)
+                data.emplace_back(conversion::from(merged[i], ids[i], probs[i], eigen_values[i], eigen_vectors[i]));
+            return true;
+        });
+    }
+    executor.run(jobs);
+    jobs.clear();
+
+    std::vector<std::size_t> offsets(blocks.size() + 1, 0);
+    for (std::size_t k = 0 ; k < blocks.size() ; ++ k)
+        offsets[k + 1] = offsets[k] + blocks[k].data.size();
+
+    dst.data.resize(offsets.back());
+    for (std::size_t k = 0 ; k < blocks.size() ; ++ k) {
+        jobs.emplace_back([&blocks, &offsets, &dst, k]() {
+            std::copy(blocks[k].data.begin(), blocks[k].data.end(), dst.data.begin() + offsets[k]);
+            return true;
+        });
+    }
+    executor.run(jobs);
+
+    if (removed)
+        for (const block_t &block : blocks)
+            removed->insert(removed->end(), block.removed.begin(), block.removed.end());
+}
+
+/**
+ * @brief Bundles of the whole map.
+ */
+template <typename src_map_t>
+inline std::vector<std::pair<std::array<int, 3>, const typename src_map_t::distribution_bundle_t*>>
+bundles(const src_map_t &src)
+{
+    using index_t               = std::array<int, 3>;
+    using distribution_bundle_t = typename src_map_t::distribution_bundle_t;
+
+    std::vector<std::pair<index_t, const distribution_bundle_t*>> bundles;
+    src.traverse([&bundles](const index_t &bi, const distribution_bundle_t &b) {
+        bundles.emplace_back(bi, &b);
+    });
+    return bundles;
+}
+
+/**
+ * @brief Bundles at the given indices, nullptr where there is none.
+ */
+template <typename src_map_t>
+inline std::vector<std::pair<std::array<int, 3>, const typename src_map_t::distribution_bundle_t*>>
+bundles(const src_map_t &src, const std::vector<std::array<int, 3>> &indices)
+{
+    using index_t               = std::array<int, 3>;
+    using distribution_bundle_t = typename src_map_t::distribution_bundle_t;
+
+    std::vector<std::pair<index_t, const distribution_bundle_t*>> bundles;
+    bundles.reserve(indices.size());
+    for (const index_t &bi : indices)
+        bundles.emplace_back(bi, src.findDistributionBundle(bi));
+    return bundles;
+}
+}
+
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
         cslibs_ndt_3d::DistributionArray::Ptr &dst)
 {
     if (!src)
         return;
 
-    using point_t   = cslibs_math_3d::Point3d;
-    using dst_map_t = cslibs_ndt_3d::DistributionArray;
-    dst.reset(new dst_map_t());
-
-    using distribution_t = cslibs_ndt_3d::dynamic_maps::Gridmap::distribution_t;
-    using distribution_bundle_t = cslibs_ndt_3d::dynamic_maps::Gridmap::distribution_bundle_t;
-    auto sample = [](const distribution_t *d,
-                     const point_t &p) -> double {
-        return d ? d->getHandle()->data().sampleNonNormalized(p) : 0.0;
-    };
-    auto sample_bundle = [&sample](const distribution_bundle_t &b,
-                                   const point_t &p) -> double {
-        return 0.125 * (sample(b.at(0), p) +
-                        sample(b.at(1), p) +
-                        sample(b.at(2), p) +
-                        sample(b.at(3), p) +
-                        sample(b.at(4), p) +
-                        sample(b.at(5), p) +
-                        sample(b.at(6), p) +
-                        sample(b.at(7), p));
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::distribution_bundle_t;
+    auto merge = [](const distribution_bundle_t &b, cslibs_math::statistics::Distribution<3, 3> &d, double &prob) {
+        return impl::merge(b, d, prob);
     };
+    dst.reset(new cslibs_ndt_3d::DistributionArray());
+    impl::from(impl::bundles(*src), merge, *dst, nullptr);
+}
 
-    using index_t = std::array<int, 3>;
-    auto process_bundle = [&dst, &sample_bundle](const index_t &bi, const distribution_bundle_t &b) {
-        distribution_t::distribution_t d;
-        for (std::size_t i = 0; i < 8; ++ i)
-            d += b.at(i)->getHandle()->data();
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
+        cslibs_ndt_3d::DistributionArray::Ptr &dst,
+        const cslibs_gridmaps::utility::InverseModel::Ptr &ivm)
+{
+    if (!src)
+        return;
 
-        if (d.getN() == 0)
-            return;
-        dst->data.emplace_back(from(d, b.id(), sample_bundle(b, point_t(d.getMean()))));
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>::distribution_bundle_t;
+    auto merge = [&ivm](const distribution_bundle_t &b, cslibs_math::statistics::Distribution<3, 3> &d, double &prob) {
+        return impl::merge(b, ivm, d, prob);
     };
+    dst.reset(new cslibs_ndt_3d::DistributionArray());
+    impl::from(impl::bundles(*src), merge, *dst, nullptr);
+}
 
-    src->traverse(process_bundle);
+/**
+ * @brief Incremental update holding the distributions of the given bundles,
+ *        e.g. from takeChangedBundleIndices, bundles which hold none are
+ *        listed as removed.
+ */
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
+        const std::vector<std::array<int, 3>> &indices,
+        cslibs_ndt_3d::DistributionArray::Ptr &dst)
+{
+    if (!src)
+        return;
+
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::distribution_bundle_t;
+    auto merge = [](const distribution_bundle_t &b, cslibs_math::statistics::Distribution<3, 3> &d, double &prob) {
+        return impl::merge(b, d, prob);
+    };
+    dst.reset(new cslibs_ndt_3d::DistributionArray());
+    impl::from(impl::bundles(*src, indices), merge, *dst, &dst->removed);
 }
 
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
+        const std::vector<std::array<int, 3>> &indices,
         cslibs_ndt_3d::DistributionArray::Ptr &dst,
         const cslibs_gridmaps::utility::InverseModel::Ptr &ivm)
 {
     if (!src)
         return;
 
-    using point_t   = cslibs_math_3d::Point3d;
-    using dst_map_t = cslibs_ndt_3d::DistributionArray;
-    dst.reset(new dst_map_t());
-
-    using distribution_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::distribution_t;
-    using distribution_bundle_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::distribution_bundle_t;
-    auto sample = [&ivm](const distribution_t *d,
-                         const point_t &p) -> double {
-        auto evaluate = [&ivm, d, p] {
-            const auto &handle = d->getHandle();
-            return handle->getDistribution() ?
-                        handle->getDistribution()->sampleNonNormalized(p) * handle->getOccupancy(ivm) : 0.0;
-        };
-        return d ? evaluate() : 0.0;
-    };
-    auto sample_bundle = [&sample](const distribution_bundle_t &b,
-                                   const point_t &p) -> double {
-        return 0.125 * (sample(b.at(0), p) +
-                        sample(b.at(1), p) +
-                        sample(b.at(2), p) +
-                        sample(b.at(3), p) +
-                        sample(b.at(4), p) +
-                        sample(b.at(5), p) +
-                        sample(b.at(6), p) +
-                        sample(b.at(7), p));
-    };    
-
-    using index_t = std::array<int, 3>;
-    auto process_bundle = [&dst, &ivm, &sample_bundle](const index_t &bi, const distribution_bundle_t &b) {
-        distribution_t::distribution_t d;
-        for (std::size_t i = 0; i < 8; ++ i)
-            if (const auto &d_tmp = b.at(i)->getHandle()->getDistribution())
-                d += *d_tmp;
-
-        if (d.getN() == 0)
-            return;
-        dst->data.emplace_back(from(d, b.id(), sample_bundle(b, point_t(d.getMean()))));
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>::distribution_bundle_t;
+    auto merge = [&ivm](const distribution_bundle_t &b, cslibs_math::statistics::Distribution<3, 3> &d, double &prob) {
+        return impl::merge(b, ivm, d, prob);
     };
-    src->traverse(process_bundle);
+    dst.reset(new cslibs_ndt_3d::DistributionArray());
+    impl::from(impl::bundles(*src, indices), merge, *dst, &dst->removed);
 }
 }
 }
@@ -0,0 +1,206 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_EIGEN_DECOMPOSITION_HPP
+#define CSLIBS_NDT_3D_CONVERSION_EIGEN_DECOMPOSITION_HPP
+
+#include <cmath>
+#include <algorithm>
+
+#include <Eigen/Core>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Closed-form eigen decomposition of symmetric 3x3 matrices, e.g. the
+ *        covariances of exported distributions. Matrices are processed in
+ *        batches laid out as structure of arrays, so the eigenvalue pass is a
+ *        branch free loop over the lanes of a batch which the compiler can
+ *        vectorise. Eigenvalues are ascending and the eigenvectors are the
+ *        columns of a right-handed rotation, as with a
+ *        Eigen::SelfAdjointEigenSolver up to the signs of the eigenvectors.
+ */
+class EigenDecomposition
+{
+public:
+    using matrix_t  = Eigen::Matrix3d;
+    using values_t  = Eigen::Vector3d;
+    using vectors_t = Eigen::Matrix3d;
+
+    /**
+     * @brief Decompose the n matrices a, values and vectors must hold n entries.
+     */
+    inline static void apply(const std::size_t  n,
+                             const matrix_t    *a,
+                             values_t          *values,
+                             vectors_t         *vectors)
+    {
+        for (std::size_t offset = 0 ; offset < n ; offset += Batch::size)
+            Batch(a + offset, std::min<std::size_t>(Batch::size, n - offset)).apply(values + offset, vectors + offset);
+    }
+
+    inline static void apply(const matrix_t &a,
+                             values_t       &values,
+                             vectors_t      &vectors)
+    {
+        apply(1, &a, &values, &vectors);
+    }
+
+private:
+    struct Batch {
+        enum { size = 8 };
+
+        /// upper triangle, scaled to a maximum absolute entry of one
+        double      a00[size], a01[size], a02[size], a11[size], a12[size], a22[size];
+        double      scale[size];
+        double      l0[size], l1[size], l2[size];
+        std::size_t n;
+
+        inline Batch(const matrix_t *a, const std::size_t n) :
+            n(n)
+        {
+            /// unused lanes repeat the last matrix
+            for (std::size_t i = 0 ; i < size ; ++ i) {
+                const matrix_t &m = a[std::min(i, n - 1)];
+                a00[i] = m(0, 0);
+                a01[i] = m(0, 1);
+                a02[i] = m(0, 2);
+                a11[i] = m(1, 1);
+                a12[i] = m(1, 2);
+                a22[i] = m(2, 2);
+            }
+        }
+
+        inline void apply(values_t *values, vectors_t *vectors)
+        {
+            eigenvalues();
+            for (std::size_t i = 0 ; i < n ; ++ i) {
+                values[i] = values_t(l0[i], l1[i], l2[i]) * scale[i];
+                eigenvectors(i, vectors[i]);
+            }
+        }
+
+        inline void eigenvalues()
+        {
+            const double two_thirds_pi = 2.0 * M_PI / 3.0;
+            for (std::size_t i = 0 ; i < size ; ++ i) {
+                const double s = std::max(std::max(std::max(std::fabs(a00[i]), std::fabs(a01[i])),
+                                                   std::max(std::fabs(a02[i]), std::fabs(a11[i]))),
+                                          std::max(std::fabs(a12[i]), std::fabs(a22[i])));
+                const double s_inv = s > 0.0 ? 1.0 / s : 0.0;
+                scale[i] = s;
+                a00[i] *= s_inv;
+                a01[i] *= s_inv;
+                a02[i] *= s_inv;
+                a11[i] *= s_inv;
+                a12[i] *= s_inv;
+                a22[i] *= s_inv;
+
+                /// eigenvalues of a = q + 2p cos(phi + 2k pi / 3) with b = (a - qI) / p
+                const double q   = (a00[i] + a11[i] + a22[i]) / 3.0;
+                const double b00 = a00[i] - q;
+                const double b11 = a11[i] - q;
+                const double b22 = a22[i] - q;
+                const double p2  = (b00 * b00 + b11 * b11 + b22 * b22 +
+                                    2.0 * (a01[i] * a01[i] + a02[i] * a02[i] + a12[i] * a12[i])) / 6.0;
+                const double p     = std::sqrt(p2);
+                const double p_inv = p > 0.0 ? 1.0 / p : 0.0;
+                const double det   = b00 * (b11 * b22 - a12[i] * a12[i]) -
+                                     a01[i] * (a01[i] * b22 - a12[i] * a02[i]) +
+                                     a02[i] * (a01[i] * a12[i] - b11 * a02[i]);
+                const double r   = std::min(1.0, std::max(-1.0, 0.5 * det * p_inv * p_inv * p_inv));
+                const double phi = std::acos(r) / 3.0;
+                l2[i] = q + 2.0 * p * std::cos(phi);
+                l0[i] = q + 2.0 * p * std::cos(phi + two_thirds_pi);
+                l1[i] = 3.0 * q - l0[i] - l2[i];
+            }
+        }
+
+        inline void eigenvectors(const std::size_t i, vectors_t &v) const
+        {
+            const matrix_t a = (matrix_t() << a00[i], a01[i], a02[i],
+                                              a01[i], a11[i], a12[i],
+                                              a02[i], a12[i], a22[i]).finished();
+            if (l2[i] - l0[i] <= 0.0) {
+                v.setIdentity();
+                return;
+            }
+
+            /// start with the better separated extreme, the other one is found
+            /// in its orthogonal complement, which also covers repeated values
+            const double q = (l0[i] + l1[i] + l2[i]) / 3.0;
+            Eigen::Vector3d v0, v2;
+            if (l2[i] - q >= q - l0[i]) {
+                v2 = extreme(a, l2[i]);
+                v0 = complement(a, v2, l0[i]);
+            } else {
+                v0 = extreme(a, l0[i]);
+                v2 = complement(a, v0, l2[i]);
+            }
+            v.col(0) = v0;
+            v.col(1) = v2.cross(v0);
+            v.col(2) = v2;
+        }
+
+        /// the largest cross product of two rows of a - lI spans its kernel
+        inline static Eigen::Vector3d extreme(const matrix_t &a, const double l)
+        {
+            const matrix_t        m   = a - l * matrix_t::Identity();
+            const Eigen::Vector3d c01 = m.row(0).transpose().cross(m.row(1).transpose());
+            const Eigen::Vector3d c02 = m.row(0).transpose().cross(m.row(2).transpose());
+            const Eigen::Vector3d c12 = m.row(1).transpose().cross(m.row(2).transpose());
+            const double n01 = c01.squaredNorm();
+            const double n02 = c02.squaredNorm();
+            const double n12 = c12.squaredNorm();
+            if (n01 >= n02 && n01 >= n12)
+                return n01 > 0.0 ? Eigen::Vector3d(c01 / std::sqrt(n01)) : Eigen::Vector3d::UnitX();
+            if (n02 >= n12)
+                return c02 / std::sqrt(n02);
+            return c12 / std::sqrt(n12);
+        }
+
+        /// eigenvector of l orthogonal to the unit eigenvector u
+        inline static Eigen::Vector3d complement(const matrix_t &a, const Eigen::Vector3d &u, const double l)
+        {
+            const Eigen::Vector3d e0 = std::fabs(u(0)) > std::fabs(u(1)) ?
+                        Eigen::Vector3d(-u(2), 0.0, u(0)).normalized() :
+                        Eigen::Vector3d(0.0, u(2), -u(1)).normalized();
+            const Eigen::Vector3d e1 = u.cross(e0);
+
+            /// kernel of the restriction of a - lI to span(e0, e1)
+            const Eigen::Vector3d ae0 = a * e0;
+            const Eigen::Vector3d ae1 = a * e1;
+            double m00 = e0.dot(ae0) - l;
+            double m01 = e0.dot(ae1);
+            double m11 = e1.dot(ae1) - l;
+            const double abs00 = std::fabs(m00);
+            const double abs01 = std::fabs(m01);
+            const double abs11 = std::fabs(m11);
+            if (abs00 >= abs11) {
+                if (std::max(abs00, abs01) <= 0.0)
+                    return e0;
+                if (abs00 >= abs01) {
+                    m01 /= m00;
+                    m00  = 1.0 / std::sqrt(1.0 + m01 * m01);
+                    m01 *= m00;
+                } else {
+                    m00 /= m01;
+                    m01  = 1.0 / std::sqrt(1.0 + m00 * m00);
+                    m00 *= m01;
+                }
+                return m01 * e0 - m00 * e1;
+            }
+            if (abs11 >= abs01) {
+                m01 /= m11;
+                m11  = 1.0 / std::sqrt(1.0 + m01 * m01);
+                m01 *= m11;
+            } else {
+                m11 /= m01;
+                m01  = 1.0 / std::sqrt(1.0 + m11 * m11);
+                m11 *= m01;
+            }
+            return m11 * e0 - m01 * e1;
+        }
+    };
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_EIGEN_DECOMPOSITION_HPP
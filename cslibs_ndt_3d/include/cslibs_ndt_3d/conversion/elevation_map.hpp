@@ -0,0 +1,259 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_ELEVATION_MAP_HPP
+#define CSLIBS_NDT_3D_CONVERSION_ELEVATION_MAP_HPP
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+
+#include <cslibs_ndt/common/executor.hpp>
+
+#include <cslibs_math_2d/linear/pose.hpp>
+#include <cslibs_math/common/mod.hpp>
+
+#include <Eigen/Eigenvalues>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Elevation map with one cell per bundle column, describing the top
+ *        surface by the statistics of the highest bundle of the column. As
+ *        map cells are twice the size of bundles, these are the statistics of
+ *        the cell which spans the bundle and the next one along each axis, so
+ *        every sample is counted once and the next column along x and y is
+ *        blended in.
+ */
+class ElevationMap
+{
+public:
+    using Ptr      = std::shared_ptr<ElevationMap>;
+    using pose_t   = cslibs_math_2d::Pose2d;
+    using column_t = std::array<int, 2>;
+
+    struct cell_t {
+        float       height    = 0.0f;  ///< mean height of the top surface
+        float       variance  = 0.0f;  ///< variance of the height
+        float       slope     = 0.0f;  ///< angle between surface normal and z axis
+        float       roughness = 0.0f;  ///< standard deviation along the normal
+        std::size_t n         = 0;     ///< number of samples of the cell, 0 if unknown
+    };
+
+    /**
+     * @param origin     pose of the corner of column min_column
+     * @param min_column first bundle column covered by the map
+     */
+    inline ElevationMap(const pose_t      &origin,
+                        const double       resolution,
+                        const column_t    &min_column,
+                        const std::size_t  width,
+                        const std::size_t  height) :
+        origin_(origin),
+        resolution_(resolution),
+        min_column_(min_column),
+        width_(width),
+        height_(height),
+        data_(width * height)
+    {
+    }
+
+    inline const pose_t& getOrigin() const
+    {
+        return origin_;
+    }
+
+    inline double getResolution() const
+    {
+        return resolution_;
+    }
+
+    inline const column_t& getMinColumn() const
+    {
+        return min_column_;
+    }
+
+    inline std::size_t getWidth() const
+    {
+        return width_;
+    }
+
+    inline std::size_t getHeight() const
+    {
+        return height_;
+    }
+
+    inline std::vector<cell_t>& getData()
+    {
+        return data_;
+    }
+
+    inline const std::vector<cell_t>& getData() const
+    {
+        return data_;
+    }
+
+    inline cell_t& at(const std::size_t x, const std::size_t y)
+    {
+        return data_[y * width_ + x];
+    }
+
+    inline const cell_t& at(const std::size_t x, const std::size_t y) const
+    {
+        return data_[y * width_ + x];
+    }
+
+    /**
+     * @brief Cell of a bundle column, nullptr if outside of the map.
+     */
+    inline const cell_t* get(const column_t &c) const
+    {
+        const int x = c[0] - min_column_[0];
+        const int y = c[1] - min_column_[1];
+        return x >= 0 && y >= 0 && x < static_cast<int>(width_) && y < static_cast<int>(height_) ?
+                    &at(static_cast<std::size_t>(x), static_cast<std::size_t>(y)) : nullptr;
+    }
+
+private:
+    const pose_t        origin_;
+    const double        resolution_;
+    const column_t      min_column_;
+    const std::size_t   width_;
+    const std::size_t   height_;
+    std::vector<cell_t> data_;
+};
+
+namespace impl {
+/**
+ * @brief Fill the elevation map of the bundle columns in [min_column,
+ *        max_column]. Bundles are grouped by column, and the columns are
+ *        evaluated in parallel.
+ */
+template <template <typename, typename> class backend_t>
+inline void from(const cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t> &src,
+                 ElevationMap::Ptr                                          &dst,
+                 const ElevationMap::column_t                               &min_column,
+                 const ElevationMap::column_t                               &max_column,
+                 const std::size_t                                           min_samples)
+{
+    using src_map_t             = cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>;
+    using index_t               = typename src_map_t::index_t;
+    using distribution_bundle_t = typename src_map_t::distribution_bundle_t;
+    using entry_t               = std::pair<index_t, const distribution_bundle_t*>;
+
+    if (max_column[0] < min_column[0] || max_column[1] < min_column[1])
+        return;
+
+    const double bundle_resolution = src.getBundleResolution();
+    const cslibs_math_3d::Transform3d o = src.getInitialOrigin() *
+            cslibs_math_3d::Transform3d(min_column[0] * bundle_resolution, min_column[1] * bundle_resolution, 0.0);
+    dst.reset(new ElevationMap(cslibs_math_2d::Pose2d(o.tx(), o.ty(), o.yaw()),
+                               bundle_resolution,
+                               min_column,
+                               static_cast<std::size_t>(max_column[0] - min_column[0] + 1),
+                               static_cast<std::size_t>(max_column[1] - min_column[1] + 1)));
+
+    /// bundles of every column, highest first
+    std::vector<entry_t> entries;
+    src.traverse([&entries, &min_column, &max_column](const index_t &bi, const distribution_bundle_t &b) {
+        if (bi[0] >= min_column[0] && bi[0] <= max_column[0] &&
+                bi[1] >= min_column[1] && bi[1] <= max_column[1])
+            entries.emplace_back(bi, &b);
+    });
+    std::sort(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b) {
+        return a.first[0] != b.first[0] ? a.first[0] < b.first[0] :
+               a.first[1] != b.first[1] ? a.first[1] < b.first[1] :
+                                          a.first[2] > b.first[2];
+    });
+
+    std::vector<std::size_t> groups;
+    for (std::size_t i = 0 ; i < entries.size() ; ++ i)
+        if (i == 0 || entries[i].first[0] != entries[i - 1].first[0] || entries[i].first[1] != entries[i - 1].first[1])
+            groups.emplace_back(i);
+    groups.emplace_back(entries.size());
+
+    ElevationMap &map = *dst;
+    cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (const auto &r : executor.split(groups.size() - 1, 64)) {
+        jobs.emplace_back([&entries, &groups, &map, &min_column, min_samples, r]() {
+            for (std::size_t g = r.first ; g < r.second ; ++ g) {
+                for (std::size_t e = groups[g] ; e < groups[g + 1] ; ++ e) {
+                    /// storage s is shifted by one bundle along the axes of its set
+                    /// bits, the one matching the parity of the bundle index starts at it
+                    const index_t &bi = entries[e].first;
+                    const std::size_t s = static_cast<std::size_t>(cslibs_math::common::mod<int>(bi[0], 2)) |
+                                          static_cast<std::size_t>(cslibs_math::common::mod<int>(bi[1], 2)) << 1 |
+                                          static_cast<std::size_t>(cslibs_math::common::mod<int>(bi[2], 2)) << 2;
+                    const cslibs_math::statistics::Distribution<3, 3> d = entries[e].second->at(s)->getHandle()->data();
+                    if (d.getN() < std::max<std::size_t>(min_samples, 3ul))
+                        continue;
+
+                    /// the eigenvector of the smallest eigenvalue is the surface normal
+                    const Eigen::Matrix3d covariance = d.getCovariance();
+                    const Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+                    const double normal_z = std::fabs(solver.eigenvectors()(2, 0));
+
+                    ElevationMap::cell_t &cell = map.at(static_cast<std::size_t>(bi[0] - min_column[0]),
+                                                        static_cast<std::size_t>(bi[1] - min_column[1]));
+                    cell.height    = static_cast<float>(d.getMean()(2));
+                    cell.variance  = static_cast<float>(covariance(2, 2));
+                    cell.slope     = static_cast<float>(std::acos(std::min(1.0, normal_z)));
+                    cell.roughness = static_cast<float>(std::sqrt(std::max(0.0, solver.eigenvalues()(0))));
+                    cell.n         = d.getN();
+                    break;
+                }
+            }
+            return true;
+        });
+    }
+    executor.run(jobs);
+}
+}
+
+/**
+ * @brief Elevation map of all bundle columns of src.
+ * @param min_samples columns whose top cell holds fewer samples are skipped
+ *                    in favour of the next lower one
+ */
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
+        ElevationMap::Ptr &dst,
+        const std::size_t &min_samples = 3)
+{
+    if (!src)
+        return;
+
+    const std::array<int, 3> min_bi = src->getMinDistributionIndex();
+    const std::array<int, 3> max_bi = src->getMaxDistributionIndex();
+    if (min_bi[0] == std::numeric_limits<int>::max() ||
+            min_bi[1] == std::numeric_limits<int>::max() ||
+            max_bi[0] == std::numeric_limits<int>::min() ||
+            max_bi[1] == std::numeric_limits<int>::min())
+        return;
+
+    impl::from(*src, dst, {{min_bi[0], min_bi[1]}}, {{max_bi[0], max_bi[1]}}, min_samples);
+}
+
+/**
+ * @brief Elevation map of the bundle columns within radius of center, given
+ *        in map coordinates, e.g. around the robot.
+ */
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
+        ElevationMap::Ptr &dst,
+        const cslibs_math_3d::Point3d &center,
+        const double &radius,
+        const std::size_t &min_samples = 3)
+{
+    if (!src)
+        return;
+
+    const double bundle_resolution_inv = 1.0 / src->getBundleResolution();
+    const ElevationMap::column_t min_column = {{static_cast<int>(std::floor((center(0) - radius) * bundle_resolution_inv)),
+                                                static_cast<int>(std::floor((center(1) - radius) * bundle_resolution_inv))}};
+    const ElevationMap::column_t max_column = {{static_cast<int>(std::floor((center(0) + radius) * bundle_resolution_inv)),
+                                                static_cast<int>(std::floor((center(1) + radius) * bundle_resolution_inv))}};
+    impl::from(*src, dst, min_column, max_column, min_samples);
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_ELEVATION_MAP_HPP
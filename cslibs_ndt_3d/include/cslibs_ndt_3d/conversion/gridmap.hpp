@@ -4,36 +4,55 @@
 #include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_3d/static_maps/gridmap.hpp>
 
+#include <cslibs_ndt_3d/conversion/storage.hpp>
+
 namespace cslibs_ndt_3d {
 namespace conversion {
+/**
+ * @brief The cell storages are copied as they are, one per job, and the
+ *        bundles are derived from them, so no neighbourhood is allocated.
+ */
 inline cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr from(
         const cslibs_ndt_3d::static_maps::Gridmap::Ptr& src)
 {
     if (!src)
         return nullptr;
 
-    using src_map_t = cslibs_ndt_3d::static_maps::Gridmap;
     using dst_map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
-    typename dst_map_t::Ptr dst(new dst_map_t(src->getOrigin(),
-                                              src->getResolution()));
-
     using index_t = std::array<int, 3>;
-    auto process_bundle = [&dst](const index_t &bi, const src_map_t::distribution_bundle_t &b){
-        if (const typename dst_map_t::distribution_bundle_t* b_dst = dst->getDistributionBundle(bi)) {
-            for (std::size_t i = 0 ; i < 8 ; ++ i) {
-                const auto &handle = b.at(i)->getHandle()->data();
-                if (handle.getN() > 0 && b_dst->at(i)->data().getN() == 0)
-                    b_dst->at(i)->data() = handle;
-            }
-        }
-    };
-    src->traverse(process_bundle);
-
-    return dst;
+
+    typename dst_map_t::distribution_storage_array_t storage;
+    for (std::size_t i = 0 ; i < 8 ; ++ i)
+        storage[i].reset(new typename dst_map_t::distribution_storage_t);
+    impl::copyStorages(src->getStorages(), storage, {{0, 0, 0}}, nullptr);
+
+    std::vector<index_t> indices;
+    src->getBundleIndices(indices);
+    index_t min_index = {{std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::max()}};
+    index_t max_index = {{std::numeric_limits<int>::min(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min()}};
+    for (const index_t &bi : indices) {
+        min_index = std::min(min_index, bi);
+        max_index = std::max(max_index, bi);
+    }
+
+    typename dst_map_t::distribution_bundle_storage_ptr_t bundles(new typename dst_map_t::distribution_bundle_storage_t);
+    impl::makeBundles(indices, storage, *bundles);
+
+    return typename dst_map_t::Ptr(new dst_map_t(src->getOrigin(),
+                                                 src->getResolution(),
+                                                 min_index,
+                                                 max_index,
+                                                 bundles,
+                                                 storage));
 }
 
+/**
+ * @brief The cell storages are copied shifted to the origin of the static map
+ *        and the bundles are derived from them, see above.
+ */
+template <template <typename, typename> class backend_t>
 inline cslibs_ndt_3d::static_maps::Gridmap::Ptr from(
-        const cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr& src)
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src)
 {
     if (!src)
         return nullptr;
@@ -54,31 +73,38 @@ inline cslibs_ndt_3d::static_maps::Gridmap::Ptr from(
       static_cast<std::size_t>(std::ceil((src->getMax()(1) - src->getMin()(1)) / src->getResolution())),
       static_cast<std::size_t>(std::ceil((src->getMax()(2) - src->getMin()(2)) / src->getResolution()))}};
 
-    auto get_bundle_index = [&size, &min_distribution_index] (const index_t & bi) {
-        return index_t{{bi[0] - min_distribution_index[0],
-                        bi[1] - min_distribution_index[1],
-                        bi[2] - min_distribution_index[2]}};
-    };
-
-    using src_map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
     using dst_map_t = cslibs_ndt_3d::static_maps::Gridmap;
-    typename dst_map_t::Ptr dst(new dst_map_t(src->getOrigin(),
-                                              src->getResolution(),
-                                              size));
-
-    auto process_bundle = [&dst, &get_bundle_index](const index_t &bi, const src_map_t::distribution_bundle_t &b){
-        const index_t bi_dst = get_bundle_index(bi);
-        if (const typename dst_map_t::distribution_bundle_t* b_dst = dst->getDistributionBundle(bi_dst)) {
-            for (std::size_t i = 0 ; i < 8 ; ++ i) {
-                const auto &handle = b.at(i)->getHandle()->data();
-                if (handle.getN() > 0 && b_dst->at(i)->data().getN() == 0)
-                    b_dst->at(i)->data() = handle;
-            }
-        }
-    };
-    src->traverse(process_bundle);
-
-    return dst;
+    typename dst_map_t::distribution_storage_array_t storage;
+    for (std::size_t i = 0 ; i < 8 ; ++ i) {
+        storage[i].reset(new typename dst_map_t::distribution_storage_t);
+        const std::size_t pad = i == 0 ? 0 : 1;
+        storage[i]->template set<cis::option::tags::array_size>(size[0] + pad, size[1] + pad, size[2] + pad);
+    }
+    impl::copyStorages(src->getStorages(), storage, min_distribution_index, &size);
+
+    std::vector<index_t> indices;
+    src->getBundleIndices(indices);
+    std::size_t n = 0;
+    for (const index_t &bi : indices) {
+        const index_t bi_dst = {{bi[0] - min_distribution_index[0],
+                                 bi[1] - min_distribution_index[1],
+                                 bi[2] - min_distribution_index[2]}};
+        if (bi_dst[0] < 2 * static_cast<int>(size[0]) &&
+                bi_dst[1] < 2 * static_cast<int>(size[1]) &&
+                bi_dst[2] < 2 * static_cast<int>(size[2]))
+            indices[n ++] = bi_dst;
+    }
+    indices.resize(n);
+
+    typename dst_map_t::distribution_bundle_storage_ptr_t bundles(new typename dst_map_t::distribution_bundle_storage_t);
+    bundles->template set<cis::option::tags::array_size>(size[0] * 2, size[1] * 2, size[2] * 2);
+    impl::makeBundles(indices, storage, *bundles);
+
+    return typename dst_map_t::Ptr(new dst_map_t(src->getOrigin(),
+                                                 src->getResolution(),
+                                                 size,
+                                                 bundles,
+                                                 storage));
 }
 }
 }
@@ -0,0 +1,251 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_PACKED_DISTRIBUTIONS_HPP
+#define CSLIBS_NDT_3D_CONVERSION_PACKED_DISTRIBUTIONS_HPP
+
+#include <cslibs_ndt_3d/conversion/distributions.hpp>
+
+#include <cslibs_ndt_3d/PackedDistributionArray.h>
+
+#include <Eigen/Geometry>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Covariance of distribution i of a packed array, either quantised or
+ *        not.
+ */
+inline Eigen::Matrix3d getCovariance(const cslibs_ndt_3d::PackedDistributionArray &src,
+                                     const std::size_t                            i)
+{
+    std::array<double, 6> c;
+    if (src.covariance_quantised.size() >= 6 * (i + 1) && src.covariance_scale.size() > i) {
+        for (std::size_t j = 0 ; j < 6 ; ++ j)
+            c[j] = src.covariance_quantised[6 * i + j] * static_cast<double>(src.covariance_scale[i]);
+    } else {
+        for (std::size_t j = 0 ; j < 6 ; ++ j)
+            c[j] = src.covariance[6 * i + j];
+    }
+    return (Eigen::Matrix3d() << c[0], c[1], c[2],
+                                 c[1], c[3], c[4],
+                                 c[2], c[4], c[5]).finished();
+}
+
+/**
+ * @brief Ellipsoid axes and orientation of a decomposed covariance. The axes
+ *        are clamped to min_axis, as quantisation may push the eigenvalues of
+ *        flat distributions to or below zero, and the eigenvectors are turned
+ *        into a proper rotation if they form a reflection.
+ */
+inline void getEllipsoid(const EigenDecomposition::values_t  &values,
+                         const EigenDecomposition::vectors_t &vectors,
+                         Eigen::Vector3d                     &axes,
+                         Eigen::Quaterniond                  &orientation,
+                         const double                         min_axis = 1e-6)
+{
+    for (std::size_t i = 0 ; i < 3 ; ++ i)
+        axes(i) = std::max(min_axis, values(i));
+
+    EigenDecomposition::vectors_t r = vectors;
+    if (r.determinant() < 0.0)
+        r.col(2) = -r.col(2);
+    orientation = Eigen::Quaterniond(r);
+}
+
+namespace impl {
+/**
+ * @brief One packed distribution per bundle for which merge returns true, the
+ *        ids of the others, and of missing bundles, are appended to removed
+ *        if removed is set. Ranges of bundles are packed in parallel into arrays of
+ *        their own, which are copied to their offsets once the exact size is
+ *        known.
+ * @param quantise store the covariances as 16 bit integers with one scale
+ *                 per distribution instead of single precision floats
+ */
+template <typename distribution_bundle_t, typename merge_fn_t>
+inline void from(const std::vector<std::pair<std::array<int, 3>, const distribution_bundle_t*>> &bundles,
+                 const merge_fn_t                                                            &merge,
+                 const bool                                                                   quantise,
+                 cslibs_ndt_3d::PackedDistributionArray                                      &dst,
+                 const bool                                                                   removed)
+{
+    using distribution_t = cslibs_math::statistics::Distribution<3, 3>;
+    using dst_t          = cslibs_ndt_3d::PackedDistributionArray;
+    struct block_t {
+        decltype(dst_t::id)                   id;
+        decltype(dst_t::prob)                 prob;
+        decltype(dst_t::mean)                 mean;
+        decltype(dst_t::covariance)           covariance;
+        decltype(dst_t::covariance_scale)     covariance_scale;
+        decltype(dst_t::covariance_quantised) covariance_quantised;
+        decltype(dst_t::removed)              removed;
+    };
+
+    cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+    cslibs_ndt::Executor::jobs_t jobs;
+    const auto ranges = executor.split(bundles.size(), 1024);
+    std::vector<block_t> blocks(ranges.size());
+    for (std::size_t k = 0 ; k < ranges.size() ; ++ k) {
+        jobs.emplace_back([&bundles, &blocks, &ranges, &merge, quantise, removed, k]() {
+            const std::size_t size = ranges[k].second - ranges[k].first;
+            block_t &block = blocks[k];
+            block.id.reserve(size);
+            block.prob.reserve(size);
+            block.mean.reserve(3 * size);
+            if (quantise) {
+                block.covariance_scale.reserve(size);
+                block.covariance_quantised.reserve(6 * size);
+            } else {
+                block.covariance.reserve(6 * size);
+            }
+
+            distribution_t d;
+            double         prob;
+            for (std::size_t j = ranges[k].first ; j < ranges[k].second ; ++ j) {
+                const std::uint64_t id = bundleId(bundles[j].first);
+                if (!bundles[j].second || !merge(*bundles[j].second, d, prob)) {
+                    if (removed)
+                        block.removed.emplace_back(id);
+                    continue;
+                }
+
+                const auto &mean       = d.getMean();
+                const auto  covariance = d.getCovariance();
+                const std::array<double, 6> c = {{covariance(0, 0), covariance(0, 1), covariance(0, 2),
+                                                  covariance(1, 1), covariance(1, 2), covariance(2, 2)}};
+                block.id.emplace_back(id);
+                block.prob.emplace_back(static_cast<float>(prob));
+                for (std::size_t i = 0 ; i < 3 ; ++ i)
+                    block.mean.emplace_back(static_cast<float>(mean(i)));
+
+                if (quantise) {
+                    double c_max = 0.0;
+                    for (std::size_t i = 0 ; i < 6 ; ++ i)
+                        c_max = std::max(c_max, std::fabs(c[i]));
+                    const double scale     = c_max / std::numeric_limits<std::int16_t>::max();
+                    const double scale_inv = scale > 0.0 ? 1.0 / scale : 0.0;
+                    block.covariance_scale.emplace_back(static_cast<float>(scale));
+                    for (std::size_t i = 0 ; i < 6 ; ++ i)
+                        block.covariance_quantised.emplace_back(static_cast<std::int16_t>(std::round(c[i] * scale_inv)));
+                } else {
+                    for (std::size_t i = 0 ; i < 6 ; ++ i)
+                        block.covariance.emplace_back(static_cast<float>(c[i]));
+                }
+            }
+            return true;
+        });
+    }
+    executor.run(jobs);
+    jobs.clear();
+
+    std::vector<std::size_t> offsets(blocks.size() + 1, 0);
+    for (std::size_t k = 0 ; k < blocks.size() ; ++ k)
+        offsets[k + 1] = offsets[k] + blocks[k].id.size();
+
+    const std::size_t n = offsets.back();
+    dst.id.resize(n);
+    dst.prob.resize(n);
+    dst.mean.resize(3 * n);
+    if (quantise) {
+        dst.covariance_scale.resize(n);
+        dst.covariance_quantised.resize(6 * n);
+    } else {
+        dst.covariance.resize(6 * n);
+    }
+    for (std::size_t k = 0 ; k < blocks.size() ; ++ k) {
+        jobs.emplace_back([&blocks, &offsets, &dst, k]() {
+            const block_t    &block = blocks[k];
+            const std::size_t o     = offsets[k];
+            std::copy(block.id.begin(),   block.id.end(),   dst.id.begin()   + o);
+            std::copy(block.prob.begin(), block.prob.end(), dst.prob.begin() + o);
+            std::copy(block.mean.begin(), block.mean.end(), dst.mean.begin() + 3 * o);
+            std::copy(block.covariance.begin(),           block.covariance.end(),           dst.covariance.begin()           + 6 * o);
+            std::copy(block.covariance_scale.begin(),     block.covariance_scale.end(),     dst.covariance_scale.begin()     + o);
+            std::copy(block.covariance_quantised.begin(), block.covariance_quantised.end(), dst.covariance_quantised.begin() + 6 * o);
+            return true;
+        });
+    }
+    executor.run(jobs);
+
+    for (const block_t &block : blocks)
+        dst.removed.insert(dst.removed.end(), block.removed.begin(), block.removed.end());
+}
+}
+
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
+        cslibs_ndt_3d::PackedDistributionArray::Ptr &dst,
+        const bool &quantise = false)
+{
+    if (!src)
+        return;
+
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::distribution_bundle_t;
+    auto merge = [](const distribution_bundle_t &b, cslibs_math::statistics::Distribution<3, 3> &d, double &prob) {
+        return impl::merge(b, d, prob);
+    };
+    dst.reset(new cslibs_ndt_3d::PackedDistributionArray());
+    impl::from(impl::bundles(*src), merge, quantise, *dst, false);
+}
+
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
+        cslibs_ndt_3d::PackedDistributionArray::Ptr &dst,
+        const cslibs_gridmaps::utility::InverseModel::Ptr &ivm,
+        const bool &quantise = false)
+{
+    if (!src)
+        return;
+
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>::distribution_bundle_t;
+    auto merge = [&ivm](const distribution_bundle_t &b, cslibs_math::statistics::Distribution<3, 3> &d, double &prob) {
+        return impl::merge(b, ivm, d, prob);
+    };
+    dst.reset(new cslibs_ndt_3d::PackedDistributionArray());
+    impl::from(impl::bundles(*src), merge, quantise, *dst, false);
+}
+
+/**
+ * @brief Incremental update holding the packed distributions of the given
+ *        bundles, bundles which hold none are listed as removed.
+ */
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
+        const std::vector<std::array<int, 3>> &indices,
+        cslibs_ndt_3d::PackedDistributionArray::Ptr &dst,
+        const bool &quantise = false)
+{
+    if (!src)
+        return;
+
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::distribution_bundle_t;
+    auto merge = [](const distribution_bundle_t &b, cslibs_math::statistics::Distribution<3, 3> &d, double &prob) {
+        return impl::merge(b, d, prob);
+    };
+    dst.reset(new cslibs_ndt_3d::PackedDistributionArray());
+    impl::from(impl::bundles(*src, indices), merge, quantise, *dst, true);
+}
+
+template <template <typename, typename> class backend_t>
+inline void from(
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
+        const std::vector<std::array<int, 3>> &indices,
+        cslibs_ndt_3d::PackedDistributionArray::Ptr &dst,
+        const cslibs_gridmaps::utility::InverseModel::Ptr &ivm,
+        const bool &quantise = false)
+{
+    if (!src)
+        return;
+
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>::distribution_bundle_t;
+    auto merge = [&ivm](const distribution_bundle_t &b, cslibs_math::statistics::Distribution<3, 3> &d, double &prob) {
+        return impl::merge(b, ivm, d, prob);
+    };
+    dst.reset(new cslibs_ndt_3d::PackedDistributionArray());
+    impl::from(impl::bundles(*src, indices), merge, quantise, *dst, true);
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_PACKED_DISTRIBUTIONS_HPP
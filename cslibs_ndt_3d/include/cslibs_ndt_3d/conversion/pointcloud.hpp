@@ -4,44 +4,111 @@
 #include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
 
+#include <cslibs_ndt/common/executor.hpp>
+
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
 
+#include <Eigen/StdVector>
+
 namespace cslibs_ndt_3d {
 namespace conversion {
+namespace impl {
+/**
+ * @brief One point per bundle for which point returns true. Ranges of bundles
+ *        are evaluated in parallel into blocks of their own, which are copied
+ *        to their offsets once the exact size of the cloud is known.
+ */
+template <typename src_map_t, typename point_fn_t>
+inline void from(const src_map_t                      &src,
+                 pcl::PointCloud<pcl::PointXYZI>::Ptr &dst,
+                 const point_fn_t                     &point)
+{
+    using index_t               = std::array<int, 3>;
+    using distribution_bundle_t = typename src_map_t::distribution_bundle_t;
+    using block_t               = std::vector<pcl::PointXYZI, Eigen::aligned_allocator<pcl::PointXYZI>>;
+
+    std::vector<const distribution_bundle_t*> bundles;
+    src.traverse([&bundles](const index_t &, const distribution_bundle_t &b) {
+        bundles.emplace_back(&b);
+    });
+
+    cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+    cslibs_ndt::Executor::jobs_t jobs;
+    const auto ranges = executor.split(bundles.size(), 1024);
+    std::vector<block_t> blocks(ranges.size());
+    for (std::size_t k = 0 ; k < ranges.size() ; ++ k) {
+        jobs.emplace_back([&bundles, &blocks, &ranges, &point, k]() {
+            block_t &block = blocks[k];
+            block.reserve(ranges[k].second - ranges[k].first);
+            pcl::PointXYZI p;
+            for (std::size_t j = ranges[k].first ; j < ranges[k].second ; ++ j)
+                if (point(*bundles[j], p))
+                    block.emplace_back(p);
+            return true;
+        });
+    }
+    executor.run(jobs);
+    jobs.clear();
+
+    std::vector<std::size_t> offsets(blocks.size() + 1, 0);
+    for (std::size_t k = 0 ; k < blocks.size() ; ++ k)
+        offsets[k + 1] = offsets[k] + blocks[k].size();
+
+    dst.reset(new pcl::PointCloud<pcl::PointXYZI>());
+    dst->points.resize(offsets.back());
+    dst->width    = static_cast<std::uint32_t>(offsets.back());
+    dst->height   = 1;
+    dst->is_dense = true;
+    for (std::size_t k = 0 ; k < blocks.size() ; ++ k) {
+        jobs.emplace_back([&blocks, &offsets, &dst, k]() {
+            std::copy(blocks[k].begin(), blocks[k].end(), dst->points.begin() + offsets[k]);
+            return true;
+        });
+    }
+    executor.run(jobs);
+}
+}
+
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &src,
         pcl::PointCloud<pcl::PointXYZI>::Ptr &dst)
 {
     if (!src)
         return;
 
-    using dst_map_t = pcl::PointCloud<pcl::PointXYZI>;
-    dst.reset(new dst_map_t());
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::distribution_bundle_t;
+    using distribution_t        = cslibs_math::statistics::Distribution<3, 3>;
+    auto point = [](const distribution_bundle_t &b, pcl::PointXYZI &p) {
+        /// cells are copied while their handle holds the lock, the map may be written concurrently
+        std::array<distribution_t, 8> cells;
+        distribution_t d;
+        for (std::size_t i = 0 ; i < 8 ; ++i) {
+            cells[i] = b.at(i)->getHandle()->data();
+            d += cells[i];
+        }
+        if (d.getN() == 0)
+            return false;
 
-    using index_t = std::array<int, 3>;
-    using distribution_bundle_t = cslibs_ndt_3d::dynamic_maps::Gridmap::distribution_bundle_t;
-    auto process_bundle = [&src, &dst](const index_t &bi, const distribution_bundle_t &b) {
-        cslibs_math::statistics::Distribution<3, 3> d;
+        /// the intensity is sampled from the bundle at hand
+        const cslibs_math_3d::Point3d mean(d.getMean());
+        double intensity = 0.0;
         for (std::size_t i = 0 ; i < 8 ; ++i)
-            d += b.at(i)->getHandle()->data();
-        if (d.getN() == 0)
-            return;
+            intensity += cells[i].sampleNonNormalized(mean);
 
-        cslibs_math_3d::Point3d mean(d.getMean());
-        pcl::PointXYZI p;
         p.x = static_cast<float>(mean(0));
         p.y = static_cast<float>(mean(1));
         p.z = static_cast<float>(mean(2));
-        p.intensity = static_cast<float>(src->sampleNonNormalized(mean));
-
-        dst->push_back(p);
+        p.intensity = static_cast<float>(0.125 * intensity);
+        return true;
     };
-    src->traverse(process_bundle);
+    impl::from(*src, dst, point);
 }
 
+template <template <typename, typename> class backend_t>
 inline void from(
-        const cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::Ptr &src,
+        const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>> &src,
         pcl::PointCloud<pcl::PointXYZI>::Ptr &dst,
         const cslibs_gridmaps::utility::InverseModel::Ptr &ivm,
         const double &threshold = 0.169)
@@ -49,34 +116,39 @@ inline void from(
     if (!src)
         return;
 
-    using dst_map_t = pcl::PointCloud<pcl::PointXYZI>;
-    dst.reset(new dst_map_t());
-
-    using index_t = std::array<int, 3>;
-    using distribution_bundle_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::distribution_bundle_t;
-    auto process_bundle = [&src, &dst, &ivm, &threshold](const index_t &bi, const distribution_bundle_t &b) {
-        cslibs_math::statistics::Distribution<3, 3> d;
+    using distribution_bundle_t = typename cslibs_ndt_3d::dynamic_maps::BasicOccupancyGridmap<backend_t>::distribution_bundle_t;
+    using distribution_t        = cslibs_math::statistics::Distribution<3, 3>;
+    auto point = [&ivm, &threshold](const distribution_bundle_t &b, pcl::PointXYZI &p) {
+        /// statistics and occupancy of a cell are copied under one lock, the map may be written concurrently
+        std::array<distribution_t, 8> cells;
+        std::array<double, 8>         occupancies;
+        distribution_t d;
         double occupancy = 0.0;
-
         for (std::size_t i = 0 ; i < 8 ; ++i) {
             const auto &handle = b.at(i)->getHandle();
-            occupancy += 0.125 * handle->getOccupancy(ivm);
-            if (const auto &d_tmp = handle->getDistribution())
-                d += *d_tmp;
+            occupancies[i] = handle->getOccupancy(ivm);
+            occupancy += 0.125 * occupancies[i];
+            if (const auto &cell = handle->getDistribution()) {
+                cells[i] = *cell;
+                d += cells[i];
+            }
         }
         if (d.getN() == 0 || occupancy < threshold)
-            return;
+            return false;
+
+        /// the intensity is sampled from the bundle at hand
+        const cslibs_math_3d::Point3d mean(d.getMean());
+        double intensity = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++i)
+            intensity += cells[i].sampleNonNormalized(mean) * occupancies[i];
 
-        cslibs_math_3d::Point3d mean(d.getMean());
-        pcl::PointXYZI p;
         p.x = static_cast<float>(mean(0));
         p.y = static_cast<float>(mean(1));
         p.z = static_cast<float>(mean(2));
-        p.intensity = static_cast<float>(src->sampleNonNormalized(mean, ivm));
-
-        dst->push_back(p);
+        p.intensity = static_cast<float>(0.125 * intensity);
+        return true;
     };
-    src->traverse(process_bundle);
+    impl::from(*src, dst, point);
 }
 }
 }
@@ -0,0 +1,203 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_PROJECTION_HPP
+#define CSLIBS_NDT_3D_CONVERSION_PROJECTION_HPP
+
+#include <array>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include <cslibs_math/statistics/distribution.hpp>
+#include <cslibs_math_2d/linear/pose.hpp>
+#include <cslibs_math_3d/linear/transform.hpp>
+
+#include <cslibs_ndt/common/executor.hpp>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Projection of the cells of a 3D map onto the plane, restricted to the
+ *        height band [z_min, z_max]. Every cell is marginalised over z, its
+ *        weight is scaled by its mass inside the band, and the projection of a
+ *        bundle column is the maximum over its bundles. Columns write disjoint
+ *        pixels and are projected in parallel.
+ */
+class Projection
+{
+public:
+    using column_t  = std::array<int, 2>;
+    using columns_t = std::vector<column_t>;
+
+    inline Projection(const double sampling_resolution,
+                      const double z_min,
+                      const double z_max) :
+        sampling_resolution_(sampling_resolution),
+        z_min_(std::min(z_min, z_max)),
+        z_max_(std::max(z_min, z_max))
+    {
+    }
+
+    /**
+     * @brief Planar origin and size in pixels of the projection of src, false
+     *        if the map is empty or coarser than the bundles.
+     */
+    template <typename src_map_t>
+    inline bool extent(const src_map_t          &src,
+                       cslibs_math_2d::Pose2d   &origin,
+                       std::size_t              &width,
+                       std::size_t              &height) const
+    {
+        const std::array<int, 3> min_bi = src.getMinDistributionIndex();
+        const std::array<int, 3> max_bi = src.getMaxDistributionIndex();
+        for (std::size_t i = 0 ; i < 2 ; ++ i)
+            if (min_bi[i] == std::numeric_limits<int>::max() ||
+                    max_bi[i] == std::numeric_limits<int>::min())
+                return false;
+
+        const int chunk_step = static_cast<int>(src.getBundleResolution() / sampling_resolution_);
+        if (chunk_step < 1)
+            return false;
+
+        const cslibs_math_3d::Transform3d o = src.getOrigin();
+        origin = cslibs_math_2d::Pose2d(o.tx(), o.ty(), o.yaw());
+        width  = static_cast<std::size_t>(max_bi[0] - min_bi[0] + 1) * chunk_step;
+        height = static_cast<std::size_t>(max_bi[1] - min_bi[1] + 1) * chunk_step;
+        return true;
+    }
+
+    /**
+     * @brief Project the columns of src into the pixel grid of extent(src).
+     * @param weight  maps a cell to its statistics and weight, e.g. occupancy
+     * @param columns bundle columns to project, all if empty
+     * @param write   receives pixel coordinates and the projected value
+     */
+    template <typename src_map_t, typename weight_fn_t, typename write_fn_t>
+    inline void apply(const src_map_t   &src,
+                      const weight_fn_t &weight,
+                      const columns_t   &columns,
+                      const write_fn_t  &write) const
+    {
+        using index_t               = std::array<int, 3>;
+        using distribution_bundle_t = typename src_map_t::distribution_bundle_t;
+        using entry_t               = std::pair<column_t, const distribution_bundle_t*>;
+
+        const index_t min_bi            = src.getMinDistributionIndex();
+        const double  bundle_resolution = src.getBundleResolution();
+        const int     chunk_step        = static_cast<int>(bundle_resolution / sampling_resolution_);
+        if (chunk_step < 1)
+            return;
+
+        /// cells reach one bundle beyond their own, so neighbouring layers count
+        const int bz_min = static_cast<int>(std::floor(z_min_ / bundle_resolution)) - 1;
+        const int bz_max = static_cast<int>(std::floor(z_max_ / bundle_resolution)) + 1;
+
+        columns_t selected(columns);
+        std::sort(selected.begin(), selected.end());
+
+        std::vector<entry_t> entries;
+        src.traverse([&entries, &selected, bz_min, bz_max](const index_t &bi, const distribution_bundle_t &b) {
+            const column_t c = {{bi[0], bi[1]}};
+            if (bi[2] < bz_min || bi[2] > bz_max ||
+                    (!selected.empty() && !std::binary_search(selected.begin(), selected.end(), c)))
+                return;
+            entries.emplace_back(c, &b);
+        });
+        std::sort(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b) {
+            return a.first < b.first;
+        });
+
+        std::vector<std::size_t> groups;
+        for (std::size_t i = 0 ; i < entries.size() ; ++ i)
+            if (i == 0 || entries[i].first != entries[i - 1].first)
+                groups.emplace_back(i);
+        groups.emplace_back(entries.size());
+
+        cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+        cslibs_ndt::Executor::jobs_t jobs;
+        for (const auto &r : executor.split(groups.size() - 1, 16)) {
+            jobs.emplace_back([this, &entries, &groups, &weight, &write, &min_bi, bundle_resolution, chunk_step, r]() {
+                std::vector<double> patch(chunk_step * chunk_step);
+                std::vector<cell_t> cells;
+                for (std::size_t g = r.first ; g < r.second ; ++ g) {
+                    const column_t &c = entries[groups[g]].first;
+                    std::fill(patch.begin(), patch.end(), 0.0);
+                    for (std::size_t e = groups[g] ; e < groups[g + 1] ; ++ e) {
+                        cells.clear();
+                        for (std::size_t i = 0 ; i < 8 ; ++ i)
+                            marginalise(weight(entries[e].second->at(i)), cells);
+                        if (cells.empty())
+                            continue;
+
+                        for (int l = 0 ; l < chunk_step ; ++ l) {
+                            for (int k = 0 ; k < chunk_step ; ++ k) {
+                                const double x = c[0] * bundle_resolution + k * sampling_resolution_;
+                                const double y = c[1] * bundle_resolution + l * sampling_resolution_;
+                                double s = 0.0;
+                                for (const cell_t &cell : cells) {
+                                    const double dx = x - cell.mean[0];
+                                    const double dy = y - cell.mean[1];
+                                    s += cell.scale * std::exp(-0.5 * (cell.information[0] * dx * dx +
+                                                                       2.0 * cell.information[1] * dx * dy +
+                                                                       cell.information[2] * dy * dy));
+                                }
+                                double &p = patch[l * chunk_step + k];
+                                p = std::max(p, 0.125 * s);
+                            }
+                        }
+                    }
+
+                    for (int l = 0 ; l < chunk_step ; ++ l)
+                        for (int k = 0 ; k < chunk_step ; ++ k)
+                            write(static_cast<std::size_t>((c[0] - min_bi[0]) * chunk_step + k),
+                                  static_cast<std::size_t>((c[1] - min_bi[1]) * chunk_step + l),
+                                  patch[l * chunk_step + k]);
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+    }
+
+private:
+    const double sampling_resolution_;
+    const double z_min_;
+    const double z_max_;
+
+    /// planar marginal of a cell, information stored as xx, xy, yy
+    struct cell_t {
+        std::array<double, 2> mean;
+        std::array<double, 3> information;
+        double                scale;
+    };
+
+    inline void marginalise(const std::pair<const cslibs_math::statistics::Distribution<3, 3>*, double> &w,
+                            std::vector<cell_t>                                                         &cells) const
+    {
+        const cslibs_math::statistics::Distribution<3, 3> *d = w.first;
+        if (!d || d->getN() < 3 || w.second <= 0.0)
+            return;
+
+        const auto mean       = d->getMean();
+        const auto covariance = d->getCovariance();
+        const double det = covariance(0, 0) * covariance(1, 1) - covariance(0, 1) * covariance(1, 0);
+        const double sz  = std::sqrt(covariance(2, 2));
+        if (!(det > 0.0) || !(sz > 0.0))
+            return;
+
+        /// mass of the height marginal inside the band
+        const double band = 0.5 * (std::erf((z_max_ - mean(2)) / (sz * M_SQRT2)) -
+                                   std::erf((z_min_ - mean(2)) / (sz * M_SQRT2)));
+        if (band <= 1e-6)
+            return;
+
+        cell_t c;
+        c.mean           = {{mean(0), mean(1)}};
+        c.information    = {{covariance(1, 1) / det, -covariance(0, 1) / det, covariance(0, 0) / det}};
+        c.scale          = w.second * band;
+        cells.emplace_back(c);
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_PROJECTION_HPP
@@ -0,0 +1,122 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_STORAGE_HPP
+#define CSLIBS_NDT_3D_CONVERSION_STORAGE_HPP
+
+#include <array>
+#include <vector>
+#include <memory>
+
+#include <cslibs_math/common/div.hpp>
+#include <cslibs_math/common/mod.hpp>
+
+#include <cslibs_ndt/common/executor.hpp>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+namespace impl {
+/**
+ * @brief Copy the 8 cell storages of a map into those of a map whose bundle
+ *        indices are shifted by -offset, one storage per job. Storage s holds
+ *        the cells shifted by half a cell along the axes of the set bits of s,
+ *        so odd offsets swap the storages of an axis.
+ * @param size bundle grid size of a static destination, nullptr if the
+ *             destination is unbounded
+ */
+template <typename src_storage_array_t, typename dst_storage_array_t>
+inline void copyStorages(const src_storage_array_t &src,
+                         const dst_storage_array_t &dst,
+                         const std::array<int, 3>  &offset,
+                         const std::array<std::size_t, 3> *size)
+{
+    using index_t       = std::array<int, 3>;
+    using src_storage_t = typename src_storage_array_t::value_type::element_type;
+    using dst_storage_t = typename dst_storage_array_t::value_type::element_type;
+    using data_t        = typename dst_storage_t::data_type;
+
+    cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (std::size_t s_dst = 0 ; s_dst < 8 ; ++ s_dst) {
+        jobs.emplace_back([&src, &dst, &offset, size, s_dst]() {
+            std::size_t s_src = s_dst;
+            index_t     shift;
+            for (std::size_t i = 0 ; i < 3 ; ++ i) {
+                const int b_dst = static_cast<int>((s_dst >> i) & 1ul);
+                const int b_src = cslibs_math::common::mod<int>(b_dst + offset[i], 2);
+                s_src    ^= static_cast<std::size_t>(b_src != b_dst) << i;
+                shift[i]  = (b_src + offset[i] - b_dst) / 2;
+            }
+
+            dst_storage_t &d = *dst[s_dst];
+            src[s_src]->traverse([&d, &shift, size, s_dst](const index_t &c, const typename src_storage_t::data_type &data) {
+                const index_t c_dst = {{c[0] - shift[0], c[1] - shift[1], c[2] - shift[2]}};
+                if (size) {
+                    for (std::size_t i = 0 ; i < 3 ; ++ i)
+                        if (c_dst[i] < 0 || c_dst[i] >= static_cast<int>((*size)[i] + ((s_dst >> i) & 1ul)))
+                            return;
+                }
+                d.insert(c_dst, static_cast<const data_t&>(data));
+            });
+            return true;
+        });
+    }
+    executor.run(jobs);
+}
+
+/**
+ * @brief Bundles of the given indices pointing into the cell storages, the
+ *        cell lookups run in parallel, the bundles are inserted in order.
+ */
+template <typename bundle_storage_t, typename storage_array_t>
+inline void makeBundles(const std::vector<std::array<int, 3>> &indices,
+                        const storage_array_t                 &storage,
+                        bundle_storage_t                      &bundles)
+{
+    using index_t   = std::array<int, 3>;
+    using bundle_t  = typename bundle_storage_t::data_type;
+    using storage_t = typename storage_array_t::value_type::element_type;
+    using data_t    = typename storage_t::data_type;
+
+    std::vector<bundle_t> values(indices.size());
+    cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (const auto &r : executor.split(indices.size(), 4096)) {
+        jobs.emplace_back([&indices, &storage, &values, r]() {
+            for (std::size_t j = r.first ; j < r.second ; ++ j) {
+                const index_t &bi = indices[j];
+                const index_t div = {{cslibs_math::common::div<int>(bi[0], 2),
+                                      cslibs_math::common::div<int>(bi[1], 2),
+                                      cslibs_math::common::div<int>(bi[2], 2)}};
+                const index_t mod = {{cslibs_math::common::mod<int>(bi[0], 2),
+                                      cslibs_math::common::mod<int>(bi[1], 2),
+                                      cslibs_math::common::mod<int>(bi[2], 2)}};
+                for (std::size_t s = 0 ; s < 8 ; ++ s) {
+                    const index_t c = {{div[0] + ((s & 1ul) ? mod[0] : 0),
+                                        div[1] + ((s & 2ul) ? mod[1] : 0),
+                                        div[2] + ((s & 4ul) ? mod[2] : 0)}};
+                    values[j][s] = storage[s]->get(c);
+                }
+            }
+            return true;
+        });
+    }
+    executor.run(jobs);
+
+    /// cells the source did not have are allocated empty
+    for (std::size_t j = 0 ; j < indices.size() ; ++ j) {
+        const index_t &bi = indices[j];
+        bundle_t &b = values[j];
+        for (std::size_t s = 0 ; s < 8 ; ++ s) {
+            if (b[s])
+                continue;
+            const index_t c = {{cslibs_math::common::div<int>(bi[0], 2) + ((s & 1ul) ? cslibs_math::common::mod<int>(bi[0], 2) : 0),
+                                cslibs_math::common::div<int>(bi[1], 2) + ((s & 2ul) ? cslibs_math::common::mod<int>(bi[1], 2) : 0),
+                                cslibs_math::common::div<int>(bi[2], 2) + ((s & 4ul) ? cslibs_math::common::mod<int>(bi[2], 2) : 0)}};
+            b[s] = &storage[s]->insert(c, data_t());
+        }
+        bundles.insert(bi, b);
+    }
+}
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_STORAGE_HPP
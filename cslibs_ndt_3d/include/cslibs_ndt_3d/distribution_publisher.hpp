@@ -0,0 +1,144 @@
+#ifndef CSLIBS_NDT_3D_DISTRIBUTION_PUBLISHER_HPP
+#define CSLIBS_NDT_3D_DISTRIBUTION_PUBLISHER_HPP
+
+#include <cslibs_ndt_3d/conversion/distributions.hpp>
+#include <cslibs_ndt_3d/conversion/packed_distributions.hpp>
+
+#include <ros/ros.h>
+
+namespace cslibs_ndt_3d {
+/**
+ * @brief Publishes the distributions of a dynamic map, either as a whole or
+ *        as updates holding the bundles changed since the previous call.
+ *        Updates only refer to what was sent before, a subscriber which
+ *        joins late or drops a message has to be sent the whole map again,
+ *        e.g. by the resend service of the map loader, which calls publish().
+ */
+template <typename map_t>
+class DistributionPublisher
+{
+public:
+    using Ptr             = std::shared_ptr<DistributionPublisher>;
+    using map_ptr_t       = typename map_t::Ptr;
+    using index_t         = std::array<int, 3>;
+    using inverse_model_t = cslibs_gridmaps::utility::InverseModel;
+
+    /**
+     * @param packed     publish PackedDistributionArray instead of DistributionArray
+     * @param quantise   quantise the covariances of packed distributions
+     * @param ivm        inverse model, required by occupancy maps only
+     * @param queue_size updates are not self-contained, so they are queued
+     *                   rather than dropped for the latest
+     */
+    inline DistributionPublisher(ros::NodeHandle                  &nh,
+                                 const std::string                &topic,
+                                 const map_ptr_t                  &map,
+                                 const bool                        packed,
+                                 const bool                        quantise,
+                                 const inverse_model_t::Ptr       &ivm        = nullptr,
+                                 const std::string                &frame_id   = "/map",
+                                 const int                         queue_size = 16) :
+        map_(map),
+        ivm_(ivm),
+        packed_(packed),
+        quantise_(quantise),
+        frame_id_(frame_id)
+    {
+        if (packed_)
+            pub_ = nh.advertise<cslibs_ndt_3d::PackedDistributionArray>(topic, queue_size);
+        else
+            pub_ = nh.advertise<cslibs_ndt_3d::DistributionArray>(topic, queue_size);
+    }
+
+    /**
+     * @brief Publish the whole map, changes up to now are part of it and not
+     *        published by the next update.
+     */
+    inline void publish()
+    {
+        std::vector<index_t> indices;
+        map_->takeChangedBundleIndices(indices);
+        send(nullptr);
+    }
+
+    /**
+     * @brief Publish the bundles changed since the previous call, the first
+     *        call without publish() before publishes the whole map.
+     * @return false if nothing changed
+     */
+    inline bool publishUpdates()
+    {
+        std::vector<index_t> indices;
+        map_->takeChangedBundleIndices(indices);
+        if (indices.empty())
+            return false;
+        send(&indices);
+        return true;
+    }
+
+private:
+    const map_ptr_t            map_;
+    const inverse_model_t::Ptr ivm_;
+    const bool                 packed_;
+    const bool                 quantise_;
+    const std::string          frame_id_;
+    ros::Publisher             pub_;
+
+    inline void send(const std::vector<index_t> *indices) const
+    {
+        if (packed_) {
+            cslibs_ndt_3d::PackedDistributionArray::Ptr msg;
+            convert(map_, indices, msg);
+            publishMessage(msg);
+        } else {
+            cslibs_ndt_3d::DistributionArray::Ptr msg;
+            convert(map_, indices, msg);
+            publishMessage(msg);
+        }
+    }
+
+    template <typename msg_ptr_t>
+    inline void publishMessage(msg_ptr_t &msg) const
+    {
+        if (!msg)
+            return;
+        msg->header.frame_id = frame_id_;
+        msg->header.stamp    = ros::Time::now();
+        pub_.publish(msg);
+    }
+
+    template <template <typename, typename> class backend_t>
+    inline void convert(const std::shared_ptr<dynamic_maps::BasicGridmap<backend_t>> &map,
+                        const std::vector<index_t>                                   *indices,
+                        cslibs_ndt_3d::DistributionArray::Ptr                        &msg) const
+    {
+        indices ? conversion::from(map, *indices, msg) : conversion::from(map, msg);
+    }
+
+    template <template <typename, typename> class backend_t>
+    inline void convert(const std::shared_ptr<dynamic_maps::BasicGridmap<backend_t>> &map,
+                        const std::vector<index_t>                                   *indices,
+                        cslibs_ndt_3d::PackedDistributionArray::Ptr                  &msg) const
+    {
+        indices ? conversion::from(map, *indices, msg, quantise_) : conversion::from(map, msg, quantise_);
+    }
+
+    template <template <typename, typename> class backend_t>
+    inline void convert(const std::shared_ptr<dynamic_maps::BasicOccupancyGridmap<backend_t>> &map,
+                        const std::vector<index_t>                                            *indices,
+                        cslibs_ndt_3d::DistributionArray::Ptr                                 &msg) const
+    {
+        indices ? conversion::from(map, *indices, msg, ivm_) : conversion::from(map, msg, ivm_);
+    }
+
+    template <template <typename, typename> class backend_t>
+    inline void convert(const std::shared_ptr<dynamic_maps::BasicOccupancyGridmap<backend_t>> &map,
+                        const std::vector<index_t>                                            *indices,
+                        cslibs_ndt_3d::PackedDistributionArray::Ptr                           &msg) const
+    {
+        indices ? conversion::from(map, *indices, msg, ivm_, quantise_) : conversion::from(map, msg, ivm_, quantise_);
+    }
+};
+}
+
+#endif // CSLIBS_NDT_3D_DISTRIBUTION_PUBLISHER_HPP
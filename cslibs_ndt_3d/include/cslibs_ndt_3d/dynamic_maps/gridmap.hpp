@@ -5,12 +5,18 @@
 #include <vector>
 #include <cmath>
 #include <memory>
+#include <tuple>
 
 #include <cslibs_math_3d/linear/pose.hpp>
 #include <cslibs_math_3d/linear/point.hpp>
 
 #include <cslibs_ndt/common/distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/point_indexer.hpp>
+#include <cslibs_ndt/common/backend.hpp>
+#include <cslibs_ndt/common/merge_transform.hpp>
+#include <cslibs_ndt/common/executor.hpp>
+#include <cslibs_ndt/common/change_tracker.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -25,10 +31,11 @@ namespace cis = cslibs_indexed_storage;
 
 namespace cslibs_ndt_3d {
 namespace dynamic_maps {
-class Gridmap
+template <template <typename, typename> class backend_t = cslibs_ndt::backend::KDTree>
+class BasicGridmap
 {
 public:
-    using Ptr                               = std::shared_ptr<Gridmap>;
+    using Ptr                               = std::shared_ptr<BasicGridmap>;
     using pose_t                            = cslibs_math_3d::Pose3d;
     using transform_t                       = cslibs_math_3d::Transform3d;
     using point_t                           = cslibs_math_3d::Point3d;
@@ -36,16 +43,17 @@ public:
     using mutex_t                           = std::mutex;
     using lock_t                            = std::unique_lock<mutex_t>;
     using distribution_t                    = cslibs_ndt::Distribution<3>;
-    using distribution_storage_t            = cis::Storage<distribution_t, index_t, cis::backend::kdtree::KDTree>;
+    using distribution_storage_t            = backend_t<distribution_t, index_t>;
     using distribution_storage_ptr_t        = std::shared_ptr<distribution_storage_t>;
     using distribution_storage_array_t      = std::array<distribution_storage_ptr_t, 8>;
     using distribution_bundle_t             = cslibs_ndt::Bundle<distribution_t*, 8>;
     using distribution_const_bundle_t       = cslibs_ndt::Bundle<const distribution_t*, 8>;
-    using distribution_bundle_storage_t     = cis::Storage<distribution_bundle_t, index_t, cis::backend::kdtree::KDTree>;
+    using distribution_bundle_storage_t     = backend_t<distribution_bundle_t, index_t>;
     using distribution_bundle_storage_ptr_t = std::shared_ptr<distribution_bundle_storage_t>;
+    using merge_transform_t                 = cslibs_ndt::MergeTransform<3>;
 
-    Gridmap(const pose_t        &origin,
-            const double         resolution) :
+    BasicGridmap(const pose_t        &origin,
+                 const double         resolution) :
         resolution_(resolution),
         resolution_inv_(1.0 / resolution_),
         bundle_resolution_(0.5 * resolution_),
@@ -66,12 +74,12 @@ public:
     {
     }
 
-    Gridmap(const pose_t &origin,
-            const double &resolution,
-            const index_t &min_index,
-            const index_t &max_index,
-            const std::shared_ptr<distribution_bundle_storage_t> &bundles,
-            const distribution_storage_array_t                   &storage) :
+    BasicGridmap(const pose_t &origin,
+                 const double &resolution,
+                 const index_t &min_index,
+                 const index_t &max_index,
+                 const std::shared_ptr<distribution_bundle_storage_t> &bundles,
+                 const distribution_storage_array_t                   &storage) :
         resolution_(resolution),
         resolution_inv_(1.0 / resolution_),
         bundle_resolution_(0.5 * resolution_),
@@ -115,10 +123,10 @@ public:
 
     inline void add(const point_t &p)
     {
+        const index_t bi = toBundleIndex(p);
         distribution_bundle_t *bundle;
         {
             lock_t(bundle_storage_mutex_);
-            const index_t bi = toBundleIndex(p);
             bundle = getAllocate(bi);
         }
 
@@ -130,6 +138,7 @@ public:
         bundle->at(5)->getHandle()->data().add(p);
         bundle->at(6)->getHandle()->data().add(p);
         bundle->at(7)->getHandle()->data().add(p);
+        changes_.mark(bi);
     }
 
     inline void add(const point_t &p,
@@ -150,20 +159,18 @@ public:
         bundle->at(5)->getHandle()->data().add(p);
         bundle->at(6)->getHandle()->data().add(p);
         bundle->at(7)->getHandle()->data().add(p);
+        changes_.mark(bi);
     }
 
     inline void insert(const pose_t &origin,
                        const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points)
     {
         distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = origin * p;
-            if (pm.isNormal()) {
-                const index_t &bi = toBundleIndex(pm);
-                distribution_t *d = storage.get(bi);
-                (d ? d : &storage.insert(bi, distribution_t()))->data().add(pm);
-            }
-        }
+        const cslibs_ndt::PointIndexer<3, pose_t, transform_t> indexer(origin, m_T_w_, bundle_resolution_inv_);
+        indexer.apply(*points, [&storage](const point_t &pm, const index_t &bi) {
+            distribution_t *d = storage.get(bi);
+            (d ? d : &storage.insert(bi, distribution_t()))->data().add(pm);
+        });
 
         storage.traverse([this](const index_t& bi, const distribution_t &d) {
             distribution_bundle_t *bundle;
@@ -179,9 +186,78 @@ public:
             bundle->at(5)->getHandle()->data() += d.data();
             bundle->at(6)->getHandle()->data() += d.data();
             bundle->at(7)->getHandle()->data() += d.data();
+            changes_.mark(bi);
         });
     }
 
+    /**
+     * @brief Fuse the cells of another map of equal resolution into this one,
+     *        e.g. to combine maps of several robots or mapping sessions.
+     *        Maps whose grids are shifted against each other by whole bundles
+     *        are fused exactly, otherwise cells are inserted at their centers.
+     * @param other map to merge, must not be written while merging
+     * @param w_T_o transformation from the world frame of other into the
+     *              world frame of this map
+     */
+    inline void merge(const BasicGridmap &other,
+                      const transform_t &w_T_o = transform_t())
+    {
+        if (&other == this)
+            throw std::runtime_error("[Gridmap]: cannot merge a map into itself");
+        if (std::abs(other.resolution_ - resolution_) > 1e-9)
+            throw std::runtime_error("[Gridmap]: cannot merge maps of different resolution");
+
+        const merge_transform_t merge(w_T_o, m_T_w_ * w_T_o * other.w_T_m_, bundle_resolution_inv_);
+
+        /// every storage covers all points once, unaligned maps only use the first
+        std::vector<std::tuple<std::size_t, index_t, const distribution_t*>> cells;
+        const std::size_t num_storages = merge.isAligned() ? 8 : 1;
+        for (std::size_t s = 0 ; s < num_storages ; ++ s)
+            other.storage_[s]->traverse([&cells, s](const index_t &c, const distribution_t &d) {
+                cells.emplace_back(s, c, &d);
+            });
+
+        /// bundles are allocated sequentially, cells are fused in parallel
+        std::vector<index_t> targets;
+        if (merge.isAligned())
+            other.bundle_storage_->traverse([&targets, &merge](const index_t &bi, const distribution_bundle_t &) {
+                targets.emplace_back(merge.bundle(bi));
+            });
+        else
+            for (const auto &c : cells)
+                targets.emplace_back(merge.center(std::get<0>(c), std::get<1>(c)));
+
+        std::vector<distribution_bundle_t*> bundles;
+        for (const index_t &bi : targets)
+            bundles.emplace_back(getAllocate(bi));
+
+        cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+        cslibs_ndt::Executor::jobs_t jobs;
+        for (const auto &r : executor.split(cells.size(), 1024)) {
+            jobs.emplace_back([this, r, &cells, &bundles, &merge]() {
+                for (std::size_t i = r.first ; i < r.second ; ++ i) {
+                    distribution_t cell;
+                    cell.data() = merge.apply(std::get<2>(cells[i])->getHandle()->data());
+                    if (merge.isAligned()) {
+                        std::size_t s = std::get<0>(cells[i]);
+                        index_t     c = std::get<1>(cells[i]);
+                        merge.cell(s, c);
+                        if (distribution_t *d = storage_[s]->get(c))
+                            d->getHandle()->merge(cell);
+                    } else {
+                        for (std::size_t j = 0 ; j < 8 ; ++ j)
+                            bundles[i]->at(j)->getHandle()->merge(cell);
+                    }
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+
+        for (const index_t &bi : targets)
+            changes_.mark(bi);
+    }
+
     inline double sample(const point_t &p) const
     {
         const index_t bi = toBundleIndex(p);
@@ -247,6 +323,26 @@ public:
         return getAllocate(bi);
     }
 
+    /**
+     * @brief Bundle at bi without allocating it, nullptr if there is none.
+     */
+    inline const distribution_bundle_t* findDistributionBundle(const index_t &bi) const
+    {
+        lock_t l(bundle_storage_mutex_);
+        return bundle_storage_->get(bi);
+    }
+
+    /**
+     * @brief Take the indices of the bundles changed since the previous call,
+     *        the first call returns all bundles and starts tracking changes.
+     */
+    inline void takeChangedBundleIndices(std::vector<index_t> &indices) const
+    {
+        changes_.take(indices, [this](std::vector<index_t> &all) {
+            getBundleIndices(all);
+        });
+    }
+
     inline double getBundleResolution() const
     {
         return bundle_resolution_;
@@ -322,6 +418,7 @@ protected:
     mutable distribution_storage_array_t            storage_;
     mutable mutex_t                                 bundle_storage_mutex_;
     mutable distribution_bundle_storage_ptr_t       bundle_storage_;
+    mutable cslibs_ndt::ChangeTracker<3>            changes_;
 
     inline distribution_t* getAllocate(const distribution_storage_ptr_t &s,
                                        const index_t &i) const
@@ -395,6 +492,10 @@ protected:
                  static_cast<int>(std::floor(p_m(2) * bundle_resolution_inv_))}};
     }
 };
+
+using Gridmap       = BasicGridmap<>;
+using HashGridmap   = BasicGridmap<cslibs_ndt::backend::Hash>;
+using MortonGridmap = BasicGridmap<cslibs_ndt::backend::Morton>;
 }
 }
 
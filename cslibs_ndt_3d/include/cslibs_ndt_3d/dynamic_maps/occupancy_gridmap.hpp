@@ -5,12 +5,20 @@
 #include <vector>
 #include <cmath>
 #include <memory>
+#include <tuple>
 
 #include <cslibs_math_3d/linear/pose.hpp>
 #include <cslibs_math_3d/linear/point.hpp>
 
 #include <cslibs_ndt/common/occupancy_distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/point_indexer.hpp>
+#include <cslibs_ndt/common/backend.hpp>
+#include <cslibs_ndt/common/merge_transform.hpp>
+#include <cslibs_ndt/common/executor.hpp>
+#include <cslibs_ndt/common/occupancy_snapshot.hpp>
+#include <cslibs_ndt/common/contribution.hpp>
+#include <cslibs_ndt/common/change_tracker.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -26,14 +34,16 @@
 #include <cslibs_math_3d/algorithms/efla_iterator.hpp>
 
 #include <unordered_map>
+#include <atomic>
 namespace cis = cslibs_indexed_storage;
 
 namespace cslibs_ndt_3d {
 namespace dynamic_maps {
-class OccupancyGridmap
+template <template <typename, typename> class backend_t = cslibs_ndt::backend::KDTree>
+class BasicOccupancyGridmap
 {
 public:
-    using Ptr                               = std::shared_ptr<OccupancyGridmap>;
+    using Ptr                               = std::shared_ptr<BasicOccupancyGridmap>;
     using pose_t                            = cslibs_math_3d::Pose3d;
     using transform_t                       = cslibs_math_3d::Transform3d;
     using point_t                           = cslibs_math_3d::Point3d;
@@ -41,18 +51,21 @@ public:
     using mutex_t                           = std::mutex;
     using lock_t                            = std::unique_lock<mutex_t>;
     using distribution_t                    = cslibs_ndt::OccupancyDistribution<3>;
-    using distribution_storage_t            = cis::Storage<distribution_t, index_t, cis::backend::kdtree::KDTree>;
+    using distribution_storage_t            = backend_t<distribution_t, index_t>;
     using distribution_storage_ptr_t        = std::shared_ptr<distribution_storage_t>;
     using distribution_storage_array_t      = std::array<distribution_storage_ptr_t, 8>;
     using distribution_bundle_t             = cslibs_ndt::Bundle<distribution_t*, 8>;
     using distribution_const_bundle_t       = cslibs_ndt::Bundle<const distribution_t*, 8>;
-    using distribution_bundle_storage_t     = cis::Storage<distribution_bundle_t, index_t, cis::backend::kdtree::KDTree>;
+    using distribution_bundle_storage_t     = backend_t<distribution_bundle_t, index_t>;
     using distribution_bundle_storage_ptr_t = std::shared_ptr<distribution_bundle_storage_t>;
+    using merge_transform_t                 = cslibs_ndt::MergeTransform<3>;
     using simple_iterator_t                 = cslibs_math_3d::algorithms::SimpleIterator;
     using inverse_sensor_model_t            = cslibs_gridmaps::utility::InverseModel;
+    using snapshot_t                        = cslibs_ndt::OccupancySnapshot<3, transform_t>;
+    using contribution_t                    = cslibs_ndt::Contribution<3, pose_t>;
 
-    OccupancyGridmap(const pose_t &origin,
-                     const double  resolution) :
+    BasicOccupancyGridmap(const pose_t &origin,
+                          const double  resolution) :
         resolution_(resolution),
         resolution_inv_(1.0 / resolution_),
         bundle_resolution_(0.5 * resolution_),
@@ -69,16 +82,19 @@ public:
                  distribution_storage_ptr_t(new distribution_storage_t),
                  distribution_storage_ptr_t(new distribution_storage_t),
                  distribution_storage_ptr_t(new distribution_storage_t)}},
-        bundle_storage_(new distribution_bundle_storage_t)
+        bundle_storage_(new distribution_bundle_storage_t),
+        arena_(new cslibs_ndt::Arena),
+        decay_(new cslibs_ndt::Decay),
+        snapshot_version_(0)
     {
     }
 
-    OccupancyGridmap(const pose_t &origin,
-                     const double resolution,
-                     const index_t &min_index,
-                     const index_t &max_index,
-                     const std::shared_ptr<distribution_bundle_storage_t> &bundles,
-                     const distribution_storage_array_t                   &storage) :
+    BasicOccupancyGridmap(const pose_t &origin,
+                          const double resolution,
+                          const index_t &min_index,
+                          const index_t &max_index,
+                          const std::shared_ptr<distribution_bundle_storage_t> &bundles,
+                          const distribution_storage_array_t                   &storage) :
         resolution_(resolution),
         resolution_inv_(1.0 / resolution_),
         bundle_resolution_(0.5 * resolution_),
@@ -88,8 +104,12 @@ public:
         min_index_(min_index),
         max_index_(max_index),
         storage_(storage),
-        bundle_storage_(bundles)
+        bundle_storage_(bundles),
+        arena_(new cslibs_ndt::Arena),
+        decay_(new cslibs_ndt::Decay),
+        snapshot_version_(0)
     {
+        adoptCells();
     }
 
     inline point_t getMin() const
@@ -154,28 +174,83 @@ public:
                        const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points)
     {
         distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = origin * p;
-            if (pm.isNormal()) {
-                const index_t &bi = toBundleIndex(pm);
-                distribution_t *d = storage.get(bi);
-                (d ? d : &storage.insert(bi, distribution_t()))->updateOccupied(pm);
-            }
+        index(origin, points, storage);
+        insertBundles<line_iterator_t>(origin, storage, nullptr);
+    }
+
+    /**
+     * @brief Insert a scan and log its contribution per bundle, so that it can
+     *        be removed or moved to a corrected pose later on. A scan inserted
+     *        again under the same id replaces the earlier one.
+     */
+    template <typename line_iterator_t = simple_iterator_t>
+    inline void insert(const pose_t &origin,
+                       const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points,
+                       const std::size_t scan_id)
+    {
+        lock_t l(contributions_mutex_);
+        removeContribution(scan_id);
+
+        distribution_storage_t storage;
+        index(origin, points, storage);
+        contribution_t &c = contributions_[scan_id];
+        c.origin = origin;
+        insertBundles<line_iterator_t>(origin, storage, &c);
+    }
+
+    /**
+     * @brief Take a logged scan back out of the map.
+     * @return false if no scan was logged under the id
+     */
+    inline bool remove(const std::size_t scan_id)
+    {
+        lock_t l(contributions_mutex_);
+        return removeContribution(scan_id);
+    }
+
+    /**
+     * @brief Move a logged scan to a corrected sensor pose. The logged bundle
+     *        statistics are taken out, moved and inserted again, so the cost
+     *        only depends on the size of the scan.
+     * @return false if no scan was logged under the id
+     */
+    template <typename line_iterator_t = simple_iterator_t>
+    inline bool reinsert(const std::size_t scan_id,
+                         const pose_t     &origin)
+    {
+        lock_t l(contributions_mutex_);
+        const auto previous = contributions_.find(scan_id);
+        if (previous == contributions_.end())
+            return false;
+
+        const transform_t       correction = origin * previous->second.origin.inverse();
+        const merge_transform_t t(correction, m_T_w_ * correction * w_T_m_, bundle_resolution_inv_);
+        distribution_storage_t  storage;
+        for (const typename contribution_t::occupied_t &o : previous->second.occupied) {
+            const typename distribution_t::distribution_ptr_t d(
+                        new typename contribution_t::distribution_t(t.apply(o.second)));
+            const index_t bi = toBundleIndex(point_t(d->getMean()));
+            distribution_t *s = storage.get(bi);
+            (s ? s : &storage.insert(bi, distribution_t(arena_)))->updateOccupied(d);
         }
+        removeContribution(scan_id);
 
-        const point_t start_p = m_T_w_ * origin.translation();
-        storage.traverse([this, &start_p](const index_t& bi, const distribution_t &d) {
-            if (!d.getDistribution())
-                return;
-            updateOccupied(bi, d.getDistribution());
+        contribution_t &c = contributions_[scan_id];
+        c.origin = origin;
+        insertBundles<line_iterator_t>(origin, storage, &c);
+        return true;
+    }
 
-            line_iterator_t it(start_p, m_T_w_ * point_t(d.getDistribution()->getMean()), bundle_resolution_);
-            const std::size_t n = d.numOccupied();
-            while (!it.done()) {
-                updateFree({{it.x(), it.y(), it.z()}}, n);
-                ++ it;
-            }
-        });
+    /**
+     * @brief Memory held by the contribution log.
+     */
+    inline std::size_t getContributionByteSize() const
+    {
+        lock_t l(contributions_mutex_);
+        std::size_t size = 0;
+        for (const auto &c : contributions_)
+            size += c.second.byte_size();
+        return size;
     }
 
     template <typename line_iterator_t = simple_iterator_t>
@@ -211,14 +286,11 @@ public:
         };
 
         distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = origin * p;
-            if (pm.isNormal()) {
-                const index_t &bi = toBundleIndex(pm);
-                distribution_t *d = storage.get(bi);
-                (d ? d : &storage.insert(bi, distribution_t()))->updateOccupied(pm);
-            }
-        }
+        const cslibs_ndt::PointIndexer<3, pose_t, transform_t> indexer(origin, m_T_w_, bundle_resolution_inv_);
+        indexer.apply(*points, [this, &storage](const point_t &pm, const index_t &bi) {
+            distribution_t *d = storage.get(bi);
+            (d ? d : &storage.insert(bi, distribution_t(arena_)))->updateOccupied(pm);
+        });
 
         const point_t start_p = m_T_w_ * origin.translation();
         storage.traverse([this, &ivm_visibility, &start_p, &current_visibility](const index_t& bi, const distribution_t &d) {
@@ -244,6 +316,76 @@ public:
         });
     }
 
+    /**
+     * @brief Fuse the cells of another map of equal resolution into this one,
+     *        e.g. to combine maps of several robots or mapping sessions.
+     *        Maps whose grids are shifted against each other by whole bundles
+     *        are fused exactly, otherwise cells are inserted at their centers.
+     * @param other map to merge, must not be written while merging
+     * @param w_T_o transformation from the world frame of other into the
+     *              world frame of this map
+     */
+    inline void merge(const BasicOccupancyGridmap &other,
+                      const transform_t &w_T_o = transform_t())
+    {
+        if (&other == this)
+            throw std::runtime_error("[OccupancyGridmap]: cannot merge a map into itself");
+        if (std::abs(other.resolution_ - resolution_) > 1e-9)
+            throw std::runtime_error("[OccupancyGridmap]: cannot merge maps of different resolution");
+
+        const merge_transform_t merge(w_T_o, m_T_w_ * w_T_o * other.w_T_m_, bundle_resolution_inv_);
+
+        /// every storage covers all points once, unaligned maps only use the first
+        std::vector<std::tuple<std::size_t, index_t, const distribution_t*>> cells;
+        const std::size_t num_storages = merge.isAligned() ? 8 : 1;
+        for (std::size_t s = 0 ; s < num_storages ; ++ s)
+            other.storage_[s]->traverse([&cells, s](const index_t &c, const distribution_t &d) {
+                cells.emplace_back(s, c, &d);
+            });
+
+        /// bundles are allocated sequentially, cells are fused in parallel
+        std::vector<index_t> targets;
+        if (merge.isAligned())
+            other.bundle_storage_->traverse([&targets, &merge](const index_t &bi, const distribution_bundle_t &) {
+                targets.emplace_back(merge.bundle(bi));
+            });
+        else
+            for (const auto &c : cells)
+                targets.emplace_back(merge.center(std::get<0>(c), std::get<1>(c)));
+
+        std::vector<distribution_bundle_t*> bundles;
+        for (const index_t &bi : targets)
+            bundles.emplace_back(getAllocate(bi));
+
+        cslibs_ndt::Executor &executor = cslibs_ndt::Executor::instance();
+        cslibs_ndt::Executor::jobs_t jobs;
+        for (const auto &r : executor.split(cells.size(), 1024)) {
+            jobs.emplace_back([this, r, &cells, &bundles, &merge]() {
+                for (std::size_t i = r.first ; i < r.second ; ++ i) {
+                    distribution_t cell = *std::get<2>(cells[i])->getHandle();
+                    cell.transform([&merge](const typename distribution_t::distribution_t &d) {
+                        return merge.apply(d);
+                    });
+                    if (merge.isAligned()) {
+                        std::size_t s = std::get<0>(cells[i]);
+                        index_t     c = std::get<1>(cells[i]);
+                        merge.cell(s, c);
+                        if (distribution_t *d = storage_[s]->get(c))
+                            d->getHandle()->merge(cell);
+                    } else {
+                        for (std::size_t j = 0 ; j < 8 ; ++ j)
+                            bundles[i]->at(j)->getHandle()->merge(cell);
+                    }
+                }
+                return true;
+            });
+        }
+        executor.run(jobs);
+
+        for (const index_t &bi : targets)
+            markChanged(bi);
+    }
+
     inline double sample(const point_t &p,
                          const inverse_sensor_model_t::Ptr &ivm) const
     {
@@ -330,6 +472,27 @@ public:
         return getAllocate(bi);
     }
 
+    /**
+     * @brief Bundle at bi without allocating it, nullptr if there is none.
+     */
+    inline const distribution_bundle_t* findDistributionBundle(const index_t &bi) const
+    {
+        lock_t l(bundle_storage_mutex_);
+        return bundle_storage_->get(bi);
+    }
+
+    /**
+     * @brief Take the indices of the bundles changed since the previous call,
+     *        the first call returns all bundles and starts tracking changes.
+     *        Decay ages cells without writing them and is not tracked.
+     */
+    inline void takeChangedBundleIndices(std::vector<index_t> &indices) const
+    {
+        changes_.take(indices, [this](std::vector<index_t> &all) {
+            getBundleIndices(all);
+        });
+    }
+
     inline double getBundleResolution() const
     {
         return bundle_resolution_;
@@ -375,6 +538,104 @@ public:
         bundle_storage_->traverse(add_index);
     }
 
+    /**
+     * @brief The last published snapshot, lock-free and safe to call from any
+     *        thread while the map is written. Empty before updateSnapshot.
+     */
+    inline typename snapshot_t::Ptr getSnapshot() const
+    {
+        return std::atomic_load(&snapshot_);
+    }
+
+    /**
+     * @brief Publish a snapshot of the current map state and return it. Only
+     *        chunks written since the previous snapshot are copied, the others
+     *        are shared. Call it from the thread writing the map.
+     */
+    inline typename snapshot_t::Ptr updateSnapshot() const
+    {
+        lock_t l(snapshot_mutex_);
+        const std::size_t version = ++ snapshot_version_;
+        const typename snapshot_t::Ptr previous = std::atomic_load(&snapshot_);
+
+        /// changed bundles come with their neighbours, as these share cells with them,
+        /// the first snapshot covers the whole map, including maps loaded from file
+        std::vector<index_t> bundles;
+        snapshot_changes_.take(bundles, [this](std::vector<index_t> &all) {
+            getBundleIndices(all);
+        });
+        std::vector<index_t> changed;
+        cslibs_ndt::HashStorage<bool, index_t> changed_chunks;
+        for (const index_t &bi : bundles) {
+            const index_t ci = snapshot_t::chunkIndex(bi);
+            if (!changed_chunks.get(ci)) {
+                changed_chunks.insert(ci, true);
+                changed.emplace_back(ci);
+            }
+        }
+
+        typename snapshot_t::chunks_t chunks = previous ? previous->getChunks() : typename snapshot_t::chunks_t();
+        const int cs = snapshot_t::chunk_size;
+        for (const index_t &ci : changed) {
+            std::shared_ptr<typename snapshot_t::chunk_t> chunk(new typename snapshot_t::chunk_t);
+            for (int bx = ci[0] * cs ; bx < (ci[0] + 1) * cs ; ++ bx)
+                for (int by = ci[1] * cs ; by < (ci[1] + 1) * cs ; ++ by)
+                    for (int bz = ci[2] * cs ; bz < (ci[2] + 1) * cs ; ++ bz) {
+                        const index_t bi = {{bx, by, bz}};
+                        const distribution_bundle_t *bundle = bundle_storage_->get(bi);
+                        if (!bundle)
+                            continue;
+
+                        typename snapshot_t::bundle_t b;
+                        for (std::size_t i = 0 ; i < 8 ; ++ i) {
+                            const auto handle = bundle->at(i)->getHandle();
+                            b[i].num_free        = handle->numFree();
+                            b[i].distribution    = handle->getDistribution();
+                            b[i].weight_free     = handle->getWeightFree();
+                            b[i].weight_occupied = handle->getWeightOccupied();
+                            b[i].stamp           = handle->getStamp();
+                        }
+                        chunk->insert(bi, b);
+                    }
+            chunks.insert(ci, chunk);
+        }
+
+        const typename snapshot_t::Ptr snapshot(new snapshot_t(m_T_w_, bundle_resolution_inv_, version, chunks, *decay_));
+        std::atomic_store(&snapshot_, snapshot);
+        return snapshot;
+    }
+
+    /**
+     * @brief Forget occupancy evidence exponentially with the given half life
+     *        in seconds, a non positive half life keeps all evidence. Cells are
+     *        aged lazily when they are written or read.
+     */
+    inline void setDecayHalfLife(const double half_life)
+    {
+        decay_->setHalfLife(half_life);
+    }
+
+    inline double getDecayHalfLife() const
+    {
+        return decay_->getHalfLife();
+    }
+
+    /**
+     * @brief Advance the clock of the map, e.g. to the stamp of the next scan.
+     */
+    inline void setTime(const double time)
+    {
+        decay_->setTime(time);
+    }
+
+    /**
+     * @brief Allocation counts of the occupied statistics of the cells.
+     */
+    inline cslibs_ndt::Arena::Statistics getAllocationStatistics() const
+    {
+        return arena_->getStatistics();
+    }
+
     inline std::size_t getByteSize() const
     {
         lock_t(storage_mutex_);
@@ -405,13 +666,34 @@ private:
     mutable distribution_storage_array_t            storage_;
     mutable mutex_t                                 bundle_storage_mutex_;
     mutable distribution_bundle_storage_ptr_t       bundle_storage_;
+    const cslibs_ndt::Arena::Ptr                    arena_;
+    const cslibs_ndt::Decay::Ptr                    decay_;
+
+    mutable mutex_t                                 snapshot_mutex_;
+    mutable cslibs_ndt::ChangeTracker<3>            snapshot_changes_;
+    mutable typename snapshot_t::Ptr                snapshot_;
+    mutable std::atomic<std::size_t>                snapshot_version_;
+
+    mutable mutex_t                                 contributions_mutex_;
+    std::unordered_map<std::size_t, contribution_t> contributions_;
+
+    mutable cslibs_ndt::ChangeTracker<3>            changes_;
+
+    /// cells of loaded or converted storages forget their evidence with this map
+    inline void adoptCells()
+    {
+        for (const distribution_storage_ptr_t &s : storage_)
+            s->traverse([this](const index_t &, distribution_t &d) {
+                d.setDecay(decay_);
+            });
+    }
 
     inline distribution_t* getAllocate(const distribution_storage_ptr_t &s,
                                        const index_t &i) const
     {
         lock_t(storage_mutex_);
         distribution_t *d = s->get(i);
-        return d ? d : &(s->insert(i, distribution_t()));
+        return d ? d : &(s->insert(i, distribution_t(arena_, decay_)));
     }
 
     inline distribution_bundle_t *getAllocate(const index_t &bi) const
@@ -479,6 +761,7 @@ private:
         bundle->at(5)->getHandle()->updateFree();
         bundle->at(6)->getHandle()->updateFree();
         bundle->at(7)->getHandle()->updateFree();
+        markChanged(bi);
     }
 
     inline void updateFree(const index_t &bi,
@@ -497,6 +780,7 @@ private:
         bundle->at(5)->getHandle()->updateFree(n);
         bundle->at(6)->getHandle()->updateFree(n);
         bundle->at(7)->getHandle()->updateFree(n);
+        markChanged(bi);
     }
 
     inline void updateOccupied(const index_t &bi,
@@ -515,6 +799,7 @@ private:
         bundle->at(5)->getHandle()->updateOccupied(p);
         bundle->at(6)->getHandle()->updateOccupied(p);
         bundle->at(7)->getHandle()->updateOccupied(p);
+        markChanged(bi);
     }
 
     inline void updateOccupied(const index_t &bi,
@@ -533,6 +818,80 @@ private:
         bundle->at(5)->getHandle()->updateOccupied(d);
         bundle->at(6)->getHandle()->updateOccupied(d);
         bundle->at(7)->getHandle()->updateOccupied(d);
+        markChanged(bi);
+    }
+
+    inline void index(const pose_t &origin,
+                      const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points,
+                      distribution_storage_t &storage) const
+    {
+        const cslibs_ndt::PointIndexer<3, pose_t, transform_t> indexer(origin, m_T_w_, bundle_resolution_inv_);
+        indexer.apply(*points, [this, &storage](const point_t &pm, const index_t &bi) {
+            distribution_t *d = storage.get(bi);
+            (d ? d : &storage.insert(bi, distribution_t(arena_)))->updateOccupied(pm);
+        });
+    }
+
+    /// free counts are summed up per bundle before they are logged
+    template <typename line_iterator_t>
+    inline void insertBundles(const pose_t           &origin,
+                              distribution_storage_t &storage,
+                              contribution_t         *contribution)
+    {
+        cslibs_ndt::HashStorage<std::size_t, index_t> free;
+        const point_t start_p = m_T_w_ * origin.translation();
+        storage.traverse([this, &start_p, &free, contribution](const index_t& bi, const distribution_t &d) {
+            if (!d.getDistribution())
+                return;
+            updateOccupied(bi, d.getDistribution());
+
+            line_iterator_t it(start_p, m_T_w_ * point_t(d.getDistribution()->getMean()), bundle_resolution_);
+            const std::size_t n = d.numOccupied();
+            while (!it.done()) {
+                const index_t bit = {{it.x(), it.y(), it.z()}};
+                updateFree(bit, n);
+                if (contribution) {
+                    std::size_t *f = free.get(bit);
+                    (f ? *f : free.insert(bit, 0ul)) += n;
+                }
+                ++ it;
+            }
+            if (contribution)
+                contribution->occupied.emplace_back(bi, *d.getDistribution());
+        });
+
+        if (contribution)
+            free.traverse([contribution](const index_t &bi, const std::size_t &n) {
+                contribution->free.emplace_back(bi, n);
+            });
+    }
+
+    inline bool removeContribution(const std::size_t scan_id)
+    {
+        const auto c = contributions_.find(scan_id);
+        if (c == contributions_.end())
+            return false;
+
+        for (const typename contribution_t::occupied_t &o : c->second.occupied)
+            removeFromBundle(o.first, 0, &o.second);
+        for (const typename contribution_t::free_t &f : c->second.free)
+            removeFromBundle(f.first, f.second, nullptr);
+        contributions_.erase(c);
+        return true;
+    }
+
+    inline void removeFromBundle(const index_t &bi,
+                                 const std::size_t num_free,
+                                 const typename contribution_t::distribution_t *d)
+    {
+        distribution_bundle_t *bundle;
+        {
+            lock_t l(bundle_storage_mutex_);
+            bundle = getAllocate(bi);
+        }
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            bundle->at(i)->getHandle()->remove(num_free, d);
+        markChanged(bi);
     }
 
     inline void updateIndices(const index_t &bi) const
@@ -541,6 +900,12 @@ private:
         max_index_ = std::max(max_index_, bi);
     }
 
+    inline void markChanged(const index_t &bi) const
+    {
+        changes_.mark(bi);
+        snapshot_changes_.mark(bi);
+    }
+
     inline index_t toBundleIndex(const point_t &p_w) const
     {
         const point_t p_m = m_T_w_ * p_w;
@@ -549,6 +914,10 @@ private:
                  static_cast<int>(std::floor(p_m(2) * bundle_resolution_inv_))}};
     }
 };
+
+using OccupancyGridmap       = BasicOccupancyGridmap<>;
+using HashOccupancyGridmap   = BasicOccupancyGridmap<cslibs_ndt::backend::Hash>;
+using MortonOccupancyGridmap = BasicOccupancyGridmap<cslibs_ndt::backend::Morton>;
 }
 }
 
@@ -0,0 +1,16 @@
+#ifndef CSLIBS_NDT_3D_DYNAMIC_MAPS_SUBMAP_COLLECTION_HPP
+#define CSLIBS_NDT_3D_DYNAMIC_MAPS_SUBMAP_COLLECTION_HPP
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt/common/submap_collection.hpp>
+
+namespace cslibs_ndt_3d {
+namespace dynamic_maps {
+using SubmapCollection          = cslibs_ndt::SubmapCollection<Gridmap>;
+using OccupancySubmapCollection = cslibs_ndt::SubmapCollection<OccupancyGridmap>;
+}
+}
+
+#endif // CSLIBS_NDT_3D_DYNAMIC_MAPS_SUBMAP_COLLECTION_HPP
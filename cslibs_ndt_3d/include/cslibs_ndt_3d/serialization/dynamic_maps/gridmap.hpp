@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
 
+#include <cslibs_ndt/common/executor.hpp>
 #include <cslibs_ndt/serialization/filesystem.hpp>
 #include <cslibs_ndt/serialization/storage.hpp>
 
@@ -12,19 +13,20 @@
 #include <yaml-cpp/yaml.h>
 
 #include <fstream>
-#include <thread>
-#include <atomic>
 
 namespace cslibs_ndt_3d {
 namespace dynamic_maps {
-inline bool saveBinary(const cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr &map,
+template <template <typename, typename> class backend_t>
+inline bool saveBinary(const std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &map,
                        const std::string &path)
 {
+    using map_t      = cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>;
     using path_t     = boost::filesystem::path;
     using paths_t    = std::array<path_t, 8>;
-    using index_t    = cslibs_ndt_3d::dynamic_maps::Gridmap::index_t;
-    using storages_t = cslibs_ndt_3d::dynamic_maps::Gridmap::distribution_storage_array_t;
+    using index_t    = typename map_t::index_t;
+    using storages_t = typename map_t::distribution_storage_array_t;
     using binary_t   = cslibs_ndt::binary<cslibs_ndt::Distribution, 3, 3>;
+    using blocks_t   = cslibs_ndt::blocks<3>;
 
     /// step one: check if the root diretory exists
     path_t path_root(path);
@@ -40,24 +42,32 @@ inline bool saveBinary(const cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr &map,
                             path_root / path_t("store_5.bin"),
                             path_root / path_t("store_6.bin"),
                             path_root / path_t("store_7.bin")}};
+    const path_t path_bundles = path_root / path_t("bundles.bin");
 
     /// step three: we have our filesystem, now we write out the distributions file by file
     /// meta file
+    const int block_size = blocks_t::default_size;
     const path_t path_file = path_t("map.yaml");
     {
         std::ofstream out((path_root / path_file).string(), std::fstream::trunc);
         YAML::Emitter yaml(out);
         YAML::Node n;
-        std::vector<index_t> indices;
-        map->getBundleIndices(indices);
         n["origin"]     = map->getInitialOrigin();
         n["resolution"] = map->getResolution();
         n["min_index"]  = map->getMinDistributionIndex();
         n["max_index"]  = map->getMaxDistributionIndex();
-        n["bundles"]    = indices;
+        n["format"]     = std::string("blocked");
         yaml << n;
     }
 
+    /// bundle indices, grouped by blocks covering the same space as the storage blocks
+    {
+        std::vector<index_t> indices;
+        map->getBundleIndices(indices);
+        if (!blocks_t::save(indices, 2 * block_size, path_bundles))
+            return false;
+    }
+
     /// step four: write out the storages
     const storages_t storages = {{map->getStorages()[0],
                                   map->getStorages()[1],
@@ -68,27 +78,33 @@ inline bool saveBinary(const cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr &map,
                                   map->getStorages()[6],
                                   map->getStorages()[7]}};
 
-    std::array<std::thread, 8> threads;
-    std::atomic_bool success(true);
+    cslibs_ndt::Executor::jobs_t jobs;
     for (std::size_t i = 0 ; i < 8 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::save(storages[i], paths[i]);
-        });
-    for (std::size_t i = 0 ; i < 8 ; ++i)
-        threads[i].join();
+        if (!binary_t::saveBlocked(storages[i], paths[i], block_size, jobs))
+            return false;
 
-    return success;
+    return cslibs_ndt::Executor::instance().run(jobs);
 }
 
+/**
+ * @brief Load the part of a saved map covering the bundle indices [min_bi, max_bi].
+ *        Maps saved in the blocked format are read block wise, older maps are
+ *        filtered while reading.
+ */
+template <template <typename, typename> class backend_t>
 inline bool loadBinary(const std::string &path,
-                       cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr &map)
+                       std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &map,
+                       const typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::index_t &min_bi,
+                       const typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::index_t &max_bi)
 {
+    using map_t            = cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>;
     using path_t           = boost::filesystem::path;
     using paths_t          = std::array<path_t, 8>;
-    using index_t          = cslibs_ndt_3d::dynamic_maps::Gridmap::index_t;
+    using index_t          = typename map_t::index_t;
     using binary_t         = cslibs_ndt::binary<cslibs_ndt::Distribution, 3, 3>;
-    using bundle_storage_t = cslibs_ndt_3d::dynamic_maps::Gridmap::distribution_bundle_storage_t;
-    using storages_t       = cslibs_ndt_3d::dynamic_maps::Gridmap::distribution_storage_array_t;
+    using blocks_t         = cslibs_ndt::blocks<3>;
+    using bundle_storage_t = typename map_t::distribution_bundle_storage_t;
+    using storages_t       = typename map_t::distribution_storage_array_t;
 
     /// step one: check if the root diretory exists
     path_t path_root(path);
@@ -104,6 +120,7 @@ inline bool loadBinary(const std::string &path,
                             path_root / path_t("store_5.bin"),
                             path_root / path_t("store_6.bin"),
                             path_root / path_t("store_7.bin")}};
+    const path_t path_bundles = path_root / path_t("bundles.bin");
 
     /// step three: we have our filesystem, now we can load distributions file by file
     for (std::size_t i = 0 ; i < 8 ; ++i)
@@ -119,24 +136,37 @@ inline bool loadBinary(const std::string &path,
     YAML::Node n = YAML::LoadFile((path_root / path_file).string());
     const cslibs_math_3d::Transform3d origin     = n["origin"].as<cslibs_math_3d::Transform3d>();
     const double                      resolution = n["resolution"].as<double>();
-    const index_t                     min_index  = n["min_index"].as<index_t>();
-    const index_t                     max_index  = n["max_index"].as<index_t>();
-    const std::vector<index_t>        indices    = n["bundles"].as<std::vector<index_t>>();
+    const bool                        blocked    = n["format"].IsDefined() && n["format"].as<std::string>() == "blocked";
 
-    std::array<std::thread, 8> threads;
-    std::atomic_bool success(true);
-    for (std::size_t i = 0 ; i < 8 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::load(paths[i], storages[i]);
-        });
-    for (std::size_t i = 0 ; i < 8 ; ++i)
-        threads[i].join();
+    std::vector<index_t> indices;
+    if (blocked) {
+        if (!blocks_t::load(path_bundles, min_bi, max_bi, indices))
+            return false;
+    } else {
+        for (const index_t &bi : n["bundles"].as<std::vector<index_t>>())
+            if (blocks_t::contains(bi, min_bi, max_bi))
+                indices.emplace_back(bi);
+    }
 
-    if (!success)
+    /// storage i is shifted by one cell along every axis set in the bits of i
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (std::size_t i = 0 ; i < 8 ; ++i) {
+        index_t min_si, max_si;
+        for (std::size_t j = 0 ; j < 3 ; ++j) {
+            min_si[j] = cslibs_math::common::div<int>(min_bi[j], 2);
+            max_si[j] = cslibs_math::common::div<int>(max_bi[j], 2) +
+                        (((i >> j) & 1ul) ? cslibs_math::common::mod<int>(max_bi[j], 2) : 0);
+        }
+        if (!binary_t::load(paths[i], storages[i], min_si, max_si, jobs))
+            return false;
+    }
+    if (!cslibs_ndt::Executor::instance().run(jobs))
         return false;
 
-    auto allocate_bundle = [&storages, &bundles](const index_t &bi) {
-        cslibs_ndt_3d::dynamic_maps::Gridmap::distribution_bundle_t b;
+    index_t min_index = blocks_t::highest();
+    index_t max_index = blocks_t::lowest();
+    auto allocate_bundle = [&storages, &bundles, &min_index, &max_index](const index_t &bi) {
+        typename map_t::distribution_bundle_t b;
         const int divx = cslibs_math::common::div<int>(bi[0], 2);
         const int divy = cslibs_math::common::div<int>(bi[1], 2);
         const int divz = cslibs_math::common::div<int>(bi[2], 2);
@@ -162,19 +192,70 @@ inline bool loadBinary(const std::string &path,
         b[6] = storages[6]->get(storage_6_index);
         b[7] = storages[7]->get(storage_7_index);
         bundles->insert(bi, b);
+
+        min_index = std::min(min_index, bi);
+        max_index = std::max(max_index, bi);
     };
     for (const index_t &index : indices)
         allocate_bundle(index);
 
-    map.reset(new cslibs_ndt_3d::dynamic_maps::Gridmap(origin,
-                                                       resolution,
-                                                       min_index,
-                                                       max_index,
-                                                       bundles,
-                                                       storages));
+    map.reset(new map_t(origin,
+                        resolution,
+                        min_index,
+                        max_index,
+                        bundles,
+                        storages));
 
     return true;
 }
+
+/**
+ * @brief Load the part of a saved map intersecting the axis aligned box
+ *        [min, max] given in world coordinates.
+ */
+template <template <typename, typename> class backend_t>
+inline bool loadBinary(const std::string &path,
+                       std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &map,
+                       const typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::point_t &min,
+                       const typename cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>::point_t &max)
+{
+    using map_t   = cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>;
+    using path_t  = boost::filesystem::path;
+    using index_t = typename map_t::index_t;
+
+    path_t path_root(path);
+    if (!cslibs_ndt::common::serialization::check_file(path_root / path_t("map.yaml")))
+        return false;
+
+    /// the region is transformed into the map frame to find the covered bundles
+    YAML::Node n = YAML::LoadFile((path_root / path_t("map.yaml")).string());
+    const cslibs_math_3d::Transform3d m_T_w                 = n["origin"].as<cslibs_math_3d::Transform3d>().inverse();
+    const double                      bundle_resolution_inv = 2.0 / n["resolution"].as<double>();
+
+    index_t min_bi = {{std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::max()}};
+    index_t max_bi = {{std::numeric_limits<int>::min(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min()}};
+    for (std::size_t i = 0 ; i < 8 ; ++i) {
+        const typename map_t::point_t corner((i & 1ul) ? max(0) : min(0),
+                                  (i & 2ul) ? max(1) : min(1),
+                                  (i & 4ul) ? max(2) : min(2));
+        const typename map_t::point_t corner_m = m_T_w * corner;
+        const index_t bi = {{static_cast<int>(std::floor(corner_m(0) * bundle_resolution_inv)),
+                             static_cast<int>(std::floor(corner_m(1) * bundle_resolution_inv)),
+                             static_cast<int>(std::floor(corner_m(2) * bundle_resolution_inv))}};
+        min_bi = std::min(min_bi, bi);
+        max_bi = std::max(max_bi, bi);
+    }
+
+    return loadBinary(path, map, min_bi, max_bi);
+}
+
+template <template <typename, typename> class backend_t>
+inline bool loadBinary(const std::string &path,
+                       std::shared_ptr<cslibs_ndt_3d::dynamic_maps::BasicGridmap<backend_t>> &map)
+{
+    using blocks_t = cslibs_ndt::blocks<3>;
+    return loadBinary(path, map, blocks_t::lowest(), blocks_t::highest());
+}
 }
 }
 
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
 
+#include <cslibs_ndt/common/executor.hpp>
 #include <cslibs_ndt/serialization/filesystem.hpp>
 #include <cslibs_ndt/serialization/storage.hpp>
 
@@ -12,8 +13,6 @@
 #include <yaml-cpp/yaml.h>
 
 #include <fstream>
-#include <thread>
-#include <atomic>
 
 namespace cslibs_ndt_3d {
 namespace static_maps {
@@ -23,8 +22,10 @@ inline bool saveBinary(const cslibs_ndt_3d::static_maps::OccupancyGridmap::Ptr &
     using path_t     = boost::filesystem::path;
     using paths_t    = std::array<path_t, 8>;
     using index_t    = cslibs_ndt_3d::static_maps::OccupancyGridmap::index_t;
+    using size_t     = cslibs_ndt_3d::static_maps::OccupancyGridmap::size_t;
     using storages_t = cslibs_ndt_3d::static_maps::OccupancyGridmap::distribution_storage_array_t;
     using binary_t   = cslibs_ndt::binary<cslibs_ndt::OccupancyDistribution, 3, 3>;
+    using linear_t   = cslibs_ndt::linear<3>;
 
     /// step one: check if the root diretory exists
     path_t path_root(path);
@@ -40,23 +41,31 @@ inline bool saveBinary(const cslibs_ndt_3d::static_maps::OccupancyGridmap::Ptr &
                             path_root / path_t("store_5.bin"),
                             path_root / path_t("store_6.bin"),
                             path_root / path_t("store_7.bin")}};
+    const path_t path_bundles = path_root / path_t("bundles.bin");
 
     /// step three: we have our filesystem, now we write out the distributions file by file
     /// meta file
+    const size_t size = map->getSize();
     const path_t path_file = path_t("map.yaml");
     {
         std::ofstream out((path_root / path_file).string(), std::fstream::trunc);
         YAML::Emitter yaml(out);
         YAML::Node n;
-        std::vector<index_t> indices;
-        map->getBundleIndices(indices);
         n["origin"]     = map->getOrigin();
         n["resolution"] = map->getResolution();
-        n["size"]       = map->getSize();
-        n["bundles"]    = indices;
+        n["size"]       = size;
+        n["format"]     = std::string("dense");
         yaml << n;
     }
 
+    /// bundle indices, linearized in the layout of the bundle array
+    {
+        std::vector<index_t> indices;
+        map->getBundleIndices(indices);
+        if (!linear_t::save(indices, {{size[0] * 2, size[1] * 2, size[2] * 2}}, path_bundles))
+            return false;
+    }
+
     /// step four: write out the storages
     const storages_t storages = {{map->getStorages()[0],
                                   map->getStorages()[1],
@@ -67,16 +76,15 @@ inline bool saveBinary(const cslibs_ndt_3d::static_maps::OccupancyGridmap::Ptr &
                                   map->getStorages()[6],
                                   map->getStorages()[7]}};
 
-    std::array<std::thread, 8> threads;
-    std::atomic_bool success(true);
-    for (std::size_t i = 0 ; i < 8 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::save(storages[i], paths[i]);
-        });
-    for (std::size_t i = 0 ; i < 8 ; ++i)
-        threads[i].join();
+    cslibs_ndt::Executor::jobs_t jobs;
+    for (std::size_t i = 0 ; i < 8 ; ++i) {
+        const std::size_t off = (i > 0) ? 1 : 0;
+        const size_t      sz  = {{size[0] + off, size[1] + off, size[2] + off}};
+        if (!binary_t::saveDense(storages[i], sz, paths[i], jobs))
+            return false;
+    }
 
-    return success;
+    return cslibs_ndt::Executor::instance().run(jobs);
 }
 
 inline bool loadBinary(const std::string &path,
@@ -87,6 +95,7 @@ inline bool loadBinary(const std::string &path,
     using index_t          = cslibs_ndt_3d::static_maps::OccupancyGridmap::index_t;
     using size_t           = cslibs_ndt_3d::static_maps::OccupancyGridmap::size_t;
     using binary_t         = cslibs_ndt::binary<cslibs_ndt::OccupancyDistribution, 3, 3>;
+    using linear_t         = cslibs_ndt::linear<3>;
     using bundle_storage_t = cslibs_ndt_3d::static_maps::OccupancyGridmap::distribution_bundle_storage_t;
     using storages_t       = cslibs_ndt_3d::static_maps::OccupancyGridmap::distribution_storage_array_t;
 
@@ -120,22 +129,29 @@ inline bool loadBinary(const std::string &path,
     const cslibs_math_3d::Transform3d origin     = n["origin"].as<cslibs_math_3d::Transform3d>();
     const double                      resolution = n["resolution"].as<double>();
     const size_t                      size       = n["size"].as<size_t>();
-    const std::vector<index_t>        indices    = n["bundles"].as<std::vector<index_t>>();
     bundles->template set<cslibs_indexed_storage::option::tags::array_size>(size[0] * 2, size[1] * 2, size[2] * 2);
 
-    std::array<std::thread, 8> threads;
-    std::atomic_bool success(true);
+    /// maps written before the dense format list their bundles in the meta file
+    const bool dense = n["format"].IsDefined() && n["format"].as<std::string>() == "dense";
+    std::vector<index_t> indices;
+    if (dense) {
+        const path_t path_bundles = path_root / path_t("bundles.bin");
+        if (!cslibs_ndt::common::serialization::check_file(path_bundles) ||
+                !linear_t::load(path_bundles, {{size[0] * 2, size[1] * 2, size[2] * 2}}, indices))
+            return false;
+    } else
+        indices = n["bundles"].as<std::vector<index_t>>();
+
+    cslibs_ndt::Executor::jobs_t jobs;
     for (std::size_t i = 0 ; i < 8 ; ++i) {
-        const int off   = (i > 1) ? 1 : 0;
-        const size_t sz = {{size[0] + off, size[1] + off, size[2] + off}};
-        threads[i] = std::thread([&storages, &paths, i, &sz, &success](){
-            success = success && binary_t::load(paths[i], storages[i], sz);
-        });
+        const std::size_t off = (i > 0) ? 1 : 0;
+        const size_t      sz  = {{size[0] + off, size[1] + off, size[2] + off}};
+        const bool success = dense ? binary_t::loadDense(paths[i], storages[i], sz, jobs) :
+                                     binary_t::load(paths[i], storages[i], sz, jobs);
+        if (!success)
+            return false;
     }
-    for (std::size_t i = 0 ; i < 8 ; ++i)
-        threads[i].join();
-
-    if (!success)
+    if (!cslibs_ndt::Executor::instance().run(jobs))
         return false;
 
     auto allocate_bundle = [&storages, &bundles](const index_t &bi) {
@@ -11,6 +11,9 @@
 
 #include <cslibs_ndt/common/distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/block_storage.hpp>
+#include <cslibs_ndt/common/point_indexer.hpp>
+#include <cslibs_ndt/common/radix_sort.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -18,7 +21,6 @@
 #include <cslibs_math/common/mod.hpp>
 
 #include <cslibs_indexed_storage/storage.hpp>
-#include <cslibs_indexed_storage/backend/array/array.hpp>
 #include <cslibs_indexed_storage/operations/clustering/grid_neighborhood.hpp>
 
 namespace cis = cslibs_indexed_storage;
@@ -37,12 +39,12 @@ public:
     using mutex_t                           = std::mutex;
     using lock_t                            = std::unique_lock<mutex_t>;
     using distribution_t                    = cslibs_ndt::Distribution<3>;
-    using distribution_storage_t            = cis::Storage<distribution_t, index_t, cis::backend::array::Array>;
+    using distribution_storage_t            = cslibs_ndt::BlockStorage<distribution_t, index_t>;
     using distribution_storage_ptr_t        = std::shared_ptr<distribution_storage_t>;
     using distribution_storage_array_t      = std::array<distribution_storage_ptr_t, 8>;
     using distribution_bundle_t             = cslibs_ndt::Bundle<distribution_t*, 8>;
     using distribution_const_bundle_t       = cslibs_ndt::Bundle<const distribution_t*, 8>;
-    using distribution_bundle_storage_t     = cis::Storage<distribution_bundle_t, index_t, cis::backend::array::Array>;
+    using distribution_bundle_storage_t     = cslibs_ndt::BlockStorage<distribution_bundle_t, index_t>;
     using distribution_bundle_storage_ptr_t = std::shared_ptr<distribution_bundle_storage_t>;
 
     Gridmap(const pose_t &origin,
@@ -145,17 +147,7 @@ public:
     inline void insert(const pose_t &origin,
                        const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points)
     {
-        distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = origin * p;
-            if (pm.isNormal()) {
-                const index_t &bi = toBundleIndex(pm);
-                distribution_t *d = storage.get(bi);
-                (d ? d : &storage.insert(bi, distribution_t()))->data().add(pm);
-            }
-        }
-
-        storage.traverse([this](const index_t& bi, const distribution_t &d) {
+        sortAndMerge(origin, points, [this](const index_t& bi, const distribution_t &d) {
             distribution_bundle_t *bundle;
             {
                 lock_t(bundle_storage_mutex_);
@@ -371,6 +363,41 @@ protected:
         return get_allocate(bi);
     }
 
+    /// The points are bucketed by a radix sort of their linear bundle index and
+    /// every run of equal indices is merged into one distribution before it is
+    /// passed to fn. Points outside of the map are dropped.
+    template <typename Fn>
+    inline void sortAndMerge(const pose_t &origin,
+                             const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points,
+                             const Fn &fn) const
+    {
+        const int size_x = 2 * static_cast<int>(size_[0]);
+        const int size_y = 2 * static_cast<int>(size_[1]);
+        const int size_z = 2 * static_cast<int>(size_[2]);
+
+        std::vector<std::pair<std::size_t, point_t>> sorted;
+        sorted.reserve(points->size());
+        const cslibs_ndt::PointIndexer<3, pose_t, transform_t> indexer(origin, m_T_w_, bundle_resolution_inv_);
+        indexer.apply(*points, [&sorted, size_x, size_y, size_z](const point_t &pm, const index_t &bi) {
+            if (bi[0] >= 0 && bi[1] >= 0 && bi[2] >= 0 &&
+                    bi[0] < size_x && bi[1] < size_y && bi[2] < size_z)
+                sorted.emplace_back((static_cast<std::size_t>(bi[0]) * size_y + bi[1]) * size_z + bi[2], pm);
+        });
+        cslibs_ndt::radix_sort(sorted, static_cast<std::size_t>(size_x) * size_y * size_z);
+
+        for (std::size_t i = 0 ; i < sorted.size() ;) {
+            const std::size_t key = sorted[i].first;
+            distribution_t d;
+            for (; i < sorted.size() && sorted[i].first == key ; ++ i)
+                d.data().add(sorted[i].second);
+
+            const index_t bi = {{static_cast<int>(key / (static_cast<std::size_t>(size_y) * size_z)),
+                                 static_cast<int>((key / size_z) % size_y),
+                                 static_cast<int>(key % size_z)}};
+            fn(bi, d);
+        }
+    }
+
     inline index_t toBundleIndex(const point_t &p_w) const
     {
         const point_t p_m = m_T_w_ * p_w;
@@ -11,13 +11,17 @@
 
 #include <cslibs_ndt/common/occupancy_distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/block_storage.hpp>
+#include <cslibs_ndt/common/point_indexer.hpp>
+#include <cslibs_ndt/common/radix_sort.hpp>
+#include <cslibs_ndt/common/baked_occupancy.hpp>
 
+#include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
 #include <cslibs_math/common/div.hpp>
 #include <cslibs_math/common/mod.hpp>
 
 #include <cslibs_indexed_storage/storage.hpp>
-#include <cslibs_indexed_storage/backend/array/array.hpp>
 #include <cslibs_indexed_storage/operations/clustering/grid_neighborhood.hpp>
 
 #include <cslibs_math_3d/algorithms/bresenham.hpp>
@@ -39,15 +43,16 @@ public:
     using mutex_t                           = std::mutex;
     using lock_t                            = std::unique_lock<mutex_t>;
     using distribution_t                    = cslibs_ndt::OccupancyDistribution<3>;
-    using distribution_storage_t            = cis::Storage<distribution_t, index_t, cis::backend::array::Array>;
+    using distribution_storage_t            = cslibs_ndt::BlockStorage<distribution_t, index_t>;
     using distribution_storage_ptr_t        = std::shared_ptr<distribution_storage_t>;
     using distribution_storage_array_t      = std::array<distribution_storage_ptr_t, 8>;
     using distribution_bundle_t             = cslibs_ndt::Bundle<distribution_t*, 8>;
     using distribution_const_bundle_t       = cslibs_ndt::Bundle<const distribution_t*, 8>;
-    using distribution_bundle_storage_t     = cis::Storage<distribution_bundle_t, index_t, cis::backend::array::Array>;
+    using distribution_bundle_storage_t     = cslibs_ndt::BlockStorage<distribution_bundle_t, index_t>;
     using distribution_bundle_storage_ptr_t = std::shared_ptr<distribution_bundle_storage_t>;
     using simple_iterator_t                 = cslibs_math_3d::algorithms::SimpleIterator;
     using inverse_sensor_model_t            = cslibs_gridmaps::utility::InverseModel;
+    using baked_occupancy_t                 = cslibs_ndt::BakedOccupancy<3>;
 
     OccupancyGridmap(const pose_t &origin,
                      const double &resolution,
@@ -67,7 +72,8 @@ public:
                   distribution_storage_ptr_t(new distribution_storage_t),
                   distribution_storage_ptr_t(new distribution_storage_t),
                   distribution_storage_ptr_t(new distribution_storage_t)}},
-        bundle_storage_(new distribution_bundle_storage_t)
+        bundle_storage_(new distribution_bundle_storage_t),
+        arena_(new cslibs_ndt::Arena)
     {
         storage_[0]->template set<cis::option::tags::array_size>(size[0], size[1], size[2]);
         for(std::size_t i = 1 ; i < 8 ; ++ i)
@@ -96,7 +102,8 @@ public:
                   distribution_storage_ptr_t(new distribution_storage_t),
                   distribution_storage_ptr_t(new distribution_storage_t),
                   distribution_storage_ptr_t(new distribution_storage_t)}},
-        bundle_storage_(new distribution_bundle_storage_t)
+        bundle_storage_(new distribution_bundle_storage_t),
+        arena_(new cslibs_ndt::Arena)
     {
         storage_[0]->template set<cis::option::tags::array_size>(size[0], size[1], size[2]);
         for(std::size_t i = 1 ; i < 8 ; ++ i)
@@ -118,7 +125,8 @@ public:
         m_T_w_(w_T_m_.inverse()),
         size_(size),
         storage_(storage),
-        bundle_storage_(bundles)
+        bundle_storage_(bundles),
+        arena_(new cslibs_ndt::Arena)
     {
     }
 
@@ -131,6 +139,7 @@ public:
     inline void add(const point_t &start_p,
                     const point_t &end_p)
     {
+        invalidateBaked();
         const index_t &end_index = toBundleIndex(end_p);
         updateOccupied(end_index, end_p);
 
@@ -145,18 +154,9 @@ public:
     inline void insert(const pose_t &origin,
                        const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points)
     {
-        distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = origin * p;
-            if (pm.isNormal()) {
-                const index_t &bi = toBundleIndex(pm);
-                distribution_t *d = storage.get(bi);
-                (d ? d : &storage.insert(bi, distribution_t()))->updateOccupied(pm);
-            }
-        }
-
+        invalidateBaked();
         const point_t start_p = m_T_w_ * origin.translation();
-        storage.traverse([this, &start_p](const index_t& bi, const distribution_t &d) {
+        sortAndMerge(origin, points, [this, &start_p](const index_t& bi, const distribution_t &d) {
             if (!d.getDistribution())
                 return;
             updateOccupied(bi, d.getDistribution());
@@ -202,18 +202,9 @@ public:
                    ivm_visibility->getProbOccupied() * (1.0 - occlusion_prob);
         };
 
-        distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = origin * p;
-            if (pm.isNormal()) {
-                const index_t &bi = toBundleIndex(pm);
-                distribution_t *d = storage.get(bi);
-                (d ? d : &storage.insert(bi, distribution_t()))->updateOccupied(pm);
-            }
-        }
-
+        invalidateBaked();
         const point_t start_p = m_T_w_ * origin.translation();
-        storage.traverse([this, &ivm_visibility, &start_p, &current_visibility](const index_t& bi, const distribution_t &d) {
+        sortAndMerge(origin, points, [this, &ivm_visibility, &start_p, &current_visibility](const index_t& bi, const distribution_t &d) {
             if (!d.getDistribution())
                 return;
 
@@ -240,6 +231,10 @@ public:
                          const inverse_sensor_model_t::Ptr &ivm) const
     {
         const index_t bi = toBundleIndex(p);
+        const baked_occupancy_t::Ptr baked = std::atomic_load(&baked_);
+        if (baked && baked->getInverseModel() == ivm)
+            return baked->sample(p, bi);
+
         distribution_bundle_t *bundle;
         {
             lock_t(bundle_storage_mutex_);
@@ -272,6 +267,10 @@ public:
                                       const inverse_sensor_model_t::Ptr &ivm) const
     {
         const index_t bi = toBundleIndex(p);
+        const baked_occupancy_t::Ptr baked = std::atomic_load(&baked_);
+        if (baked && baked->getInverseModel() == ivm)
+            return baked->sampleNonNormalized(p, bi);
+
         distribution_bundle_t *bundle;
         {
             lock_t(bundle_storage_mutex_);
@@ -363,6 +362,34 @@ public:
         bundle_storage_->traverse(add_index);
     }
 
+    /**
+     * @brief Evaluate the occupancy of all cells for the given inverse model
+     *        in parallel and keep it in a quantised table. Sampling with the
+     *        same inverse model then reads the table without locking. The
+     *        table is dropped when points are added, bake again after writing
+     *        cells directly.
+     */
+    inline baked_occupancy_t::Ptr bake(const inverse_sensor_model_t::Ptr &ivm) const
+    {
+        lock_t l(bundle_storage_mutex_);
+        const baked_occupancy_t::Ptr baked = baked_occupancy_t::bake(ivm, getBundleSize(), *bundle_storage_);
+        std::atomic_store(&baked_, baked);
+        return baked;
+    }
+
+    inline baked_occupancy_t::Ptr getBakedOccupancy() const
+    {
+        return std::atomic_load(&baked_);
+    }
+
+    /**
+     * @brief Allocation counts of the occupied statistics of the cells.
+     */
+    inline cslibs_ndt::Arena::Statistics getAllocationStatistics() const
+    {
+        return arena_->getStatistics();
+    }
+
     inline std::size_t getByteSize() const
     {
         lock_t(storage_mutex_);
@@ -392,13 +419,20 @@ protected:
     mutable distribution_storage_array_t            storage_;
     mutable mutex_t                                 bundle_storage_mutex_;
     mutable distribution_bundle_storage_ptr_t       bundle_storage_;
+    const cslibs_ndt::Arena::Ptr                    arena_;
+    mutable baked_occupancy_t::Ptr                  baked_;
+
+    inline void invalidateBaked() const
+    {
+        std::atomic_store(&baked_, baked_occupancy_t::Ptr());
+    }
 
     inline distribution_t* getAllocate(const distribution_storage_ptr_t &s,
                                        const index_t &i) const
     {
         lock_t(storage_mutex_);
         distribution_t *d = s->get(i);
-        return d ? d : &(s->insert(i, distribution_t()));
+        return d ? d : &(s->insert(i, distribution_t(arena_)));
     }
 
     inline distribution_bundle_t *getAllocate(const index_t &bi) const
@@ -528,6 +562,41 @@ protected:
         bundle->at(7)->getHandle()->updateOccupied(d);
     }
 
+    /// The points are bucketed by a radix sort of their linear bundle index and
+    /// every run of equal indices is merged into one distribution before it is
+    /// passed to fn. Points outside of the map are dropped.
+    template <typename Fn>
+    inline void sortAndMerge(const pose_t &origin,
+                             const typename cslibs_math::linear::Pointcloud<point_t>::Ptr &points,
+                             const Fn &fn) const
+    {
+        const int size_x = 2 * static_cast<int>(size_[0]);
+        const int size_y = 2 * static_cast<int>(size_[1]);
+        const int size_z = 2 * static_cast<int>(size_[2]);
+
+        std::vector<std::pair<std::size_t, point_t>> sorted;
+        sorted.reserve(points->size());
+        const cslibs_ndt::PointIndexer<3, pose_t, transform_t> indexer(origin, m_T_w_, bundle_resolution_inv_);
+        indexer.apply(*points, [&sorted, size_x, size_y, size_z](const point_t &pm, const index_t &bi) {
+            if (bi[0] >= 0 && bi[1] >= 0 && bi[2] >= 0 &&
+                    bi[0] < size_x && bi[1] < size_y && bi[2] < size_z)
+                sorted.emplace_back((static_cast<std::size_t>(bi[0]) * size_y + bi[1]) * size_z + bi[2], pm);
+        });
+        cslibs_ndt::radix_sort(sorted, static_cast<std::size_t>(size_x) * size_y * size_z);
+
+        for (std::size_t i = 0 ; i < sorted.size() ;) {
+            const std::size_t key = sorted[i].first;
+            distribution_t d(arena_);
+            for (; i < sorted.size() && sorted[i].first == key ; ++ i)
+                d.updateOccupied(sorted[i].second);
+
+            const index_t bi = {{static_cast<int>(key / (static_cast<std::size_t>(size_y) * size_z)),
+                                 static_cast<int>((key / size_z) % size_y),
+                                 static_cast<int>(key % size_z)}};
+            fn(bi, d);
+        }
+    }
+
     inline index_t toBundleIndex(const point_t &p_w) const
     {
         const point_t p_m = m_T_w_ * p_w;
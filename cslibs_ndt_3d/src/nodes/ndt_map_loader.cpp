@@ -2,6 +2,7 @@
 
 #include <cslibs_ndt_3d/conversion/pointcloud.hpp>
 #include <cslibs_ndt_3d/conversion/distributions.hpp>
+#include <cslibs_ndt_3d/conversion/packed_distributions.hpp>
 
 namespace cslibs_ndt_3d {
 NDTMapLoader::NDTMapLoader() :
@@ -39,8 +40,9 @@ bool NDTMapLoader::setup()
     const std::string topic_ndt_distributions     = nh_.param<std::string>("topic_ndt_distributions",     "/map/3d/ndt/distributions");
     const std::string topic_occ_ndt_distributions = nh_.param<std::string>("topic_occ_ndt_distributions", "/map/3d/occ_ndt/distributions");
 
-    pub_ndt_distributions_     = nh_.advertise<cslibs_ndt_3d::DistributionArray>(topic_ndt_distributions,     1);
-    pub_occ_ndt_distributions_ = nh_.advertise<cslibs_ndt_3d::DistributionArray>(topic_occ_ndt_distributions, 1);
+    /// packed distributions are a fraction of the size, the receiver computes the eigen decomposition
+    const bool packed   = nh_.param<bool>("packed_distributions",   false);
+    const bool quantise = nh_.param<bool>("quantise_distributions", false);
 
     if (path_ndt != "") {
         if (!cslibs_ndt_3d::dynamic_maps::loadBinary(path_ndt, map_ndt_)) {
@@ -54,11 +56,10 @@ bool NDTMapLoader::setup()
             map_ndt_means_.reset(new sensor_msgs::PointCloud2);
             pcl::toROSMsg(*points, *map_ndt_means_);
             map_ndt_means_->header.frame_id = "/map";
-
-            cslibs_ndt_3d::conversion::from(map_ndt_, map_ndt_distributions_);
-            if (map_ndt_distributions_)
-                map_ndt_distributions_->header.frame_id = "/map";
         }
+
+        pub_ndt_distributions_.reset(new DistributionPublisher<dynamic_maps::Gridmap>(
+                                         nh_, topic_ndt_distributions, map_ndt_, packed, quantise));
     }
     if (path_occ_ndt != "") {
         if (!cslibs_ndt_3d::dynamic_maps::loadBinary(path_occ_ndt, map_occ_ndt_)) {
@@ -74,11 +75,10 @@ bool NDTMapLoader::setup()
             map_occ_ndt_means_.reset(new sensor_msgs::PointCloud2);
             pcl::toROSMsg(*points, *map_occ_ndt_means_);
             map_occ_ndt_means_->header.frame_id = "/map";
-
-            cslibs_ndt_3d::conversion::from(map_occ_ndt_, map_occ_ndt_distributions_, ivm);
-            if (map_occ_ndt_distributions_)
-                map_occ_ndt_distributions_->header.frame_id = "/map";
         }
+
+        pub_occ_ndt_distributions_.reset(new DistributionPublisher<dynamic_maps::OccupancyGridmap>(
+                                             nh_, topic_occ_ndt_distributions, map_occ_ndt_, packed, quantise, ivm));
     }
 
     service_ = nh_.advertiseService(nh_.getNamespace() + "/resend", &NDTMapLoader::resend, this);
@@ -89,7 +89,7 @@ bool NDTMapLoader::setup()
 bool NDTMapLoader::resend(std_srvs::Empty::Request &req,
                           std_srvs::Empty::Response &res)
 {
-    if (!map_ndt_means_ && !map_occ_ndt_means_ && !map_ndt_distributions_ && !map_occ_ndt_distributions_) {
+    if (!map_ndt_means_ && !map_occ_ndt_means_ && !pub_ndt_distributions_ && !pub_occ_ndt_distributions_) {
         ROS_ERROR_STREAM("What can I say, I have nothing to offer!");
         return false;
     }
@@ -103,14 +103,11 @@ bool NDTMapLoader::resend(std_srvs::Empty::Request &req,
         pub_occ_ndt_means_.publish(map_occ_ndt_means_);
     }
 
-    if (map_ndt_distributions_) {
-        map_ndt_distributions_->header.stamp = ros::Time::now();
-        pub_ndt_distributions_.publish(map_ndt_distributions_);
-    }
-    if (map_occ_ndt_distributions_) {
-        map_occ_ndt_distributions_->header.stamp = ros::Time::now();
-        pub_occ_ndt_distributions_.publish(map_occ_ndt_distributions_);
-    }
+    /// always the whole maps, so subscribers which missed an update catch up
+    if (pub_ndt_distributions_)
+        pub_ndt_distributions_->publish();
+    if (pub_occ_ndt_distributions_)
+        pub_occ_ndt_distributions_->publish();
 
     return true;
 }
@@ -3,9 +3,11 @@
 
 #include <cslibs_ndt_3d/serialization/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_3d/serialization/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_3d/distribution_publisher.hpp>
 
 #include <sensor_msgs/PointCloud2.h>
 #include <cslibs_ndt_3d/DistributionArray.h>
+#include <cslibs_ndt_3d/PackedDistributionArray.h>
 #include <pcl_conversions/pcl_conversions.h>
 
 #include <ros/ros.h>
@@ -25,8 +27,6 @@ private:
     ros::NodeHandle     nh_;
     ros::Publisher      pub_ndt_means_;
     ros::Publisher      pub_occ_ndt_means_;
-    ros::Publisher      pub_ndt_distributions_;
-    ros::Publisher      pub_occ_ndt_distributions_;
     ros::ServiceServer  service_;
 
     cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr          map_ndt_;
@@ -35,8 +35,8 @@ private:
     sensor_msgs::PointCloud2::Ptr                      map_ndt_means_;
     sensor_msgs::PointCloud2::Ptr                      map_occ_ndt_means_;
 
-    cslibs_ndt_3d::DistributionArray::Ptr              map_ndt_distributions_;
-    cslibs_ndt_3d::DistributionArray::Ptr              map_occ_ndt_distributions_;
+    DistributionPublisher<dynamic_maps::Gridmap>::Ptr          pub_ndt_distributions_;
+    DistributionPublisher<dynamic_maps::OccupancyGridmap>::Ptr pub_occ_ndt_distributions_;
 
     bool setup();
 
@@ -115,6 +115,10 @@ void NDTDisplay::processMessage(const DistributionArray::ConstPtr &msg)
     if (!accumulate_)
         visuals_.clear();
 
+    /// incremental updates only carry changed distributions and those removed
+    for (const uint64_t id : msg->removed)
+        visuals_.erase(id);
+
     for(const auto &d : msg->data) {
         const Ogre::Vector3 &p    = getTranslation(d);
         const Ogre::Quaternion &q = getRotation(d);
@@ -129,6 +133,8 @@ void NDTDisplay::processMessage(const DistributionArray::ConstPtr &msg)
             v->setScale(s);
             v->setColorScale(static_cast<float>(0.5 + 0.5 * d.prob.data));
             v->setColor(color_);
+        } else {
+            visuals_.erase(d.id.data);
         }
     }
 }
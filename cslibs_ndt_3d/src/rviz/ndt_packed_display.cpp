@@ -0,0 +1,162 @@
+#include "ndt_packed_display.h"
+
+#include "ndt_ellipsoid.h"
+#include "ndt_mesh.h"
+
+#include <OGRE/OgreSceneNode.h>
+#include <OGRE/OgreSceneManager.h>
+
+#include <rviz/visualization_manager.h>
+#include <rviz/properties/color_property.h>
+#include <rviz/properties/float_property.h>
+#include <rviz/properties/int_property.h>
+#include <rviz/properties/bool_property.h>
+#include <rviz/frame_manager.h>
+
+#include <cslibs_ndt_3d/conversion/packed_distributions.hpp>
+
+#include <Eigen/Geometry>
+
+namespace cslibs_ndt_3d {
+PackedNDTDisplay::PackedNDTDisplay() :
+    accumulate_(true)
+{
+    color_property_ = new rviz::ColorProperty("Color", QColor(204, 51, 204),
+                                              "Color to draw the acceleration arrows.",
+                                              this, SLOT(updateColorAndAlpha()));
+    alpha_property_ = new rviz::FloatProperty("Alpha", 1.0,
+                                              "0 is fully transparent, 1.0 is fully opaque.",
+                                              this, SLOT(updateColorAndAlpha()));
+    bool_property_ = new rviz::BoolProperty("Accumulate", true,
+                                            "Accumulate all received updates to one NDT map.",
+                                            this, SLOT(updateAccumulation()));
+}
+
+PackedNDTDisplay::~PackedNDTDisplay()
+{
+}
+
+void PackedNDTDisplay::onInitialize()
+{
+    MFDClass::onInitialize();
+}
+
+void PackedNDTDisplay::reset()
+{
+    MFDClass::reset();
+    visuals_.clear();
+}
+
+void PackedNDTDisplay::updateColorAndAlpha()
+{
+    const Ogre::ColourValue color = color_property_->getOgreColor();
+
+    color_[0] = alpha_property_->getFloat();
+    color_[1] = color.r;
+    color_[2] = color.g;
+    color_[3] = color.b;
+    for (auto &v : visuals_)
+        v.second->setColor(color_);
+}
+
+void PackedNDTDisplay::updateAccumulation()
+{
+    accumulate_ = bool_property_->getBool();
+    if (!accumulate_)
+        visuals_.clear();
+}
+
+void PackedNDTDisplay::processMessage(const PackedDistributionArray::ConstPtr &msg)
+{
+    /// get the map frame
+    Ogre::Quaternion frame_orientation;
+    Ogre::Vector3 frame_position;
+
+    if (!context_->getFrameManager()->getTransform(msg->header.frame_id,
+                                                   msg->header.stamp,
+                                                   frame_position,
+                                                   frame_orientation)) {
+        ROS_DEBUG("Error transforming from frame '%s' to frame '%s'",
+                  msg->header.frame_id.c_str(), qPrintable(fixed_frame_));
+        return;
+    }
+
+    const std::size_t n = msg->id.size();
+    if (msg->prob.size() != n || msg->mean.size() != 3 * n ||
+            (msg->covariance.size() != 6 * n &&
+             (msg->covariance_scale.size() != n || msg->covariance_quantised.size() != 6 * n))) {
+        ROS_ERROR("Packed distribution array with inconsistent array sizes.");
+        return;
+    }
+
+    /// the eigen decomposition is not part of the message
+    using decomposition_t = conversion::EigenDecomposition;
+    std::vector<decomposition_t::matrix_t>  covariances(n);
+    std::vector<decomposition_t::values_t>  eigen_values(n);
+    std::vector<decomposition_t::vectors_t> eigen_vectors(n);
+    for (std::size_t i = 0 ; i < n ; ++ i)
+        covariances[i] = conversion::getCovariance(*msg, i);
+    decomposition_t::apply(n, covariances.data(), eigen_values.data(), eigen_vectors.data());
+
+    auto valid = [](const Ogre::Vector3    &position,
+                    const Ogre::Quaternion &orientation,
+                    const Ogre::Vector3    &scale) {
+        /// axis aligned distributions have zero quaternion and mean components
+        const bool p = std::isfinite(position.x) && std::isfinite(position.y) && std::isfinite(position.z);
+        const bool o = std::isfinite(orientation.x) && std::isfinite(orientation.y) &&
+                       std::isfinite(orientation.z) && std::isfinite(orientation.w);
+        const bool s = std::isnormal(scale.x) && std::isnormal(scale.y) && std::isnormal(scale.z);
+        return p && o && s;
+    };
+
+    auto getRotation = [&frame_orientation](const Eigen::Quaterniond &q) {
+        return frame_orientation * Ogre::Quaternion(static_cast<float>(q.w()),
+                                                    static_cast<float>(q.x()),
+                                                    static_cast<float>(q.y()),
+                                                    static_cast<float>(q.z()));
+    };
+    auto getTranslation = [&frame_orientation, &frame_position, &msg](const std::size_t i) {
+        return frame_orientation * Ogre::Vector3(msg->mean[3 * i],
+                                                 msg->mean[3 * i + 1],
+                                                 msg->mean[3 * i + 2]) + frame_position;
+    };
+    auto getScale = [](const Eigen::Vector3d &axes) {
+        return Ogre::Vector3(static_cast<float>(3.0 * axes(0)),
+                             static_cast<float>(3.0 * axes(1)),
+                             static_cast<float>(3.0 * axes(2)));
+    };
+
+    if (!accumulate_)
+        visuals_.clear();
+
+    /// incremental updates only carry changed distributions and those removed
+    for (const uint64_t id : msg->removed)
+        visuals_.erase(id);
+
+    for (std::size_t i = 0 ; i < n ; ++ i) {
+        Eigen::Vector3d    axes;
+        Eigen::Quaterniond orientation;
+        conversion::getEllipsoid(eigen_values[i], eigen_vectors[i], axes, orientation);
+
+        const Ogre::Vector3 &p    = getTranslation(i);
+        const Ogre::Quaternion &q = getRotation(orientation);
+        const Ogre::Vector3 &s    = getScale(axes);
+
+        if (valid(p,q,s) && std::isnormal(msg->prob[i])) {
+            NDTVisual::Ptr &v = visuals_[msg->id[i]];
+            if (!v)
+                v.reset(new NDTEllipsoid(context_->getSceneManager(), scene_node_));
+            v->setFramePosition(p);
+            v->setFrameOrientation(q);
+            v->setScale(s);
+            v->setColorScale(0.5f + 0.5f * msg->prob[i]);
+            v->setColor(color_);
+        } else {
+            visuals_.erase(msg->id[i]);
+        }
+    }
+}
+}
+
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_EXPORT_CLASS(cslibs_ndt_3d::PackedNDTDisplay, rviz::Display)
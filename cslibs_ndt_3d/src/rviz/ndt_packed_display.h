@@ -0,0 +1,59 @@
+#ifndef CSLIBS_NDT_3D_PACKED_DISPLAY_H
+#define CSLIBS_NDT_3D_PACKED_DISPLAY_H
+
+#ifndef Q_MOC_RUN
+#include <rviz/message_filter_display.h>
+
+#include <cslibs_ndt_3d/PackedDistributionArray.h>
+#endif
+
+#include <map>
+#include <unordered_map>
+
+namespace Ogre
+{
+class SceneNode;
+}
+
+namespace rviz
+{
+class ColorProperty;
+class FloatProperty;
+class IntProperty;
+class BoolProperty;
+}
+
+
+namespace cslibs_ndt_3d {
+class NDTVisual;
+
+class PackedNDTDisplay : public rviz::MessageFilterDisplay<PackedDistributionArray>
+{
+    Q_OBJECT
+public:
+    PackedNDTDisplay();
+    virtual ~PackedNDTDisplay();
+
+protected:
+    virtual void onInitialize();
+    virtual void reset();
+
+private Q_SLOTS:
+    void updateColorAndAlpha();
+    void updateAccumulation();
+
+private:
+    void processMessage(const PackedDistributionArray::ConstPtr &msg);
+
+    bool accumulate_;
+    std::map<uint64_t, std::shared_ptr<NDTVisual>> visuals_;
+
+    std::array<float,4> color_;
+
+    rviz::ColorProperty* color_property_;
+    rviz::FloatProperty* alpha_property_;
+    rviz::BoolProperty*  bool_property_;
+};
+}
+
+#endif // CSLIBS_NDT_3D_PACKED_DISPLAY_H
@@ -0,0 +1,73 @@
+#include <chrono>
+#include <iostream>
+#include <functional>
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t NUM_POINTS     = 100000;
+const std::size_t NUM_ITERATIONS = 5;
+const double      RESOLUTION     = 0.5;
+const double      EXTENT         = 50.0;
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math::linear::Pointcloud<point_t>;
+
+double measure(const std::function<void()> &fn)
+{
+    double ms = 0.0;
+    for (std::size_t i = 0 ; i < NUM_ITERATIONS ; ++ i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return ms / NUM_ITERATIONS;
+}
+
+template <typename map_t>
+void run(const std::string &name,
+         const typename pointcloud_t::Ptr &points)
+{
+    const cslibs_math_3d::Pose3d origin;
+
+    std::cout << "[" << name << "]: " << NUM_POINTS << " points, mean of " << NUM_ITERATIONS << " runs\n";
+    std::cout << "  add    " << measure([&points]() {
+        typename map_t::Ptr map(new map_t(cslibs_math_3d::Pose3d(), RESOLUTION));
+        for (const point_t &p : *points)
+            map->add(p);
+    }) << "ms\n";
+    std::cout << "  insert " << measure([&points, &origin]() {
+        typename map_t::Ptr map(new map_t(cslibs_math_3d::Pose3d(), RESOLUTION));
+        map->insert(origin, points);
+    }) << "ms\n";
+
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Pose3d(), RESOLUTION));
+    map->insert(origin, points);
+    volatile double sample = 0.0;
+    std::cout << "  sample " << measure([&points, &map, &sample]() {
+        for (const point_t &p : *points)
+            sample = map->sample(p);
+    }) << "ms\n";
+    std::cout << "  traverse " << measure([&map, &sample]() {
+        map->traverse([&sample](const typename map_t::index_t &, const typename map_t::distribution_bundle_t &b) {
+            for (std::size_t i = 0 ; i < 8 ; ++ i)
+                sample = sample + b.at(i)->getHandle()->data().getN();
+        });
+    }) << "ms\n";
+}
+
+int main()
+{
+    cslibs_math::random::Uniform<1> rng(-0.5 * EXTENT, 0.5 * EXTENT);
+
+    typename pointcloud_t::Ptr points(new pointcloud_t);
+    for (std::size_t i = 0 ; i < NUM_POINTS ; ++ i)
+        points->insert(point_t(rng.get(), rng.get(), rng.get()));
+
+    run<cslibs_ndt_3d::dynamic_maps::Gridmap>("KDTree", points);
+    run<cslibs_ndt_3d::dynamic_maps::HashGridmap>("Hash", points);
+    run<cslibs_ndt_3d::dynamic_maps::MortonGridmap>("Morton", points);
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <chrono>
+#include <iostream>
+#include <functional>
+
+#include <cslibs_ndt_3d/conversion/gridmap.hpp>
+#include <cslibs_ndt_3d/conversion/eigen_decomposition.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+#include <Eigen/Eigenvalues>
+
+const std::size_t NUM_POINTS     = 500000;
+const std::size_t NUM_ITERATIONS = 3;
+const double      RESOLUTION     = 0.5;
+const double      EXTENT         = 30.0;
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math::linear::Pointcloud<point_t>;
+using dynamic_t    = cslibs_ndt_3d::dynamic_maps::Gridmap;
+using static_t     = cslibs_ndt_3d::static_maps::Gridmap;
+using index_t      = std::array<int, 3>;
+
+double measure(const std::function<void()> &fn)
+{
+    double ms = 0.0;
+    for (std::size_t i = 0 ; i < NUM_ITERATIONS ; ++ i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return ms / NUM_ITERATIONS;
+}
+
+/// reference implementations allocating every bundle through the destination, as the conversions did before
+static_t::Ptr fromPerBundle(const dynamic_t::Ptr &src)
+{
+    const index_t min_bi = src->getMinDistributionIndex();
+    const std::array<std::size_t, 3> size =
+    {{static_cast<std::size_t>(std::ceil((src->getMax()(0) - src->getMin()(0)) / src->getResolution())),
+      static_cast<std::size_t>(std::ceil((src->getMax()(1) - src->getMin()(1)) / src->getResolution())),
+      static_cast<std::size_t>(std::ceil((src->getMax()(2) - src->getMin()(2)) / src->getResolution()))}};
+
+    static_t::Ptr dst(new static_t(src->getOrigin(), src->getResolution(), size));
+    src->traverse([&dst, &min_bi](const index_t &bi, const dynamic_t::distribution_bundle_t &b) {
+        const index_t bi_dst = {{bi[0] - min_bi[0], bi[1] - min_bi[1], bi[2] - min_bi[2]}};
+        if (static_t::distribution_bundle_t *b_dst = dst->getDistributionBundle(bi_dst))
+            for (std::size_t i = 0 ; i < 8 ; ++ i) {
+                const auto &data = b.at(i)->getHandle()->data();
+                if (data.getN() > 0 && b_dst->at(i)->data().getN() == 0)
+                    b_dst->at(i)->data() = data;
+            }
+    });
+    return dst;
+}
+
+dynamic_t::Ptr fromPerBundle(const static_t::Ptr &src)
+{
+    dynamic_t::Ptr dst(new dynamic_t(src->getOrigin(), src->getResolution()));
+    src->traverse([&dst](const index_t &bi, const static_t::distribution_bundle_t &b) {
+        if (dynamic_t::distribution_bundle_t *b_dst = dst->getDistributionBundle(bi))
+            for (std::size_t i = 0 ; i < 8 ; ++ i) {
+                const auto &data = b.at(i)->getHandle()->data();
+                if (data.getN() > 0 && b_dst->at(i)->data().getN() == 0)
+                    b_dst->at(i)->data() = data;
+            }
+    });
+    return dst;
+}
+
+int main()
+{
+    cslibs_math::random::Uniform<1> rng(-0.5 * EXTENT, 0.5 * EXTENT);
+
+    typename pointcloud_t::Ptr points(new pointcloud_t);
+    for (std::size_t i = 0 ; i < NUM_POINTS ; ++ i)
+        points->insert(point_t(rng.get(), rng.get(), rng.get()));
+
+    dynamic_t::Ptr map_dynamic(new dynamic_t(cslibs_math_3d::Pose3d(), RESOLUTION));
+    map_dynamic->insert(cslibs_math_3d::Pose3d(), points);
+
+    /// eigen decomposition of the merged bundles, released before the conversions
+    {
+        using decomposition_t = cslibs_ndt_3d::conversion::EigenDecomposition;
+        std::vector<decomposition_t::matrix_t> covariances;
+        map_dynamic->traverse([&covariances](const index_t &, const dynamic_t::distribution_bundle_t &b) {
+            cslibs_math::statistics::Distribution<3, 3> d;
+            for (std::size_t i = 0 ; i < 8 ; ++ i)
+                d += b.at(i)->getHandle()->data();
+            covariances.emplace_back(d.getCovariance());
+        });
+        std::vector<decomposition_t::values_t>  values(covariances.size());
+        std::vector<decomposition_t::vectors_t> vectors(covariances.size());
+
+        std::cout << "[Eigen decomposition]: " << covariances.size() << " covariances, mean of " << NUM_ITERATIONS << " runs\n";
+        std::cout << "  self adjoint solver            " << measure([&covariances, &values, &vectors]() {
+            for (std::size_t i = 0 ; i < covariances.size() ; ++ i) {
+                const Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariances[i]);
+                values[i]  = solver.eigenvalues();
+                vectors[i] = solver.eigenvectors();
+            }
+        }) << "ms\n";
+        std::cout << "  batched closed form            " << measure([&covariances, &values, &vectors]() {
+            decomposition_t::apply(covariances.size(), covariances.data(), values.data(), vectors.data());
+        }) << "ms\n";
+    }
+
+    const static_t::Ptr map_static = cslibs_ndt_3d::conversion::from(map_dynamic);
+
+    std::size_t cells = 0;
+    for (const auto &s : map_dynamic->getStorages())
+        cells += s->size();
+
+    std::cout << "[Conversion]: " << cells << " cells, mean of " << NUM_ITERATIONS << " runs\n";
+    std::cout << "  dynamic to static, per bundle  " << measure([&map_dynamic]() {
+        fromPerBundle(map_dynamic);
+    }) << "ms\n";
+    std::cout << "  dynamic to static, per storage " << measure([&map_dynamic]() {
+        cslibs_ndt_3d::conversion::from(map_dynamic);
+    }) << "ms\n";
+    std::cout << "  static to dynamic, per bundle  " << measure([&map_static]() {
+        fromPerBundle(map_static);
+    }) << "ms\n";
+    std::cout << "  static to dynamic, per storage " << measure([&map_static]() {
+        cslibs_ndt_3d::conversion::from(map_static);
+    }) << "ms\n";
+
+    return 0;
+}
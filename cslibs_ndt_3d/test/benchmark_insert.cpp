@@ -0,0 +1,171 @@
+#include <chrono>
+#include <iostream>
+#include <functional>
+
+#include <cslibs_ndt_3d/static_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt/common/point_indexer.hpp>
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t NUM_POINTS     = 100000;
+const std::size_t NUM_ITERATIONS = 5;
+const double      RESOLUTION     = 0.5;
+const std::size_t SIZE           = 50;
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math::linear::Pointcloud<point_t>;
+
+/// reference implementations accumulating into a temporary kd-tree, as insert did before
+class Gridmap : public cslibs_ndt_3d::static_maps::Gridmap
+{
+public:
+    using cslibs_ndt_3d::static_maps::Gridmap::Gridmap;
+    using kd_storage_t = cis::Storage<distribution_t, index_t, cis::backend::kdtree::KDTree>;
+
+    inline void insertKDTree(const pose_t &origin,
+                             const typename pointcloud_t::Ptr &points)
+    {
+        kd_storage_t storage;
+        for (const auto &p : *points) {
+            const point_t pm = origin * p;
+            if (pm.isNormal()) {
+                const index_t &bi = toBundleIndex(pm);
+                distribution_t *d = storage.get(bi);
+                (d ? d : &storage.insert(bi, distribution_t()))->data().add(pm);
+            }
+        }
+
+        storage.traverse([this](const index_t& bi, const distribution_t &d) {
+            distribution_bundle_t *bundle = getAllocate(bi);
+            for (std::size_t i = 0 ; i < 8 ; ++ i)
+                bundle->at(i)->getHandle()->data() += d.data();
+        });
+    }
+};
+
+class OccupancyGridmap : public cslibs_ndt_3d::static_maps::OccupancyGridmap
+{
+public:
+    using cslibs_ndt_3d::static_maps::OccupancyGridmap::OccupancyGridmap;
+    using kd_storage_t = cis::Storage<distribution_t, index_t, cis::backend::kdtree::KDTree>;
+
+    inline void insertKDTree(const pose_t &origin,
+                             const typename pointcloud_t::Ptr &points)
+    {
+        kd_storage_t storage;
+        for (const auto &p : *points) {
+            const point_t pm = origin * p;
+            if (pm.isNormal()) {
+                const index_t &bi = toBundleIndex(pm);
+                distribution_t *d = storage.get(bi);
+                (d ? d : &storage.insert(bi, distribution_t()))->updateOccupied(pm);
+            }
+        }
+
+        const point_t start_p = m_T_w_ * origin.translation();
+        storage.traverse([this, &start_p](const index_t& bi, const distribution_t &d) {
+            if (!d.getDistribution())
+                return;
+            updateOccupied(bi, d.getDistribution());
+
+            simple_iterator_t it(start_p, m_T_w_ * point_t(d.getDistribution()->getMean()), bundle_resolution_);
+            const std::size_t n = d.numOccupied();
+            while (!it.done()) {
+                updateFree({{it.x(), it.y(), it.z()}}, n);
+                ++ it;
+            }
+        });
+    }
+};
+
+double measure(const std::function<void()> &fn)
+{
+    double ms = 0.0;
+    for (std::size_t i = 0 ; i < NUM_ITERATIONS ; ++ i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return ms / NUM_ITERATIONS;
+}
+
+template <typename map_t>
+double measure(const std::function<void(std::shared_ptr<map_t> &)> &fn)
+{
+    double ms = 0.0;
+    for (std::size_t i = 0 ; i < NUM_ITERATIONS ; ++ i) {
+        std::shared_ptr<map_t> map(new map_t(cslibs_math_3d::Pose3d(), RESOLUTION, {{SIZE, SIZE, SIZE}}));
+        const auto start = std::chrono::steady_clock::now();
+        fn(map);
+        ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return ms / NUM_ITERATIONS;
+}
+
+int main()
+{
+    const double extent = SIZE * RESOLUTION;
+    cslibs_math::random::Uniform<1> rng(0.0, extent);
+
+    typename pointcloud_t::Ptr points(new pointcloud_t);
+    for (std::size_t i = 0 ; i < NUM_POINTS ; ++ i)
+        points->insert(point_t(rng.get(), rng.get(), rng.get()));
+
+    const cslibs_math_3d::Pose3d origin(0.5 * extent, 0.5 * extent, 0.5 * extent);
+    typename pointcloud_t::Ptr points_local(new pointcloud_t);
+    for (const point_t &p : *points)
+        points_local->insert(origin.inverse() * p);
+
+    const cslibs_math_3d::Transform3d m_T_w = cslibs_math_3d::Pose3d().inverse();
+    const double bundle_resolution_inv = 2.0 / RESOLUTION;
+    long checksum = 0;
+    std::cout << "[Indexing]: " << NUM_POINTS << " points, mean of " << NUM_ITERATIONS << " runs\n";
+    std::cout << "  scalar       " << measure([&]() {
+        for (const point_t &p : *points_local) {
+            const point_t pm = origin * p;
+            if (pm.isNormal()) {
+                const point_t p_m = m_T_w * pm;
+                checksum += static_cast<int>(std::floor(p_m(0) * bundle_resolution_inv)) +
+                            static_cast<int>(std::floor(p_m(1) * bundle_resolution_inv)) +
+                            static_cast<int>(std::floor(p_m(2) * bundle_resolution_inv));
+            }
+        }
+    }) << "ms\n";
+    std::cout << "  blocks       " << measure([&]() {
+        const cslibs_ndt::PointIndexer<3, cslibs_math_3d::Pose3d, cslibs_math_3d::Transform3d> indexer(origin, m_T_w, bundle_resolution_inv);
+        indexer.apply(*points_local, [&checksum](const point_t &, const std::array<int, 3> &bi) {
+            checksum -= bi[0] + bi[1] + bi[2];
+        });
+    }) << "ms\n";
+    if (checksum != 0)
+        std::cerr << "[Indexing]: index mismatch!\n";
+
+    std::cout << "[Gridmap]: " << NUM_POINTS << " points, mean of " << NUM_ITERATIONS << " runs\n";
+    std::cout << "  add          " << measure<Gridmap>([&points](std::shared_ptr<Gridmap> &map) {
+        for (const point_t &p : *points)
+            map->add(p);
+    }) << "ms\n";
+    std::cout << "  kd-tree      " << measure<Gridmap>([&points_local, &origin](std::shared_ptr<Gridmap> &map) {
+        map->insertKDTree(origin, points_local);
+    }) << "ms\n";
+    std::cout << "  sort & merge " << measure<Gridmap>([&points_local, &origin](std::shared_ptr<Gridmap> &map) {
+        map->insert(origin, points_local);
+    }) << "ms\n";
+    {
+        std::shared_ptr<Gridmap> map(new Gridmap(cslibs_math_3d::Pose3d(), RESOLUTION, {{SIZE, SIZE, SIZE}}));
+        std::cout << "  memory       " << map->getByteSize() / 1024 << "kB empty, ";
+        map->insert(origin, points_local);
+        std::cout << map->getByteSize() / 1024 << "kB filled\n";
+    }
+
+    std::cout << "[OccupancyGridmap]: " << NUM_POINTS << " points, mean of " << NUM_ITERATIONS << " runs\n";
+    std::cout << "  kd-tree      " << measure<OccupancyGridmap>([&points_local, &origin](std::shared_ptr<OccupancyGridmap> &map) {
+        map->insertKDTree(origin, points_local);
+    }) << "ms\n";
+    std::cout << "  sort & merge " << measure<OccupancyGridmap>([&points_local, &origin](std::shared_ptr<OccupancyGridmap> &map) {
+        map->insert(origin, points_local);
+    }) << "ms\n";
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/conversion/distance_field.hpp>
+#include <cslibs_ndt_3d/conversion/probability_gridmap.hpp>
+#include <cslibs_ndt_3d/conversion/elevation_map.hpp>
+#include <cslibs_ndt_3d/conversion/eigen_decomposition.hpp>
+#include <cslibs_ndt_3d/conversion/packed_distributions.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t MAX_NUM_SAMPLES = 100;
+
+template <std::size_t Dim>
+using rng_t = typename cslibs_math::random::Uniform<Dim>;
+
+TEST(Test_cslibs_ndt_3d, testDynamicGridmapDistanceField)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    rng_t<1> rng_offset(-0.05, 0.05);
+
+    // two tight clusters in opposite corners, centered on voxels
+    const cslibs_math_3d::Point3d a(0.25, 0.25, 0.25);
+    const cslibs_math_3d::Point3d b(3.75, 3.75, 3.75);
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    for (std::size_t i = 0 ; i < 100 ; ++ i) {
+        const cslibs_math_3d::Point3d o(rng_offset.get(), rng_offset.get(), rng_offset.get());
+        map->add(a + o);
+        map->add(b + o);
+    }
+
+    cslibs_ndt_3d::conversion::DistanceField::Ptr field;
+    cslibs_ndt_3d::conversion::from(map, field, 0.125, 3.0, 0.169, true);
+    ASSERT_NE(field, nullptr);
+    EXPECT_EQ(field->getSize()[0], static_cast<std::size_t>(std::round(map->getWidth() / 0.125)));
+
+    const cslibs_math_3d::Point3d p(1.3, 1.0, 0.7);
+    const cslibs_math_3d::Point3d v = p - a;
+    EXPECT_NEAR(field->distance(p), v.length(), 0.1);
+    EXPECT_LT(field->distance(a), 0.0);
+    EXPECT_NEAR(field->distance(cslibs_math_3d::Point3d(10.0, 0.0, 0.0)), 3.0, 1e-9);
+
+    // the gradient points away from the closest obstacle
+    const cslibs_math_3d::Point3d g = field->gradient(p);
+    EXPECT_GT(g.data().dot(v.data()) / (g.length() * v.length()), 0.95);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicGridmapProjection)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    rng_t<1> rng_wall(0.0, 4.0);
+    rng_t<1> rng_noise(-0.02, 0.02);
+
+    // a wall at x = 2 below and a ceiling patch above the band
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    for (std::size_t i = 0 ; i < 50 * MAX_NUM_SAMPLES ; ++ i)
+        map->add(cslibs_math_3d::Point3d(2.0 + rng_noise.get(), rng_wall.get(), 0.5 * rng_wall.get()));
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i)
+        map->add(cslibs_math_3d::Point3d(0.75 + 5.0 * rng_noise.get(), 0.75 + 5.0 * rng_noise.get(), 3.5 + rng_noise.get()));
+
+    cslibs_gridmaps::static_maps::ProbabilityGridmap::Ptr grid;
+    cslibs_ndt_3d::conversion::from(map, grid, 0.125, 0.0, 2.0);
+    ASSERT_NE(grid, nullptr);
+
+    auto at = [&grid](const double x, const double y) {
+        return grid->at(static_cast<std::size_t>(std::round((x - grid->getOrigin().tx()) / 0.125)),
+                        static_cast<std::size_t>(std::round((y - grid->getOrigin().ty()) / 0.125)));
+    };
+    EXPECT_GT(at(2.0, 2.0), 0.3);
+    EXPECT_LT(at(0.75, 0.75), 0.05);
+
+    // a new obstacle inside the band is picked up by updating its column only
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i)
+        map->add(cslibs_math_3d::Point3d(0.75 + 5.0 * rng_noise.get(), 3.25 + 5.0 * rng_noise.get(), 1.0 + 5.0 * rng_noise.get()));
+    const double before = at(0.75, 3.25);
+    cslibs_ndt_3d::conversion::from(map, grid, 0.125, 0.0, 2.0, {{{{1, 6}}}});
+    EXPECT_LT(before, 0.05);
+    EXPECT_GT(at(0.75, 3.25), 0.3);
+
+    cslibs_gridmaps::static_maps::ProbabilityGridmap::Ptr full;
+    cslibs_ndt_3d::conversion::from(map, full, 0.125, 0.0, 2.0);
+    EXPECT_NEAR(at(0.75, 3.25), full->at(static_cast<std::size_t>(std::round((0.75 - full->getOrigin().tx()) / 0.125)),
+                                         static_cast<std::size_t>(std::round((3.25 - full->getOrigin().ty()) / 0.125))), 1e-9);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicGridmapElevationMap)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    rng_t<1> rng_coord(0.0, 4.0);
+    rng_t<1> rng_noise(-0.01, 0.01);
+
+    // a ramp rising by 0.3 per meter along x
+    // column {{4, 4}} is topped by bundle {{4, 4, 2}}, whose cell spans [2, 3) x [2, 3) x [1, 2)
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    std::size_t n_cell = 0;
+    for (std::size_t i = 0 ; i < 100 * MAX_NUM_SAMPLES ; ++ i) {
+        const double x = rng_coord.get();
+        const double y = rng_coord.get();
+        map->add(cslibs_math_3d::Point3d(x, y, 0.5 + 0.3 * x + rng_noise.get()));
+        if (x >= 2.0 && x < 3.0 && y >= 2.0 && y < 3.0)
+            ++ n_cell;
+    }
+
+    cslibs_ndt_3d::conversion::ElevationMap::Ptr elevation;
+    cslibs_ndt_3d::conversion::from(map, elevation);
+    ASSERT_NE(elevation, nullptr);
+
+    const cslibs_ndt_3d::conversion::ElevationMap::column_t c = {{4, 4}};
+    const cslibs_ndt_3d::conversion::ElevationMap::cell_t *cell = elevation->get(c);
+    ASSERT_NE(cell, nullptr);
+    EXPECT_EQ(cell->n, n_cell);
+    EXPECT_NEAR(cell->height, 0.5 + 0.3 * 2.5, 0.02);
+    EXPECT_NEAR(cell->slope, std::atan(0.3), 0.05);
+    EXPECT_LT(cell->roughness, 0.02);
+
+    // the region around a point yields the same cells
+    cslibs_ndt_3d::conversion::ElevationMap::Ptr local;
+    cslibs_ndt_3d::conversion::from(map, local, cslibs_math_3d::Point3d(2.25, 2.25, 0.0), 0.6);
+    ASSERT_NE(local, nullptr);
+    EXPECT_EQ(local->getWidth(), 3ul);
+    ASSERT_NE(local->get(c), nullptr);
+    EXPECT_EQ(local->get(c)->n, cell->n);
+    EXPECT_FLOAT_EQ(local->get(c)->height, cell->height);
+
+    // columns whose top cell holds fewer samples fall back to the next lower bundle
+    const cslibs_math_3d::Point3d p(2.25, 2.25, 3.25);
+    for (std::size_t i = 0 ; i < 2 ; ++ i)
+        map->add(p);
+    cslibs_ndt_3d::conversion::from(map, elevation, n_cell);
+    ASSERT_NE(elevation, nullptr);
+    ASSERT_NE(elevation->get(c), nullptr);
+    EXPECT_EQ(elevation->get(c)->n, n_cell);
+    cslibs_ndt_3d::conversion::from(map, elevation, n_cell + 1);
+    ASSERT_NE(elevation, nullptr);
+    ASSERT_NE(elevation->get(c), nullptr);
+    EXPECT_EQ(elevation->get(c)->n, 0ul);
+}
+
+TEST(Test_cslibs_ndt_3d, testEigenDecomposition)
+{
+    using decomposition_t = cslibs_ndt_3d::conversion::EigenDecomposition;
+    rng_t<1> rng_angle(-M_PI, M_PI);
+    rng_t<1> rng_value(1e-4, 1.0);
+
+    // random covariances including repeated, zero and isotropic spectra
+    std::vector<decomposition_t::matrix_t> covariances;
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i) {
+        const Eigen::Matrix3d r = (Eigen::AngleAxisd(rng_angle.get(), Eigen::Vector3d::UnitZ()) *
+                                   Eigen::AngleAxisd(rng_angle.get(), Eigen::Vector3d::UnitY()) *
+                                   Eigen::AngleAxisd(rng_angle.get(), Eigen::Vector3d::UnitX())).toRotationMatrix();
+        Eigen::Vector3d l(rng_value.get(), rng_value.get(), rng_value.get());
+        if (i % 4 == 1)
+            l(1) = l(0);
+        if (i % 4 == 2)
+            l(0) = 0.0;
+        if (i % 4 == 3)
+            l(2) = l(1) = l(0);
+        covariances.emplace_back(r * l.asDiagonal() * r.transpose());
+    }
+    covariances.emplace_back(decomposition_t::matrix_t::Zero());
+
+    std::vector<decomposition_t::values_t>  values(covariances.size());
+    std::vector<decomposition_t::vectors_t> vectors(covariances.size());
+    decomposition_t::apply(covariances.size(), covariances.data(), values.data(), vectors.data());
+
+    for (std::size_t i = 0 ; i < covariances.size() ; ++ i) {
+        const Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariances[i]);
+        for (std::size_t j = 0 ; j < 3 ; ++ j)
+            EXPECT_NEAR(values[i](j), solver.eigenvalues()(j), 1e-6);
+        EXPECT_NEAR(vectors[i].determinant(), 1.0, 1e-9);
+        EXPECT_LT((vectors[i] * values[i].asDiagonal() * vectors[i].transpose() - covariances[i]).norm(), 1e-6);
+    }
+
+    // single matrices take the same path
+    decomposition_t::values_t  value;
+    decomposition_t::vectors_t vector;
+    decomposition_t::apply(covariances.front(), value, vector);
+    EXPECT_EQ(value, values.front());
+    EXPECT_EQ(vector, vectors.front());
+}
+
+TEST(Test_cslibs_ndt_3d, testPackedDistributionEllipsoids)
+{
+    using map_t           = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    using decomposition_t = cslibs_ndt_3d::conversion::EigenDecomposition;
+    rng_t<1> rng_plane(0.0, 2.0);
+
+    // a flat patch, the quantised covariances have vanishing eigenvalues
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    for (std::size_t i = 0 ; i < 50 * MAX_NUM_SAMPLES ; ++ i)
+        map->add(cslibs_math_3d::Point3d(rng_plane.get(), rng_plane.get(), 1.1));
+
+    cslibs_ndt_3d::PackedDistributionArray::Ptr packed;
+    cslibs_ndt_3d::conversion::from(map, packed, true);
+    ASSERT_NE(packed, nullptr);
+    ASSERT_FALSE(packed->id.empty());
+
+    for (std::size_t i = 0 ; i < packed->id.size() ; ++ i) {
+        const Eigen::Matrix3d c = cslibs_ndt_3d::conversion::getCovariance(*packed, i);
+        decomposition_t::values_t  values;
+        decomposition_t::vectors_t vectors;
+        decomposition_t::apply(c, values, vectors);
+
+        Eigen::Vector3d    axes;
+        Eigen::Quaterniond orientation;
+        cslibs_ndt_3d::conversion::getEllipsoid(values, vectors, axes, orientation);
+        for (std::size_t j = 0 ; j < 3 ; ++ j)
+            EXPECT_TRUE(std::isnormal(axes(j)) && axes(j) > 0.0);
+
+        const Eigen::Matrix3d r = orientation.toRotationMatrix();
+        EXPECT_NEAR(r.determinant(), 1.0, 1e-9);
+        EXPECT_LT((r * values.asDiagonal() * r.transpose() - c).norm(), 1e-6);
+    }
+
+    // reflections are turned into the closest proper rotation
+    Eigen::Vector3d    axes;
+    Eigen::Quaterniond orientation;
+    cslibs_ndt_3d::conversion::getEllipsoid(Eigen::Vector3d(1.0, 0.0, -1e-9),
+                                            Eigen::Vector3d(1.0, 1.0, -1.0).asDiagonal(),
+                                            axes, orientation);
+    EXPECT_TRUE(orientation.toRotationMatrix().isApprox(Eigen::Matrix3d::Identity()));
+    EXPECT_EQ(axes(0), 1.0);
+    EXPECT_GT(axes(1), 0.0);
+    EXPECT_GT(axes(2), 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
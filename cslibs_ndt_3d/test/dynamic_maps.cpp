@@ -0,0 +1,432 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_3d/serialization/dynamic_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t MIN_NUM_SAMPLES = 10;
+const std::size_t MAX_NUM_SAMPLES = 100;
+
+template <std::size_t Dim>
+using rng_t = typename cslibs_math::random::Uniform<Dim>;
+
+cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::Ptr generateDynamicOccMap()
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+    rng_t<1> rng_coord(-10.0, 10.0);
+    rng_t<1> rng_angle(-M_PI, M_PI);
+
+    // fill map
+    cslibs_math_3d::Transform3d origin(cslibs_math_3d::Vector3d(rng_coord.get(), rng_coord.get(), rng_coord.get()),
+                                       cslibs_math_3d::Quaternion(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    const double resolution = rng_t<1>(1.0, 5.0).get();
+    typename map_t::Ptr map(new map_t(origin, resolution));
+    const int num_samples = static_cast<int>(rng_t<1>(MIN_NUM_SAMPLES, MAX_NUM_SAMPLES).get());
+    for (int i = 0 ; i < num_samples ; ++ i) {
+        const cslibs_math_3d::Point3d p(rng_coord.get(), rng_coord.get(), rng_coord.get());
+        const cslibs_math_3d::Point3d q(rng_coord.get(), rng_coord.get(), rng_coord.get());
+        map->add(p, q);
+    }
+
+    return map;
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicOccupancyGridmapSnapshot)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+    const typename map_t::Ptr map = generateDynamicOccMap();
+    const typename map_t::inverse_sensor_model_t::Ptr ivm(new typename map_t::inverse_sensor_model_t(0.5, 0.45, 0.65));
+    rng_t<1> rng_coord(-10.0, 10.0);
+    // cells with a single sample are degenerate and sample to nan
+    auto expect_equal = [](const double a, const double b) {
+        if (std::isnan(a))
+            EXPECT_TRUE(std::isnan(b));
+        else
+            EXPECT_NEAR(a, b, 1e-9);
+    };
+
+    EXPECT_EQ(map->getSnapshot(), nullptr);
+    const typename map_t::snapshot_t::Ptr snapshot = map->updateSnapshot();
+    EXPECT_EQ(map->getSnapshot(), snapshot);
+
+    std::vector<cslibs_math_3d::Point3d> points;
+    std::vector<double> samples;
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i) {
+        points.emplace_back(rng_coord.get(), rng_coord.get(), rng_coord.get());
+        samples.emplace_back(map->sample(points.back(), ivm));
+        expect_equal(samples.back(), snapshot->sample(points.back(), ivm));
+    }
+
+    // writes to the map are not visible in published snapshots
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i)
+        map->add(cslibs_math_3d::Point3d(rng_coord.get(), rng_coord.get(), rng_coord.get()),
+                 cslibs_math_3d::Point3d(rng_coord.get(), rng_coord.get(), rng_coord.get()));
+    const typename map_t::snapshot_t::Ptr updated = map->updateSnapshot();
+    EXPECT_GT(updated->getVersion(), snapshot->getVersion());
+    for (std::size_t i = 0 ; i < points.size() ; ++ i) {
+        expect_equal(samples[i], snapshot->sample(points[i], ivm));
+        expect_equal(map->sample(points[i], ivm), updated->sample(points[i], ivm));
+    }
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicOccupancyGridmapSnapshotCopyOnWrite)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+    const typename map_t::Ptr map = generateDynamicOccMap();
+    const typename map_t::snapshot_t::Ptr snapshot = map->updateSnapshot();
+
+    // statistics of a cell held by the snapshot
+    map_t::index_t bi;
+    map_t::snapshot_t::distribution_ptr_t held;
+    snapshot->traverse([&bi, &held](const map_t::index_t &i, const map_t::snapshot_t::bundle_t &b) {
+        if (!held && b[0].distribution) {
+            bi   = i;
+            held = b[0].distribution;
+        }
+    });
+    ASSERT_NE(held, nullptr);
+    const std::size_t n    = held->getN();
+    const auto        mean = held->getMean();
+
+    // writing the cell again copies the statistics instead of changing them
+    const map_t::distribution_bundle_t *bundle = map->getDistributionBundle(bi);
+    ASSERT_NE(bundle, nullptr);
+    EXPECT_EQ(bundle->at(0)->getHandle()->getDistribution(), held);
+    for (std::size_t i = 0 ; i < MIN_NUM_SAMPLES ; ++ i)
+        map->add(cslibs_math_3d::Point3d(mean), cslibs_math_3d::Point3d(mean));
+    EXPECT_NE(bundle->at(0)->getHandle()->getDistribution(), held);
+    EXPECT_EQ(bundle->at(0)->getHandle()->numOccupied(), n + MIN_NUM_SAMPLES);
+
+    EXPECT_EQ(snapshot->getBundle(bi)->at(0).distribution, held);
+    EXPECT_EQ(held->getN(), n);
+    EXPECT_EQ(held->getMean(), mean);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicGridmapMerge)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    rng_t<1> rng_coord(-10.0, 10.0);
+    rng_t<1> rng_angle(-M_PI, M_PI);
+
+    const cslibs_math_3d::Transform3d origin(cslibs_math_3d::Vector3d(rng_coord.get(), rng_coord.get(), rng_coord.get()),
+                                             cslibs_math_3d::Quaternion(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    const double resolution = rng_t<1>(1.0, 5.0).get();
+    const cslibs_math_3d::Transform3d shift(3 * 0.5 * resolution, -0.5 * resolution, 2 * 0.5 * resolution);
+
+    // grids shifted by whole bundles merge exactly
+    typename map_t::Ptr map(new map_t(origin, resolution));
+    typename map_t::Ptr other(new map_t(origin * shift, resolution));
+    typename map_t::Ptr expected(new map_t(origin, resolution));
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i) {
+        const cslibs_math_3d::Point3d p(rng_coord.get(), rng_coord.get(), rng_coord.get());
+        (i % 2 ? map : other)->add(p);
+        expected->add(p);
+    }
+    map->merge(*other);
+
+    auto count = [](const map_t &m, const std::size_t s) {
+        std::size_t n = 0;
+        m.getStorages()[s]->traverse([&n](const map_t::index_t &, const map_t::distribution_t &d) {
+            n += d.data().getN();
+        });
+        return n;
+    };
+    for (std::size_t s = 0 ; s < 8 ; ++ s) {
+        EXPECT_EQ(count(*expected, s), count(*map, s));
+        expected->getStorages()[s]->traverse([&map, s](const map_t::index_t &c, const map_t::distribution_t &d) {
+            const map_t::distribution_t *m = map->getStorages()[s]->get(c);
+            if (d.data().getN() == 0)
+                return;
+            EXPECT_NE(m, nullptr);
+            if (!m)
+                return;
+            EXPECT_EQ(d.data().getN(), m->data().getN());
+            for (std::size_t j = 0 ; j < 3 ; ++ j)
+                EXPECT_NEAR(d.data().getMean()(j), m->data().getMean()(j), 1e-6);
+        });
+    }
+
+    // otherwise every sample is still counted once per storage
+    const std::size_t before = count(*map, 0);
+    const cslibs_math_3d::Transform3d w_T_o(cslibs_math_3d::Vector3d(rng_coord.get(), rng_coord.get(), rng_coord.get()),
+                                            cslibs_math_3d::Quaternion(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    map->merge(*other, w_T_o);
+    for (std::size_t s = 0 ; s < 8 ; ++ s)
+        EXPECT_EQ(before + count(*other, 0), count(*map, s));
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicOccupancyGridmapContributions)
+{
+    using map_t   = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+    using cloud_t = cslibs_math::linear::Pointcloud<cslibs_math_3d::Point3d>;
+    rng_t<1> rng_coord(-10.0, 10.0);
+    rng_t<1> rng_angle(-M_PI, M_PI);
+    auto random_cloud = [&rng_coord]() {
+        cloud_t::Ptr cloud(new cloud_t);
+        for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i)
+            cloud->insert(cslibs_math_3d::Point3d(rng_coord.get(), rng_coord.get(), rng_coord.get()));
+        return cloud;
+    };
+
+    const cslibs_math_3d::Transform3d origin(cslibs_math_3d::Vector3d(rng_coord.get(), rng_coord.get(), rng_coord.get()),
+                                             cslibs_math_3d::Quaternion(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    const double resolution = rng_t<1>(1.0, 5.0).get();
+    const cslibs_math_3d::Transform3d pose_a(1.0, 2.0, 0.5, 0.1, 0.2, 0.3);
+    const cslibs_math_3d::Transform3d pose_b(-2.0, 1.0, 0.0, 0.0, 0.1, -0.4);
+    // moved by whole bundles along the map axes, so the bundles of the scan stay together
+    const cslibs_math_3d::Transform3d pose_c = origin * cslibs_math_3d::Transform3d(2 * 0.5 * resolution, -0.5 * resolution, 0.0) *
+                                               origin.inverse() * pose_b;
+    const cloud_t::Ptr scan_a = random_cloud();
+    const cloud_t::Ptr scan_b = random_cloud();
+
+    typename map_t::Ptr map(new map_t(origin, resolution));
+    map->insert(pose_a, scan_a);
+    map->insert(pose_b, scan_b, 42);
+    EXPECT_GT(map->getContributionByteSize(), 0ul);
+
+    auto expect_equal = [](const map_t &expected, const map_t &map) {
+        for (std::size_t s = 0 ; s < 8 ; ++ s) {
+            map.getStorages()[s]->traverse([&expected, s](const map_t::index_t &c, const map_t::distribution_t &d) {
+                const map_t::distribution_t *e = expected.getStorages()[s]->get(c);
+                EXPECT_EQ(e ? e->numFree() : 0ul,     d.numFree());
+                EXPECT_EQ(e ? e->numOccupied() : 0ul, d.numOccupied());
+                if (e && e->numOccupied() > 0 && d.numOccupied() > 0) {
+                    for (std::size_t j = 0 ; j < 3 ; ++ j) {
+                        EXPECT_NEAR(e->getDistribution()->getMean()(j), d.getDistribution()->getMean()(j), 1e-6);
+                    }
+                }
+            });
+        }
+    };
+
+    // moving the scan equals inserting it at the corrected pose
+    typename map_t::Ptr moved(new map_t(origin, resolution));
+    moved->insert(pose_a, scan_a);
+    moved->insert(pose_c, scan_b);
+    EXPECT_TRUE(map->reinsert(42, pose_c));
+    expect_equal(*moved, *map);
+
+    // removing it leaves the remaining scans
+    typename map_t::Ptr removed(new map_t(origin, resolution));
+    removed->insert(pose_a, scan_a);
+    EXPECT_TRUE(map->remove(42));
+    EXPECT_FALSE(map->remove(42));
+    expect_equal(*removed, *map);
+    EXPECT_EQ(map->getContributionByteSize(), 0ul);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicOccupancyGridmapDecay)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+    const cslibs_gridmaps::utility::InverseModel::Ptr ivm(new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    const cslibs_math_3d::Point3d start(0.25, 0.25, 0.25);
+    const cslibs_math_3d::Point3d end(2.25, 0.25, 0.25);
+
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    map->setDecayHalfLife(1.0);
+    EXPECT_NEAR(map->getDecayHalfLife(), 1.0, 1e-9);
+
+    const map_t::index_t bi = {{4, 0, 0}};   // bundle of the end point
+
+    auto occupancy = [&map, &ivm, &bi]() {
+        const map_t::distribution_bundle_t *bundle = map->getDistributionBundle(bi);
+        double o = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            o += 0.125 * bundle->at(i)->getHandle()->getOccupancy(ivm);
+        return o;
+    };
+
+    for (std::size_t i = 0 ; i < 5 ; ++ i)
+        map->add(start, end);
+    const double fresh = occupancy();
+    EXPECT_GT(fresh, 0.6);
+
+    // evidence fades towards the prior, the raw counts are kept
+    map->setTime(1.0);
+    EXPECT_LT(occupancy(), fresh);
+    EXPECT_GT(occupancy(), 0.5);
+    map->setTime(20.0);
+    EXPECT_NEAR(occupancy(), 0.5, 1e-3);
+    EXPECT_EQ(map->getDistributionBundle(bi)->at(0)->getHandle()->numOccupied(), 5ul);
+
+    // so a single pass through the now empty space dominates
+    map->add(start, cslibs_math_3d::Point3d(6.25, 0.25, 0.25));
+    EXPECT_LT(occupancy(), 0.5);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicOccupancyGridmapDecayLoaded)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+    const cslibs_gridmaps::utility::InverseModel::Ptr ivm(new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    const cslibs_math_3d::Point3d start(0.25, 0.25, 0.25);
+    const cslibs_math_3d::Point3d end(2.25, 0.25, 0.25);
+    const map_t::index_t bi = {{4, 0, 0}};   // bundle of the end point
+
+    auto occupancy = [&ivm, &bi](const typename map_t::Ptr &map) {
+        const map_t::distribution_bundle_t *bundle = map->getDistributionBundle(bi);
+        double o = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            o += 0.125 * bundle->at(i)->getHandle()->getOccupancy(ivm);
+        return o;
+    };
+
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    for (std::size_t i = 0 ; i < 5 ; ++ i)
+        map->add(start, end);
+    const double fresh = occupancy(map);
+    cslibs_ndt_3d::dynamic_maps::saveBinary(map, "/tmp/dynamic_occ_map_binary_decay_3d");
+
+    typename map_t::Ptr loaded;
+    ASSERT_TRUE(cslibs_ndt_3d::dynamic_maps::loadBinary("/tmp/dynamic_occ_map_binary_decay_3d", loaded));
+
+    // loaded cells carry their evidence and forget it with the loaded map
+    loaded->setDecayHalfLife(1.0);
+    EXPECT_NEAR(occupancy(loaded), fresh, 1e-9);
+    loaded->setTime(1.0);
+    EXPECT_LT(occupancy(loaded), fresh);
+    EXPECT_GT(occupancy(loaded), 0.5);
+    loaded->setTime(20.0);
+    EXPECT_NEAR(occupancy(loaded), 0.5, 1e-3);
+    EXPECT_EQ(loaded->getDistributionBundle(bi)->at(0)->getHandle()->numOccupied(), 5ul);
+
+    // merging a loaded map into a decaying one keeps its occupied evidence
+    ASSERT_TRUE(cslibs_ndt_3d::dynamic_maps::loadBinary("/tmp/dynamic_occ_map_binary_decay_3d", loaded));
+    typename map_t::Ptr merged(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    merged->setDecayHalfLife(1.0);
+    merged->merge(*loaded);
+    EXPECT_NEAR(occupancy(merged), fresh, 1e-9);
+    merged->setTime(20.0);
+    EXPECT_NEAR(occupancy(merged), 0.5, 1e-3);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicOccupancyGridmapDecayMerged)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+    const cslibs_gridmaps::utility::InverseModel::Ptr ivm(new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    const cslibs_math_3d::Point3d start(0.25, 0.25, 0.25);
+    const cslibs_math_3d::Point3d end(2.25, 0.25, 0.25);
+    const map_t::index_t bi = {{4, 0, 0}};   // bundle of the end point
+
+    auto occupancy = [&ivm, &bi](const typename map_t::Ptr &map) {
+        const map_t::distribution_bundle_t *bundle = map->getDistributionBundle(bi);
+        double o = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            o += 0.125 * bundle->at(i)->getHandle()->getOccupancy(ivm);
+        return o;
+    };
+
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    map->setDecayHalfLife(1.0);
+    for (std::size_t i = 0 ; i < 5 ; ++ i)
+        map->add(start, end);
+    const double fresh = occupancy(map);
+    map->setTime(1.0);
+    const double decayed = occupancy(map);
+    EXPECT_LT(decayed, fresh);
+
+    // merged cells carry the decayed evidence, not the raw counts
+    typename map_t::Ptr merged(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    merged->setDecayHalfLife(1.0);
+    merged->setTime(1.0);
+    merged->merge(*map);
+    EXPECT_NEAR(occupancy(merged), decayed, 1e-9);
+    EXPECT_EQ(merged->getDistributionBundle(bi)->at(0)->getHandle()->numOccupied(), 5ul);
+
+    // and keep forgetting it with the merged map
+    map->setTime(2.0);
+    merged->setTime(2.0);
+    EXPECT_NEAR(occupancy(merged), occupancy(map), 1e-9);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicOccupancyGridmapSnapshotDecay)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+    const typename map_t::inverse_sensor_model_t::Ptr ivm(new typename map_t::inverse_sensor_model_t(0.5, 0.45, 0.65));
+    const cslibs_math_3d::Point3d start(0.25, 0.25, 0.25);
+    rng_t<1> rng_coord(2.0, 4.0);
+
+    // end points spread over few cells, so every cell holds a proper distribution
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    map->setDecayHalfLife(1.0);
+    std::vector<cslibs_math_3d::Point3d> points;
+    auto add = [&map, &points, &rng_coord, &start](const std::size_t n) {
+        for (std::size_t i = 0 ; i < n ; ++ i) {
+            points.emplace_back(rng_coord.get(), rng_coord.get(), rng_coord.get());
+            map->add(start, points.back());
+        }
+    };
+    auto expect_equal = [&map, &ivm, &points](const typename map_t::snapshot_t::Ptr &snapshot) {
+        for (const cslibs_math_3d::Point3d &p : points) {
+            const double expected = map->sample(p, ivm);
+            EXPECT_NEAR(expected, snapshot->sample(p, ivm), 1e-9 * std::max(1.0, expected));
+        }
+    };
+    add(10 * MAX_NUM_SAMPLES);
+    const typename map_t::snapshot_t::Ptr fresh = map->updateSnapshot();
+
+    // snapshots sample the decayed occupancy of the map at the time they were taken
+    map->setTime(1.0);
+    const typename map_t::snapshot_t::Ptr decayed = map->updateSnapshot();
+    EXPECT_NEAR(decayed->getDecay().getTime(), 1.0, 1e-9);
+    expect_equal(decayed);
+    EXPECT_LT(decayed->sample(points.front(), ivm), fresh->sample(points.front(), ivm));
+
+    // the clock alone changes no cell, the next snapshot still follows the map
+    map->setTime(2.0);
+    const typename map_t::snapshot_t::Ptr later = map->updateSnapshot();
+    expect_equal(later);
+    EXPECT_LT(later->sample(points.front(), ivm), decayed->sample(points.front(), ivm));
+    EXPECT_NEAR(decayed->getDecay().getTime(), 1.0, 1e-9);
+
+    // cells written since carry new stamps next to the ones left untouched
+    rng_coord = rng_t<1>(2.0, 3.0);
+    add(MAX_NUM_SAMPLES);
+    map->setTime(3.0);
+    expect_equal(map->updateSnapshot());
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicGridmapChangeTracking)
+{
+    using map_t   = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    using index_t = std::array<int, 3>;
+    map_t::Ptr map(new map_t(cslibs_math_3d::Pose3d(), 1.0));
+    map->add(cslibs_math_3d::Point3d(0.25, 0.25, 0.25));
+
+    // the first take returns all bundles and starts tracking
+    std::vector<index_t> all, changed;
+    map->getBundleIndices(all);
+    map->takeChangedBundleIndices(changed);
+    EXPECT_EQ(changed.size(), all.size());
+
+    changed.clear();
+    map->takeChangedBundleIndices(changed);
+    EXPECT_TRUE(changed.empty());
+
+    // a changed bundle comes with its neighbours, as they share its cells
+    map->add(cslibs_math_3d::Point3d(10.25, 10.25, 10.25));
+    changed.clear();
+    map->takeChangedBundleIndices(changed);
+    EXPECT_EQ(changed.size(), 27ul);
+
+    std::vector<index_t> added;
+    map->getBundleIndices(added);
+    for (const index_t &bi : added) {
+        EXPECT_NE(map->findDistributionBundle(bi), nullptr);
+        if (std::find(all.begin(), all.end(), bi) == all.end()) {
+            EXPECT_NE(std::find(changed.begin(), changed.end(), bi), changed.end());
+        }
+    }
+    EXPECT_EQ(map->findDistributionBundle({{1000, 0, 0}}), nullptr);
+
+    changed.clear();
+    map->takeChangedBundleIndices(changed);
+    EXPECT_TRUE(changed.empty());
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt/common/point_indexer.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t MAX_NUM_SAMPLES = 100;
+
+template <std::size_t Dim>
+using rng_t = typename cslibs_math::random::Uniform<Dim>;
+
+/// exposes the bundle indexing of the map
+class IndexedGridmap : public cslibs_ndt_3d::dynamic_maps::Gridmap
+{
+public:
+    using base_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    using base_t::base_t;
+    using base_t::toBundleIndex;
+};
+
+TEST(Test_cslibs_ndt_3d, testPointIndexer)
+{
+    using point_t     = cslibs_math_3d::Point3d;
+    using pose_t      = cslibs_math_3d::Pose3d;
+    using transform_t = cslibs_math_3d::Transform3d;
+    using index_t     = std::array<int, 3>;
+    using indexer_t   = cslibs_ndt::PointIndexer<3, pose_t, transform_t>;
+
+    rng_t<1> rng_coord(-10.0, 10.0);
+    rng_t<1> rng_angle(-M_PI, M_PI);
+    auto random_pose = [&rng_coord, &rng_angle]() {
+        return transform_t(cslibs_math_3d::Vector3d(rng_coord.get(), rng_coord.get(), rng_coord.get()),
+                           cslibs_math_3d::Quaternion(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    };
+
+    const IndexedGridmap map(random_pose(), 0.5);
+    const pose_t         origin = random_pose();
+    const transform_t    w_T_m  = map.getInitialOrigin();
+    const transform_t    s_T_w  = origin.inverse();
+
+    // random points, points on bundle boundaries and non-finite points
+    std::vector<point_t> points;
+    for (std::size_t i = 0 ; i < 10 * MAX_NUM_SAMPLES ; ++ i) {
+        points.emplace_back(rng_coord.get(), rng_coord.get(), rng_coord.get());
+        const int k = static_cast<int>(rng_coord.get() * 4.0);
+        points.emplace_back(s_T_w * (w_T_m * point_t(k * 0.25, -k * 0.25, 0.25)));
+    }
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    points.emplace_back(nan, 0.0, 0.0);
+    points.emplace_back(0.0, inf, 0.0);
+    points.emplace_back(0.0, 0.0, -inf);
+    std::swap(points[3], points[points.size() - 1]);
+
+    std::vector<std::pair<point_t, index_t>> expected;
+    for (const point_t &p : points) {
+        const point_t pm = origin * p;
+        if (pm.isNormal())
+            expected.emplace_back(pm, map.toBundleIndex(pm));
+    }
+
+    std::vector<std::pair<point_t, index_t>> indexed;
+    const indexer_t indexer(origin, map.getInitialOrigin().inverse(), 1.0 / map.getBundleResolution());
+    indexer.apply(points, [&indexed](const point_t &p_w, const index_t &bi) {
+        indexed.emplace_back(p_w, bi);
+    });
+
+    ASSERT_EQ(indexed.size(), expected.size());
+    for (std::size_t i = 0 ; i < expected.size() ; ++ i) {
+        for (std::size_t j = 0 ; j < 3 ; ++ j)
+            EXPECT_EQ(indexed[i].first(j), expected[i].first(j));
+        EXPECT_EQ(indexed[i].second, expected[i].second);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -147,7 +147,6 @@ void testStaticMap(const typename cslibs_ndt_3d::static_maps::Gridmap::Ptr & map
     }
 }
 
-
 void testDynamicOccMap(const typename cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::Ptr & map,
                        const typename cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::Ptr & map_converted)
 {
@@ -448,6 +447,32 @@ TEST(Test_cslibs_ndt_3d, testStaticOccupancyGridmapConversion)
     // TODO: test
 }
 
+TEST(Test_cslibs_ndt_3d, testDynamicGridmapConversionSamples)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    rng_t<1> rng_coord(-3.6, 2.9);
+
+    // the minimum bundle index is odd, so the cell storages swap
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    std::vector<cslibs_math_3d::Point3d> points;
+    for (std::size_t i = 0 ; i < 50 * MAX_NUM_SAMPLES ; ++ i) {
+        points.emplace_back(rng_coord.get(), rng_coord.get(), rng_coord.get());
+        map->add(points.back());
+    }
+    ASSERT_NE(map->getMinDistributionIndex()[0] % 2, 0);
+
+    const cslibs_ndt_3d::static_maps::Gridmap::Ptr map_static = cslibs_ndt_3d::conversion::from(map);
+    ASSERT_NE(map_static, nullptr);
+    const typename map_t::Ptr map_dynamic = cslibs_ndt_3d::conversion::from(map_static);
+    ASSERT_NE(map_dynamic, nullptr);
+
+    for (std::size_t i = 0 ; i < points.size() ; i += 7) {
+        const double expected = map->sampleNonNormalized(points[i]);
+        EXPECT_NEAR(expected, map_static->sampleNonNormalized(points[i]),  1e-9);
+        EXPECT_NEAR(expected, map_dynamic->sampleNonNormalized(points[i]), 1e-9);
+    }
+}
+
 TEST(Test_cslibs_ndt_3d, testDynamicGridmapFileBinarySerialization)
 {
     using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
@@ -480,6 +505,122 @@ TEST(Test_cslibs_ndt_3d, testDynamicOccupancyGridmapFileBinarySerialization)
     // tests
     EXPECT_TRUE(success);
 //    testDynamicOccMap(map, map_from_file);
+
+    // every occupied cell holds exactly one statistic from the map's arena
+    std::size_t num_occupied = 0;
+    for (const auto &s : map->getStorages())
+        s->traverse([&num_occupied](const map_t::index_t &, const map_t::distribution_t &d) {
+            num_occupied += d.getDistribution() ? 1 : 0;
+        });
+    const cslibs_ndt::Arena::Statistics statistics = map->getAllocationStatistics();
+    EXPECT_EQ(num_occupied, statistics.live);
+    EXPECT_EQ(statistics.allocations, statistics.live + statistics.deallocations);
+    EXPECT_GT(statistics.slabs, 0ul);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicGridmapFileBinaryRegionSerialization)
+{
+    using map_t   = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    using index_t = map_t::index_t;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    // to file
+    cslibs_ndt_3d::dynamic_maps::saveBinary(map, "/tmp/dynamic_map_binary_region_3d");
+
+    // lower half of the map from file
+    const index_t min_bi = map->getMinDistributionIndex();
+    index_t max_bi = map->getMaxDistributionIndex();
+    for (std::size_t i = 0 ; i < 3 ; ++ i)
+        max_bi[i] = (min_bi[i] + max_bi[i]) / 2;
+
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt_3d::dynamic_maps::loadBinary("/tmp/dynamic_map_binary_region_3d", map_from_file, min_bi, max_bi);
+
+    // tests
+    EXPECT_TRUE(success);
+    std::size_t num_bundles = 0;
+    map->traverse([&num_bundles, &min_bi, &max_bi](const index_t &bi, const map_t::distribution_bundle_t &) {
+        if (cslibs_ndt::blocks<3>::contains(bi, min_bi, max_bi))
+            ++ num_bundles;
+    });
+
+    std::size_t num_bundles_from_file = 0;
+    map_from_file->traverse([&num_bundles_from_file, &map, &min_bi, &max_bi](const index_t &bi, const map_t::distribution_bundle_t &b) {
+        ++ num_bundles_from_file;
+        EXPECT_TRUE(cslibs_ndt::blocks<3>::contains(bi, min_bi, max_bi));
+
+        const map_t::distribution_bundle_t *bb = map->getDistributionBundle(bi);
+        EXPECT_NE(bb, nullptr);
+        for (std::size_t i = 0 ; i < 8 ; ++ i) {
+            EXPECT_NE(b.at(i), nullptr);
+            EXPECT_EQ(b.at(i)->getHandle()->data().getN(), bb->at(i)->getHandle()->data().getN());
+        }
+    });
+    EXPECT_EQ(num_bundles, num_bundles_from_file);
+}
+
+TEST(Test_cslibs_ndt_3d, testDynamicHashGridmapFileBinarySerialization)
+{
+    using map_t      = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    using hash_map_t = cslibs_ndt_3d::dynamic_maps::HashGridmap;
+    using index_t    = map_t::index_t;
+    rng_t<1> rng_coord(-10.0, 10.0);
+
+    // same points in both backends
+    const typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+    const typename hash_map_t::Ptr hash_map(new hash_map_t(cslibs_math_3d::Transform3d(), 1.0));
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i) {
+        const cslibs_math_3d::Point3d p(rng_coord.get(), rng_coord.get(), rng_coord.get());
+        map->add(p);
+        hash_map->add(p);
+    }
+
+    // the file format does not depend on the backend
+    cslibs_ndt_3d::dynamic_maps::saveBinary(hash_map, "/tmp/dynamic_hash_map_binary_3d");
+    typename map_t::Ptr map_from_file;
+    typename hash_map_t::Ptr hash_map_from_file;
+    EXPECT_TRUE(cslibs_ndt_3d::dynamic_maps::loadBinary("/tmp/dynamic_hash_map_binary_3d", map_from_file));
+    EXPECT_TRUE(cslibs_ndt_3d::dynamic_maps::loadBinary("/tmp/dynamic_hash_map_binary_3d", hash_map_from_file));
+
+    std::size_t num_bundles = 0;
+    map->traverse([&num_bundles, &map_from_file, &hash_map_from_file](const index_t &bi, const map_t::distribution_bundle_t &b) {
+        ++ num_bundles;
+        const map_t::distribution_bundle_t      *bb = map_from_file->getDistributionBundle(bi);
+        const hash_map_t::distribution_bundle_t *hb = hash_map_from_file->getDistributionBundle(bi);
+        EXPECT_NE(bb, nullptr);
+        EXPECT_NE(hb, nullptr);
+        for (std::size_t i = 0 ; i < 8 ; ++ i) {
+            EXPECT_EQ(b.at(i)->getHandle()->data().getN(), bb->at(i)->getHandle()->data().getN());
+            EXPECT_EQ(b.at(i)->getHandle()->data().getN(), hb->at(i)->getHandle()->data().getN());
+        }
+    });
+
+    std::size_t num_hash_bundles = 0;
+    hash_map->traverse([&num_hash_bundles](const index_t &, const hash_map_t::distribution_bundle_t &) {
+        ++ num_hash_bundles;
+    });
+    EXPECT_EQ(num_bundles, num_hash_bundles);
+    EXPECT_EQ(map_from_file->getMinDistributionIndex(), hash_map_from_file->getMinDistributionIndex());
+    EXPECT_EQ(map_from_file->getMaxDistributionIndex(), hash_map_from_file->getMaxDistributionIndex());
+
+    // morton maps load the same file and visit their bundles in z-order
+    using morton_map_t = cslibs_ndt_3d::dynamic_maps::MortonGridmap;
+    typename morton_map_t::Ptr morton_map_from_file;
+    EXPECT_TRUE(cslibs_ndt_3d::dynamic_maps::loadBinary("/tmp/dynamic_hash_map_binary_3d", morton_map_from_file));
+
+    std::size_t num_morton_bundles = 0;
+    std::uint64_t last_code = 0;
+    morton_map_from_file->traverse([&num_morton_bundles, &last_code, &map_from_file](const index_t &bi, const morton_map_t::distribution_bundle_t &b) {
+        ++ num_morton_bundles;
+        const std::uint64_t code = cslibs_ndt::morton<3>::encode(bi);
+        EXPECT_LE(last_code, code);
+        last_code = code;
+        const map_t::distribution_bundle_t *bb = map_from_file->getDistributionBundle(bi);
+        EXPECT_NE(bb, nullptr);
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            EXPECT_EQ(b.at(i)->getHandle()->data().getN(), bb->at(i)->getHandle()->data().getN());
+    });
+    EXPECT_EQ(num_bundles, num_morton_bundles);
 }
 
 TEST(Test_cslibs_ndt_3d, testStaticGridmapFileBinarySerialization)
@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/static_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_3d/serialization/static_maps/gridmap.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t MAX_NUM_SAMPLES = 100;
+
+template <std::size_t Dim>
+using rng_t = typename cslibs_math::random::Uniform<Dim>;
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math::linear::Pointcloud<point_t>;
+
+/// reference insertion accumulating into a temporary kd-tree, dropping points outside of the map
+class KDTreeGridmap : public cslibs_ndt_3d::static_maps::Gridmap
+{
+public:
+    using cslibs_ndt_3d::static_maps::Gridmap::Gridmap;
+    using kd_storage_t = cis::Storage<distribution_t, index_t, cis::backend::kdtree::KDTree>;
+
+    inline void insertKDTree(const pose_t &origin,
+                             const typename pointcloud_t::Ptr &points)
+    {
+        kd_storage_t storage;
+        for (const auto &p : *points) {
+            const point_t pm = origin * p;
+            if (pm.isNormal()) {
+                const index_t &bi = toBundleIndex(pm);
+                if (!inside(size_, bi))
+                    continue;
+                distribution_t *d = storage.get(bi);
+                (d ? d : &storage.insert(bi, distribution_t()))->data().add(pm);
+            }
+        }
+
+        storage.traverse([this](const index_t& bi, const distribution_t &d) {
+            distribution_bundle_t *bundle = getAllocate(bi);
+            for (std::size_t i = 0 ; i < 8 ; ++ i)
+                bundle->at(i)->getHandle()->data() += d.data();
+        });
+    }
+
+    static inline bool inside(const size_t &size, const index_t &bi)
+    {
+        for (std::size_t i = 0 ; i < 3 ; ++ i)
+            if (bi[i] < 0 || bi[i] >= 2 * static_cast<int>(size[i]))
+                return false;
+        return true;
+    }
+};
+
+class KDTreeOccupancyGridmap : public cslibs_ndt_3d::static_maps::OccupancyGridmap
+{
+public:
+    using cslibs_ndt_3d::static_maps::OccupancyGridmap::OccupancyGridmap;
+    using kd_storage_t = cis::Storage<distribution_t, index_t, cis::backend::kdtree::KDTree>;
+
+    inline void insertKDTree(const pose_t &origin,
+                             const typename pointcloud_t::Ptr &points)
+    {
+        kd_storage_t storage;
+        for (const auto &p : *points) {
+            const point_t pm = origin * p;
+            if (pm.isNormal()) {
+                const index_t &bi = toBundleIndex(pm);
+                if (!KDTreeGridmap::inside(size_, bi))
+                    continue;
+                distribution_t *d = storage.get(bi);
+                (d ? d : &storage.insert(bi, distribution_t()))->updateOccupied(pm);
+            }
+        }
+
+        const point_t start_p = m_T_w_ * origin.translation();
+        storage.traverse([this, &start_p](const index_t& bi, const distribution_t &d) {
+            if (!d.getDistribution())
+                return;
+            updateOccupied(bi, d.getDistribution());
+
+            simple_iterator_t it(start_p, m_T_w_ * point_t(d.getDistribution()->getMean()), bundle_resolution_);
+            const std::size_t n = d.numOccupied();
+            while (!it.done()) {
+                updateFree({{it.x(), it.y(), it.z()}}, n);
+                ++ it;
+            }
+        });
+    }
+};
+
+/// a sensor inside of the map observing points partially outside of it
+inline void generateScan(const cslibs_math_3d::Pose3d &origin,
+                         pointcloud_t::Ptr            &points)
+{
+    rng_t<1> rng_coord(-1.0, 5.0);
+    points.reset(new pointcloud_t);
+    const cslibs_math_3d::Transform3d s_T_w = origin.inverse();
+    for (std::size_t i = 0 ; i < 50 * MAX_NUM_SAMPLES ; ++ i)
+        points->insert(s_T_w * point_t(rng_coord.get(), rng_coord.get(), rng_coord.get()));
+}
+
+inline void expectEqual(const cslibs_math::statistics::Distribution<3, 3> &a,
+                        const cslibs_math::statistics::Distribution<3, 3> &b)
+{
+    ASSERT_EQ(a.getN(), b.getN());
+    if (a.getN() == 0)
+        return;
+    EXPECT_LT((a.getMean() - b.getMean()).norm(), 1e-9);
+    if (a.getN() > 2)
+        EXPECT_LT((a.getCovariance() - b.getCovariance()).norm(), 1e-9);
+}
+
+TEST(Test_cslibs_ndt_3d, testStaticGridmapSortAndMerge)
+{
+    using map_t = cslibs_ndt_3d::static_maps::Gridmap;
+    const cslibs_math_3d::Pose3d origin(2.0, 1.5, 2.5);
+    pointcloud_t::Ptr points;
+    generateScan(origin, points);
+
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0, {{4, 4, 4}}));
+    std::shared_ptr<KDTreeGridmap> expected(new KDTreeGridmap(cslibs_math_3d::Transform3d(), 1.0, {{4, 4, 4}}));
+    map->insert(origin, points);
+    expected->insertKDTree(origin, points);
+
+    // points outside of the map are dropped, all others are merged as before
+    std::size_t n = 0;
+    expected->traverse([&map, &n](const map_t::index_t &bi, const map_t::distribution_bundle_t &b) {
+        const map_t::distribution_bundle_t *bundle = map->getDistributionBundle(bi);
+        ASSERT_NE(bundle, nullptr);
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            expectEqual(bundle->at(i)->getHandle()->data(), b.at(i)->getHandle()->data());
+        ++ n;
+    });
+    std::size_t m = 0;
+    map->traverse([&m](const map_t::index_t &, const map_t::distribution_bundle_t &) {
+        ++ m;
+    });
+    EXPECT_EQ(n, m);
+}
+
+TEST(Test_cslibs_ndt_3d, testStaticOccupancyGridmapSortAndMerge)
+{
+    using map_t = cslibs_ndt_3d::static_maps::OccupancyGridmap;
+    const cslibs_math_3d::Pose3d origin(2.0, 1.5, 2.5);
+    pointcloud_t::Ptr points;
+    generateScan(origin, points);
+
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0, {{4, 4, 4}}));
+    std::shared_ptr<KDTreeOccupancyGridmap> expected(new KDTreeOccupancyGridmap(cslibs_math_3d::Transform3d(), 1.0, {{4, 4, 4}}));
+    map->insert(origin, points);
+    expected->insertKDTree(origin, points);
+
+    std::size_t n = 0;
+    expected->traverse([&map, &n](const map_t::index_t &bi, const map_t::distribution_bundle_t &b) {
+        const map_t::distribution_bundle_t *bundle = map->getDistributionBundle(bi);
+        ASSERT_NE(bundle, nullptr);
+        for (std::size_t i = 0 ; i < 8 ; ++ i) {
+            const auto &h = bundle->at(i)->getHandle();
+            const auto &e = b.at(i)->getHandle();
+            EXPECT_EQ(h->numFree(), e->numFree());
+            EXPECT_EQ(h->numOccupied(), e->numOccupied());
+            ASSERT_EQ(static_cast<bool>(h->getDistribution()), static_cast<bool>(e->getDistribution()));
+            if (e->getDistribution())
+                expectEqual(*h->getDistribution(), *e->getDistribution());
+        }
+        ++ n;
+    });
+    std::size_t m = 0;
+    map->traverse([&m](const map_t::index_t &, const map_t::distribution_bundle_t &) {
+        ++ m;
+    });
+    EXPECT_EQ(n, m);
+}
+
+TEST(Test_cslibs_ndt_3d, testStaticGridmapSparseFileBinarySerialization)
+{
+    using map_t = cslibs_ndt_3d::static_maps::Gridmap;
+    rng_t<1> rng_coord(0.0, 2.0);
+
+    // a large map with one occupied corner
+    const map_t::size_t size = {{128, 128, 64}};
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0, size));
+    for (std::size_t i = 0 ; i < 10 * MAX_NUM_SAMPLES ; ++ i)
+        map->add(cslibs_math_3d::Point3d(rng_coord.get(), rng_coord.get(), rng_coord.get()));
+
+    // only the blocks around the points are allocated, dense storages held all bundles and distributions
+    const std::size_t num_bundles       = 8 * size[0] * size[1] * size[2];
+    const std::size_t num_distributions = 8 * (size[0] + 1) * (size[1] + 1) * (size[2] + 1);
+    const std::size_t dense_byte_size   = num_bundles * sizeof(map_t::distribution_bundle_t) +
+                                          num_distributions * sizeof(map_t::distribution_t);
+    EXPECT_LT(map->getByteSize(), dense_byte_size / 100);
+
+    cslibs_ndt_3d::static_maps::saveBinary(map, "/tmp/static_sparse_map_binary_3d");
+    typename map_t::Ptr map_from_file;
+    EXPECT_TRUE(cslibs_ndt_3d::static_maps::loadBinary("/tmp/static_sparse_map_binary_3d", map_from_file));
+    ASSERT_NE(map_from_file, nullptr);
+    EXPECT_EQ(map_from_file->getSize(), size);
+    EXPECT_LT(map_from_file->getByteSize(), dense_byte_size / 100);
+
+    std::size_t n = 0;
+    map->traverse([&map_from_file, &n](const map_t::index_t &bi, const map_t::distribution_bundle_t &b) {
+        const map_t::distribution_bundle_t *bundle = map_from_file->getDistributionBundle(bi);
+        ASSERT_NE(bundle, nullptr);
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            expectEqual(b.at(i)->getHandle()->data(), bundle->at(i)->getHandle()->data());
+        ++ n;
+    });
+    EXPECT_GT(n, 0ul);
+}
+
+TEST(Test_cslibs_ndt_3d, testStaticOccupancyGridmapBake)
+{
+    using map_t = cslibs_ndt_3d::static_maps::OccupancyGridmap;
+    const cslibs_gridmaps::utility::InverseModel::Ptr ivm(new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    rng_t<1> rng_coord(0.0, 4.0);
+
+    // dense enough for all cells to be well conditioned
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0, {{4, 4, 4}}));
+    for (std::size_t i = 0 ; i < 50 * MAX_NUM_SAMPLES ; ++ i)
+        map->add(cslibs_math_3d::Point3d(rng_coord.get(), rng_coord.get(), rng_coord.get()),
+                 cslibs_math_3d::Point3d(rng_coord.get(), rng_coord.get(), rng_coord.get()));
+
+    std::vector<cslibs_math_3d::Point3d> points;
+    map->traverse([&points](const map_t::index_t &, const map_t::distribution_bundle_t &b) {
+        for (std::size_t i = 0 ; i < 8 ; ++ i)
+            if (b.at(i)->getDistribution())
+                points.emplace_back(b.at(i)->getDistribution()->getMean());
+    });
+    std::vector<double> expected;
+    for (const cslibs_math_3d::Point3d &p : points)
+        expected.emplace_back(map->sampleNonNormalized(p, ivm));
+
+    // samples of the baked map differ by the quantisation of the occupancy only
+    EXPECT_EQ(map->getBakedOccupancy(), nullptr);
+    const map_t::baked_occupancy_t::Ptr baked = map->bake(ivm);
+    EXPECT_EQ(map->getBakedOccupancy(), baked);
+    for (std::size_t i = 0 ; i < points.size() ; ++ i)
+        EXPECT_NEAR(expected[i], map->sampleNonNormalized(points[i], ivm), 1e-5);
+
+    // writing drops the table
+    map->add(points.front(), points.back());
+    EXPECT_EQ(map->getBakedOccupancy(), nullptr);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
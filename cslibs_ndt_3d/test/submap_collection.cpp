@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/dynamic_maps/submap_collection.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t MAX_NUM_SAMPLES = 100;
+
+template <std::size_t Dim>
+using rng_t = typename cslibs_math::random::Uniform<Dim>;
+
+TEST(Test_cslibs_ndt_3d, testSubmapCollectionReanchoring)
+{
+    using collection_t = cslibs_ndt_3d::dynamic_maps::SubmapCollection;
+    rng_t<1> rng_coord(-10.0, 10.0);
+    rng_t<1> rng_angle(-M_PI, M_PI);
+    auto random_pose = [&rng_coord, &rng_angle]() {
+        return cslibs_math_3d::Transform3d(cslibs_math_3d::Vector3d(rng_coord.get(), rng_coord.get(), rng_coord.get()),
+                                           cslibs_math_3d::Quaternion(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    };
+
+    collection_t submaps(1.0);
+    const cslibs_math_3d::Transform3d anchor = random_pose();
+    const std::size_t id = submaps.addSubmap(anchor);
+    submaps.addSubmap(random_pose());
+
+    // queries stay inside the cloud, so that all cells hit are well conditioned
+    rng_t<1> rng_cloud(-3.0, 3.0);
+    rng_t<1> rng_query(-1.0, 1.0);
+    std::vector<cslibs_math_3d::Point3d> points;
+    for (std::size_t i = 0 ; i < 40 * MAX_NUM_SAMPLES ; ++ i) {
+        points.emplace_back(rng_cloud.get(), rng_cloud.get(), rng_cloud.get());
+        submaps.add(id, points.back());
+    }
+    std::vector<cslibs_math_3d::Point3d> queries;
+    std::vector<double> samples;
+    for (std::size_t i = 0 ; i < MAX_NUM_SAMPLES ; ++ i) {
+        queries.emplace_back(rng_query.get(), rng_query.get(), rng_query.get());
+        samples.emplace_back(submaps.sample(queries.back()));
+        EXPECT_GT(samples.back(), 0.0);
+    }
+
+    // moving the anchor moves the whole submap with it
+    const cslibs_math_3d::Transform3d moved = random_pose();
+    submaps.setAnchor(id, moved);
+    const cslibs_math_3d::Transform3d correction = moved * anchor.inverse();
+    for (std::size_t i = 0 ; i < queries.size() ; ++ i) {
+        std::vector<std::size_t> ids;
+        submaps.getSubmaps(correction * queries[i], ids);
+        EXPECT_NE(std::find(ids.begin(), ids.end(), id), ids.end());
+        EXPECT_NEAR(samples[i], submaps.sample(correction * queries[i]), 1e-6 * samples[i]);
+    }
+
+    // fused map holds every sample once per storage
+    std::size_t n = 0;
+    submaps.toMap()->getStorages()[0]->traverse([&n](const collection_t::index_t &, const cslibs_ndt_3d::dynamic_maps::Gridmap::distribution_t &d) {
+        n += d.data().getN();
+    });
+    EXPECT_EQ(points.size(), n);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}